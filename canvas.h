@@ -17,6 +17,14 @@
 #ifdef DOXYGEN
     #define CANVAS_STATIC_INLINE
     #define CANVAS_FEATURE_TWO_BUFFERS 1
+    #define CANVAS_FEATURE_MAPPED_MEMORY 1
+    #define CANVAS_FEATURE_PRESENT_QUEUE 1
+    #define CANVAS_FEATURE_COMMAND_QUEUE 1
+    #define CANVAS_FEATURE_THREAD_POOL 1
+    #define CANVAS_FEATURE_IMAGE_EXPORT 1
+    #define CANVAS_FEATURE_DISPATCH 1
+    #define CANVAS_FEATURE_FAST_CLEAR 1
+    #define CANVAS_FEATURE_STREAM_STORES 1
 #else
     #define CANVAS_STATIC_INLINE static inline
 #endif
@@ -25,1479 +33,9922 @@
     #define CANVAS_FEATURE_TWO_BUFFERS 1
 #endif
 
+#ifndef CANVAS_FEATURE_MAPPED_MEMORY
+    #define CANVAS_FEATURE_MAPPED_MEMORY 0
+#endif
+
+#ifndef CANVAS_FEATURE_PRESENT_QUEUE
+    #define CANVAS_FEATURE_PRESENT_QUEUE 0
+#endif
+
+#ifndef CANVAS_FEATURE_COMMAND_QUEUE
+    #define CANVAS_FEATURE_COMMAND_QUEUE 0
+#endif
+
+#ifndef CANVAS_FEATURE_THREAD_POOL
+    #define CANVAS_FEATURE_THREAD_POOL 0
+#endif
+
+#ifndef CANVAS_FEATURE_IMAGE_EXPORT
+    #define CANVAS_FEATURE_IMAGE_EXPORT 0
+#endif
+
+#ifndef CANVAS_FEATURE_DISPATCH
+    #define CANVAS_FEATURE_DISPATCH 0
+#endif
+
+#ifndef CANVAS_FEATURE_FAST_CLEAR
+    #define CANVAS_FEATURE_FAST_CLEAR 0
+#endif
+
+#ifndef CANVAS_FEATURE_STREAM_STORES
+    #define CANVAS_FEATURE_STREAM_STORES 0
+#endif
+
 #include "vendor/st/fonts.h"
 
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
+#include <math.h>
+
+#if CANVAS_FEATURE_MAPPED_MEMORY
+    // Strict modes such as -std=c99 hide ftruncate and friends unless a feature test macro asks for them
+    #if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE) && !defined(_XOPEN_SOURCE) && !defined(_DEFAULT_SOURCE) && !defined(_GNU_SOURCE)
+        #error "CANVAS_FEATURE_MAPPED_MEMORY needs POSIX declarations; define _POSIX_C_SOURCE as 200809L before including canvas.h"
+    #endif
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if CANVAS_FEATURE_PRESENT_QUEUE
+    #include <errno.h>
+    #include <pthread.h>
+#endif
+
+#if CANVAS_FEATURE_THREAD_POOL
+    #include <errno.h>
+    #include <pthread.h>
+#endif
+
+#if CANVAS_FEATURE_IMAGE_EXPORT
+    #include <errno.h>
+    #include <stdio.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+#if CANVAS_FEATURE_DISPATCH
+    #include <stdlib.h>
+#endif
+
+#if CANVAS_FEATURE_STREAM_STORES && (defined(__SSE2__) || defined(_M_X64))
+    #define CANVAS_STREAM_STORES 1
+    #include <emmintrin.h>
+#else
+    #define CANVAS_STREAM_STORES 0
+#endif
 
 /**
- * @defgroup BUFFER_API Buffer API
+ * @defgroup RASTER_API Raster API
+ *
+ * Shapes are rasterized into horizontal spans which are handed to a span function.
+ * The span function decides what to do with them, e.g. write them into a buffer or clip them to a band of rows first.
  *
  * @{
  */
 
 /**
- * Set a single pixel value in the buffer
+ * Receives one horizontal span of a shape.
  *
- * @param[out] buffer           The buffer in which to place the pixel
- * @param[in]  pixel            Data for the pixel
- * @param[in]  pixel_size       The size per pixel in bytes
- * @param[in]  width            The width of the canvas in pixels
- * @param[in]  x                X coordinate in pixels
- * @param[in]  y                Y cooridnate in pixels
+ * @param context  The context pointer that was passed to the rasterizer
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ *
+ * The coordinates may be outside of the canvas if the shape is.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_set_pixel(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x,
-    size_t y
-)
-{
-    size_t offset = (y * width + x) * pixel_size;
-    memcpy(buffer + offset, pixel, pixel_size);
-}
+typedef void (*canvas_span_function_t)(void *context, int x_left, int x_right, int y);
 
 /**
- * Fill the entire canvas with one pixel value
+ * Rasterize a line using Bresenham's line algorithm.
  *
- * @param[out] buffer           The buffer of data to fill
- * @param[in]  pixel            Data for the pixel
- * @param[in]  pixel_size       The size per pixel in bytes
- * @param[in]  memory_size      The total memory size of the canvas in bytes
+ * @param x_0      X-coordinate of the first point on the line
+ * @param x_1      X-coordinate of the last point on the line (minus 1)
+ * @param y_0      Y-coordinate of the first point on the line
+ * @param y_1      Y-coordinate of the last point on the line (minus 1)
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * Consecutive pixels on the same row are merged into one span.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_fill(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t memory_size
+CANVAS_STATIC_INLINE void canvas_raster_line(
+    int x_0,
+    int x_1,
+    int y_0,
+    int y_1,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    for (size_t i = 0; i < memory_size; i += pixel_size)
+    int x_diff_abs = x_1 > x_0 ? x_1 - x_0 : x_0 - x_1;
+    int y_diff_abs = y_1 > y_0 ? y_1 - y_0 : y_0 - y_1;
+
+    if (y_diff_abs < x_diff_abs)
     {
-        memcpy(buffer + i, pixel, pixel_size);
+        if (x_0 > x_1)
+        {
+            int swap = x_0; x_0 = x_1; x_1 = swap;
+            swap = y_0; y_0 = y_1; y_1 = swap;
+        }
+        int y_step = y_1 > y_0 ? 1 : -1;
+        int error = 2 * y_diff_abs - x_diff_abs;
+        int y = y_0;
+        int x_run = x_0;
+        for (int x = x_0; x < x_1; x++)
+        {
+            if (error > 0)
+            {
+                function(context, x_run, x + 1, y);
+                x_run = x + 1;
+                y += y_step;
+                error += 2 * (y_diff_abs - x_diff_abs);
+            }
+            else
+            {
+                error += 2 * y_diff_abs;
+            }
+        }
+        if (x_run < x_1)
+        {
+            function(context, x_run, x_1, y);
+        }
+    }
+    else
+    {
+        if (y_0 > y_1)
+        {
+            int swap = x_0; x_0 = x_1; x_1 = swap;
+            swap = y_0; y_0 = y_1; y_1 = swap;
+        }
+        int x_step = x_1 > x_0 ? 1 : -1;
+        int error = 2 * x_diff_abs - y_diff_abs;
+        int x = x_0;
+        for (int y = y_0; y < y_1; y++)
+        {
+            function(context, x, x + 1, y);
+            if (error > 0)
+            {
+                x += x_step;
+                error += 2 * (x_diff_abs - y_diff_abs);
+            }
+            else
+            {
+                error += 2 * x_diff_abs;
+            }
+        }
     }
 }
 
 /**
- * Rotate the canvas 90 degrees clockwise
- *
- * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
- * @param[in]  source           Source buffer; the original canvas comes from here.
- * @param      pixel_size       The size per pixel in bytes
- * @param      memory_size      The total memory size of the canvas in bytes
- * @param      width            Width of the source canvas
- * @param      height           Height of the source canvas
+ * Rasterize the edges of a rectangle, 1 pixel wide.
  *
- * @note `source` and `destination` must not point to overlapping memory.
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param function Called with each span
+ * @param context  Passed to `function`
  */
-CANVAS_STATIC_INLINE void canvas_buffer_rotate_90_cw(
-    uint8_t* CANVAS_RESTRICT destination,
-    const uint8_t* CANVAS_RESTRICT source,
-    size_t pixel_size,
-    size_t memory_size,
-    size_t width,
-    size_t height
+CANVAS_STATIC_INLINE void canvas_raster_rect(
+    int x_left,
+    int x_right,
+    int y_top,
+    int y_bottom,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    for (size_t y = 0; y < height; y++)
+    if (x_left >= x_right || y_top >= y_bottom)
+    {
+        return;
+    }
+    function(context, x_left, x_right, y_top);
+    for (int y = y_top + 1; y < y_bottom - 1; y++)
     {
-        for (size_t x = 0; x < width; x++)
+        function(context, x_left, x_left + 1, y);
+        if (x_right - 1 > x_left)
         {
-            canvas_buffer_set_pixel(
-                destination,
-                source + (y * width + x) * pixel_size,
-                pixel_size,
-                width,
-                height - y,
-                x
-            );
+            function(context, x_right - 1, x_right, y);
         }
     }
+    if (y_bottom - 1 > y_top)
+    {
+        function(context, x_left, x_right, y_bottom - 1);
+    }
 }
 
 /**
- * Rotate the canvas 90 degrees counter-clockwise
+ * For internal use. Division which rounds towards negative infinity.
  *
- * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
- * @param[in]  source           Source buffer; the original canvas comes from here.
- * @param      pixel_size       The size per pixel in bytes
- * @param      memory_size      The total memory size of the canvas in bytes
- * @param      width            Width of the source canvas
- * @param      height           Height of the source canvas
+ * @param a Dividend
+ * @param b Divisor, which must not be 0
  *
- * @note `source` and `destination` must not point to overlapping memory.
+ * @return `a / b`, rounded down
  */
-CANVAS_STATIC_INLINE void canvas_buffer_rotate_90_ccw(
-    uint8_t* CANVAS_RESTRICT destination,
-    const uint8_t* CANVAS_RESTRICT source,
-    size_t pixel_size,
-    size_t memory_size,
-    size_t width,
-    size_t height
-)
+CANVAS_STATIC_INLINE int64_t canvas_raster_floor_div(int64_t a, int64_t b)
 {
-    for (size_t y = 0; y < height; y++)
-    {
-        for (size_t x = 0; x < width; x++)
-        {
-            canvas_buffer_set_pixel(
-                destination,
-                source + (y * width + x) * pixel_size,
-                pixel_size,
-                width,
-                y,
-                width - x
-            );
-        }
-    }
+    int64_t q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
 }
 
 /**
- * Rotate the canvas by 180 degrees
+ * For internal use. Narrow the span `[*x_left, *x_right)` on row `y` to the pixels
+ * which are on the inside of the edge from A to B.
  *
- * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
- * @param[in]  source           Source buffer; the original canvas comes from here.
- * @param      pixel_size       The size per pixel in bytes
- * @param      memory_size      The total memory size of the canvas in bytes
- * @param      width            Width of the source canvas
- * @param      height           Height of the source canvas
+ * A pixel is inside if the edge function `(x - x_a) * (y_b - y_a) - (y - y_a) * (x_b - x_a)` is negative,
+ * which is solved for `x` directly instead of being tested pixel by pixel.
  *
- * @note `source` and `destination` must not point to overlapping memory.
+ * @param x_a     X-coordinate of vertex A
+ * @param x_b     X-coordinate of vertex B
+ * @param y_a     Y-coordinate of vertex A
+ * @param y_b     Y-coordinate of vertex B
+ * @param y       Y-coordinate of the row
+ * @param x_left  Leftmost X-coordinate of the span; may be increased
+ * @param x_right Rightmost X-coordinate of the span plus 1; may be decreased
  */
-CANVAS_STATIC_INLINE void canvas_buffer_rotate_180(
-    uint8_t* CANVAS_RESTRICT destination,
-    const uint8_t* CANVAS_RESTRICT source,
-    size_t pixel_size,
-    size_t memory_size,
-    size_t width,
-    size_t height
+CANVAS_STATIC_INLINE void canvas_raster_clip_to_edge(
+    int x_a,
+    int x_b,
+    int y_a,
+    int y_b,
+    int y,
+    int *x_left,
+    int *x_right
 )
 {
-    for (size_t y = 0; y < height; y++)
+    int64_t slope = y_b - y_a;
+    int64_t c = (int64_t)(y - y_a) * (x_b - x_a);
+    if (slope > 0)
     {
-        for (size_t x = 0; x < width; x++)
+        // (x - x_a) * slope < c  <=>  x < x_a + ceil(c / slope)
+        int64_t bound = x_a - canvas_raster_floor_div(-c, slope);
+        if (bound < *x_right)
         {
-            canvas_buffer_set_pixel(
-                destination,
-                source + (y * width + x) * pixel_size,
-                pixel_size,
-                width,
-                width - x,
-                height - y
-            );
+            *x_right = (int)bound;
+        }
+    }
+    else if (slope < 0)
+    {
+        // (x - x_a) * slope < c  <=>  x > x_a + c / slope
+        int64_t bound = x_a + canvas_raster_floor_div(c, slope) + 1;
+        if (bound > *x_left)
+        {
+            *x_left = (int)bound;
         }
     }
+    else if (c <= 0)
+    {
+        *x_right = *x_left;
+    }
 }
 
 /**
- * Flip the canvas along the horizontal axis
+ * Rasterize a filled triangle.
  *
- * @param[out] destination      Destination buffer; the flipped canvas will be placed here.
- * @param[in]  source           Source buffer; the original canvas comes from here.
- * @param      pixel_size       The size per pixel in bytes
- * @param      memory_size      The total memory size of the canvas in bytes
- * @param      width            Width of the source canvas
- * @param      height           Height of the source canvas
+ * @param x_0      X-coordinate of the first vertex
+ * @param x_1      X-coordinate of the second vertex
+ * @param x_2      X-coordinate of the third vertex
+ * @param y_0      Y-coordinate of the first vertex
+ * @param y_1      Y-coordinate of the second vertex
+ * @param y_2      Y-coordinate of the third vertex
+ * @param function Called with each span
+ * @param context  Passed to `function`
  *
- * @note `source` and `destination` must not point to overlapping memory.
+ * Each row of the triangle is emitted as a single span.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_flip_up_down(
-    uint8_t* CANVAS_RESTRICT destination,
-    const uint8_t* CANVAS_RESTRICT source,
-    size_t pixel_size,
-    size_t memory_size,
-    size_t width,
-    size_t height
+CANVAS_STATIC_INLINE void canvas_raster_fill_triangle(
+    int x_0,
+    int x_1,
+    int x_2,
+    int y_0,
+    int y_1,
+    int y_2,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    for (size_t y = 0; y < height; y++)
+    int x_min = x_0 < x_1 ? (x_0 < x_2 ? x_0 : x_2) : (x_1 < x_2 ? x_1 : x_2);
+    int x_max = x_0 > x_1 ? (x_0 > x_2 ? x_0 : x_2) : (x_1 > x_2 ? x_1 : x_2);
+    int y_min = y_0 < y_1 ? (y_0 < y_2 ? y_0 : y_2) : (y_1 < y_2 ? y_1 : y_2);
+    int y_max = y_0 > y_1 ? (y_0 > y_2 ? y_0 : y_2) : (y_1 > y_2 ? y_1 : y_2);
+
+    for (int y = y_min; y < y_max; y++)
     {
-        for (size_t x = 0; x < width; x++)
+        int x_left = x_min;
+        int x_right = x_max;
+        canvas_raster_clip_to_edge(x_0, x_1, y_0, y_1, y, &x_left, &x_right);
+        canvas_raster_clip_to_edge(x_1, x_2, y_1, y_2, y, &x_left, &x_right);
+        canvas_raster_clip_to_edge(x_2, x_0, y_2, y_0, y, &x_left, &x_right);
+        if (x_left < x_right)
         {
-            canvas_buffer_set_pixel(
-                destination,
-                source + (y * width + x) * pixel_size,
-                pixel_size,
-                width,
-                x,
-                height - y
-            );
+            function(context, x_left, x_right, y);
         }
     }
 }
 
 /**
- * Flip the canvas along the vertical axis
- *
- * @param[out] destination      Destination buffer; the flipped canvas will be placed here.
- * @param[in]  source           Source buffer; the original canvas comes from here.
- * @param      pixel_size       The size per pixel in bytes
- * @param      memory_size      The total memory size of the canvas in bytes
- * @param      width            Width of the source canvas
- * @param      height           Height of the source canvas
+ * For internal use, when rasterizing circles.
  *
- * @note `source` and `destination` must not point to overlapping memory.
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param x_diff   X-coordinate difference between the center and the point in the second octant, in pixels
+ * @param y_diff   Y-coordinate difference between the center and the point in the second octant, in pixels
+ * @param function Called with each span
+ * @param context  Passed to `function`
  */
-CANVAS_STATIC_INLINE void canvas_buffer_flip_left_right(
-    uint8_t* CANVAS_RESTRICT destination,
-    const uint8_t* CANVAS_RESTRICT source,
-    size_t pixel_size,
-    size_t memory_size,
-    size_t width,
-    size_t height
+CANVAS_STATIC_INLINE void canvas_raster_octants(
+    int x_center,
+    int y_center,
+    int x_diff,
+    int y_diff,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    for (size_t y = 0; y < height; y++)
+    int coordinates[8][2] = {
+        { x_center + x_diff, y_center + y_diff },
+        { x_center + x_diff, y_center - y_diff },
+        { x_center + y_diff, y_center + x_diff },
+        { x_center + y_diff, y_center - x_diff },
+        { x_center - x_diff, y_center + y_diff },
+        { x_center - x_diff, y_center - y_diff },
+        { x_center - y_diff, y_center + x_diff },
+        { x_center - y_diff, y_center - x_diff },
+    };
+
+    for (int i = 0; i < 8; i++)
     {
-        for (size_t x = 0; x < width; x++)
-        {
-            canvas_buffer_set_pixel(
-                destination,
-                source + (y * width + x) * pixel_size,
-                pixel_size,
-                width,
-                width - x,
-                y
-            );
-        }
+        function(context, coordinates[i][0], coordinates[i][0] + 1, coordinates[i][1]);
     }
 }
 
 /**
- * Place a filled rectangle into the canvas
+ * Rasterize a circle, 1 pixel wide.
  *
- * @param[out] buffer           The buffer into which the rectangle will be placed
- * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
- * @param      pixel_size       The size per pixel in bytes
- * @param      width            Width of the canvas
- * @param      x_left           X-coordinate of the left side of the rectangle
- * @param      x_right          X-coordinate of the right side of the rectangle (minus 1)
- * @param      y_top            Y-coordinate of the top side of the rectangle
- * @param      y_bottom         Y-coordinate of the bottom side of the rectangle (minus 1)
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ * @param function Called with each span
+ * @param context  Passed to `function`
  */
-CANVAS_STATIC_INLINE void canvas_buffer_fill_rect(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
+CANVAS_STATIC_INLINE void canvas_raster_circle(
+    int x_center,
+    int y_center,
+    int radius,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    size_t width_rect = x_right - x_left;
-    size_t offset_top_left = (y_top * width + x_left) * pixel_size;
-    size_t offset_bottom_right = (y_bottom * width + x_right) * pixel_size;
-    size_t offset_from_end_of_row_to_start_of_next = (width - width_rect) * pixel_size;
-    size_t offset = offset_top_left;
-    while (offset < offset_bottom_right)
+    // Algorithm due to Stefan Gustavson, "An Efficient Circle Drawing Algorithm", 2003-08-20
+    int x = 0;
+    int y = radius;
+    int d = 5 - 4 * radius;
+    int da = 12;
+    int db = 20 - 8 * radius;
+    while (x < y)
     {
-        for (size_t i = 0; i < width_rect; i++)
+        canvas_raster_octants(x_center, y_center, x, y, function, context);
+        if (d < 0)
+        {
+            d += da;
+            db += 8;
+        }
+        else
         {
-            memcpy(buffer + offset, pixel, pixel_size);
-            offset += pixel_size;
+            y--;
+            d += db;
+            db += 16;
         }
-        offset += offset_from_end_of_row_to_start_of_next;
+        x++;
+        da += 8;
     }
+
+    // The original algorithm doesn't fill the corners; do so here
+    int radius_div_sqrt2 = radius * 70 / 99;
+    canvas_raster_octants(x_center, y_center, radius_div_sqrt2, radius_div_sqrt2, function, context);
 }
 
 /**
- * Draw a horizontal line on the canvas
+ * Rasterize a filled circle (disk).
  *
- * @param[out] buffer           The buffer into which the rectangle will be placed
- * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
- * @param      pixel_size       The size per pixel in bytes
- * @param      width            Width of the canvas
- * @param      x_left           X-coordinate of the left edge of the line
- * @param      x_right          X-coordinate of the right edge of the line (minus 1)
- * @param      y                Y-coordinate of the line
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * Each row of the disk is emitted as a single span, except possibly the corner rows.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_draw_horizontal_line(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_left,
-    size_t x_right,
-    size_t y
+CANVAS_STATIC_INLINE void canvas_raster_fill_circle(
+    int x_center,
+    int y_center,
+    int radius,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    for (size_t x = x_left; x < x_right; x++)
+    // Algorithm due to Stefan Gustavson, "An Efficient Circle Drawing Algorithm", 2003-08-20
+    int x = 0;
+    int y = radius;
+    int d = 5 - 4 * radius;
+    int da = 12;
+    int db = 20 - 8 * radius;
+    while (x < y)
+    {
+        // Rows near the middle are visited once each, with their final half-width
+        function(context, x_center - y, x_center + y + 1, y_center + x);
+        if (x > 0)
+        {
+            function(context, x_center - y, x_center + y + 1, y_center - x);
+        }
+
+        // Rows near the top and bottom are visited several times, so only emit them at their widest
+        int x_row = x;
+        int y_row = y;
+        if (d < 0)
+        {
+            d += da;
+            db += 8;
+        }
+        else
+        {
+            y--;
+            d += db;
+            db += 16;
+        }
+        x++;
+        da += 8;
+        if (y != y_row || x >= y)
+        {
+            function(context, x_center - x_row, x_center + x_row + 1, y_center + y_row);
+            function(context, x_center - x_row, x_center + x_row + 1, y_center - y_row);
+        }
+    }
+
+    // The original algorithm doesn't fill the corners; do so here
+    int corner = radius * 70 / 99;
+    function(context, x_center - corner, x_center + corner + 1, y_center + corner);
+    if (corner > 0)
     {
-        canvas_buffer_set_pixel(buffer, pixel, pixel_size, width, x, y);
+        function(context, x_center - corner, x_center + corner + 1, y_center - corner);
     }
 }
 
 /**
- * Draw a vertical line on the canvas
+ * A point, e.g. a vertex of a polygon.
+ */
+typedef struct canvas_point_t {
+    int x;  /**< X-coordinate */
+    int y;  /**< Y-coordinate */
+} canvas_point_t;
+
+/**
+ * Decides which pixels are inside a self-intersecting polygon or one with holes.
+ */
+typedef enum canvas_fill_rule_t {
+    CANVAS_FILL_EVEN_ODD,   /**< A pixel is inside if a ray from it crosses the outline an odd number of times */
+    CANVAS_FILL_NON_ZERO,   /**< A pixel is inside if the outline winds around it a non-zero number of times */
+} canvas_fill_rule_t;
+
+/**
+ * For internal use. One non-horizontal edge of a polygon, while it is being rasterized.
  *
- * @param[out] buffer           The buffer into which the rectangle will be placed
- * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
- * @param      pixel_size       The size per pixel in bytes
- * @param      width            Width of the canvas
- * @param      x                X-coordinate of the line
- * @param      y_top            Y-coordinate of the top edge of the line
- * @param      y_bottom         Y-coordinate of the bottom edge of the line (minus 1)
+ * The X-coordinate where the edge crosses the current row is tracked exactly, as `x + remainder / y_diff`,
+ * and advanced from row to row without division.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_draw_vertical_line(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x,
-    size_t y_top,
-    size_t y_bottom
-)
+typedef struct canvas_polygon_edge_t {
+    int y_top;                              /**< First row crossed by the edge */
+    int y_bottom;                           /**< Last row crossed by the edge, plus 1. */
+    int direction;                          /**< 1 if the edge points down, -1 if it points up */
+    int64_t x;                              /**< Integer part of the crossing on the current row */
+    int64_t remainder;                      /**< Fractional part of the crossing, from 0 up to `y_diff` */
+    int64_t x_step;                         /**< Integer part of the change in `x` per row */
+    int64_t remainder_step;                 /**< Fractional part of the change in `x` per row */
+    int64_t y_diff;                         /**< `y_bottom - y_top` */
+    struct canvas_polygon_edge_t *next;     /**< Next edge in the active edge list */
+} canvas_polygon_edge_t;
+
+/**
+ * For internal use. The leftmost pixel on or right of where an edge crosses the current row.
+ */
+CANVAS_STATIC_INLINE int64_t canvas_polygon_edge_x(const canvas_polygon_edge_t *edge)
 {
-    for (size_t y = y_top; y < y_bottom; y++)
+    return edge->x + (edge->remainder > 0);
+}
+
+/**
+ * For internal use. Sort edges by their first row with heapsort, which needs no memory beyond the edges.
+ */
+CANVAS_STATIC_INLINE void canvas_polygon_sort_edges(canvas_polygon_edge_t *edges, size_t count)
+{
+    for (size_t end = count, start = count / 2; end > 1; )
     {
-        canvas_buffer_set_pixel(buffer, pixel, pixel_size, width, x, y);
+        if (start > 0)
+        {
+            start--;
+        }
+        else
+        {
+            end--;
+            canvas_polygon_edge_t swap = edges[0]; edges[0] = edges[end]; edges[end] = swap;
+        }
+        // Sift the edge at `start` down the heap of the first `end` edges
+        size_t root = start;
+        while (2 * root + 1 < end)
+        {
+            size_t child = 2 * root + 1;
+            if (child + 1 < end && edges[child + 1].y_top > edges[child].y_top)
+            {
+                child++;
+            }
+            if (edges[child].y_top <= edges[root].y_top)
+            {
+                break;
+            }
+            canvas_polygon_edge_t swap = edges[root]; edges[root] = edges[child]; edges[child] = swap;
+            root = child;
+        }
     }
 }
 
 /**
- * Draw a line on the canvas using Bresenham's line algorithm.
+ * Rasterize a filled polygon, using a sorted edge table and an active edge list.
  *
- * @param[out] buffer           The buffer into which the line will be placed
- * @param[in]  pixel            Pixel data for a single pixel. Each pixel on the line will have this pixel value.
- * @param      pixel_size       The size per pixel in bytes
- * @param      width            Width of the canvas
- * @param      x_left           X-coordinate of the leftmost point on the line
- * @param      x_right          X-coordinate of the rightmost point on the line (minus 1)
- * @param      y_top            Y-coordinate of the topmost point on the line
- * @param      y_bottom         Y-coordinate of the bottom point of the line (minus 1)
+ * @param points   The vertices of the polygon, in order. The last vertex is joined to the first.
+ * @param count    Number of vertices
+ * @param rule     Decides which pixels are inside where the outline overlaps itself
+ * @param edges    Working memory for `count` edges
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * Polygons may be concave, self-intersecting and have holes (as further loops of vertices joined to the outline).
+ * Each row is visited once, and each pixel inside the polygon is emitted exactly once.
+ * A pixel `(x, y)` is inside if the point `(x, y)` is, with points on left edges counted as inside
+ * and points on right edges not, so polygons which share an edge do not overlap.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_draw_line(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
+CANVAS_STATIC_INLINE void canvas_raster_fill_polygon(
+    const canvas_point_t* CANVAS_RESTRICT points,
+    size_t count,
+    canvas_fill_rule_t rule,
+    canvas_polygon_edge_t* CANVAS_RESTRICT edges,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    int x_left_i = (int)x_left;
-    int x_right_i = (int)x_right;
-    int y_top_i = (int)y_top;
-    int y_bottom_i = (int)y_bottom;
-
-    int x_diff = x_right_i - x_left_i;
-    int y_diff = y_bottom_i - y_top_i;
-
-    int x_diff_abs = x_diff > 0 ? x_diff : -x_diff;
-    int y_diff_abs = y_diff > 0 ? y_diff : -y_diff;
-
-    int x_start;
-    int x_stop;
-    int y_start;
-    int y_stop;
-
-    if (y_diff_abs < x_diff_abs)
+    // Build the edge table, leaving out horizontal edges, which no row crosses
+    size_t edge_count = 0;
+    for (size_t i = 0; i < count; i++)
     {
-        if (x_left_i > x_right_i)
+        canvas_point_t a = points[i];
+        canvas_point_t b = points[i + 1 < count ? i + 1 : 0];
+        if (a.y == b.y)
         {
-            x_start = x_right;
-            x_stop = x_left;
-            y_start = y_bottom;
-            y_stop = y_top;
+            continue;
         }
-        else
+        canvas_polygon_edge_t *edge = &edges[edge_count++];
+        edge->direction = b.y > a.y ? 1 : -1;
+        if (b.y < a.y)
         {
-            x_start = x_left;
-            x_stop = x_right;
-            y_start = y_top;
-            y_stop = y_bottom;
+            canvas_point_t swap = a; a = b; b = swap;
         }
-        int y_step = y_diff > 0 ? 1 : -1;
-        int error = 2 * y_diff_abs - x_diff;
-        int y = y_start;
-        for (int x = x_start; x < x_stop; x++)
+        edge->y_top = a.y;
+        edge->y_bottom = b.y;
+        edge->y_diff = (int64_t)b.y - a.y;
+        edge->x = a.x;
+        edge->remainder = 0;
+        edge->x_step = canvas_raster_floor_div((int64_t)b.x - a.x, edge->y_diff);
+        edge->remainder_step = ((int64_t)b.x - a.x) - edge->x_step * edge->y_diff;
+    }
+    if (edge_count == 0)
+    {
+        return;
+    }
+    canvas_polygon_sort_edges(edges, edge_count);
+
+    int y_bottom = edges[0].y_bottom;
+    for (size_t i = 1; i < edge_count; i++)
+    {
+        y_bottom = edges[i].y_bottom > y_bottom ? edges[i].y_bottom : y_bottom;
+    }
+
+    canvas_polygon_edge_t *active = NULL;
+    size_t next_edge = 0;
+    for (int y = edges[0].y_top; y < y_bottom; y++)
+    {
+        // Retire edges which ended above this row, and advance the rest to it
+        canvas_polygon_edge_t **link = &active;
+        while (*link)
         {
-            canvas_buffer_set_pixel(buffer, pixel, pixel_size, width, x, y);
-            if (error > 0)
+            canvas_polygon_edge_t *edge = *link;
+            if (edge->y_bottom <= y)
             {
-                y += y_step;
-                error += 2 * (y_diff_abs - x_diff);
+                *link = edge->next;
+                continue;
             }
-            else
+            edge->x += edge->x_step;
+            edge->remainder += edge->remainder_step;
+            if (edge->remainder >= edge->y_diff)
             {
-                error += 2 * y_diff_abs;
+                edge->x++;
+                edge->remainder -= edge->y_diff;
             }
+            link = &edge->next;
         }
-    }
-    else
-    {
-        if (y_top_i > y_bottom_i)
+        if (!active && edges[next_edge].y_top > y)
         {
-            x_start = x_right;
-            x_stop = x_left;
-            y_start = y_bottom;
-            y_stop = y_top;
+            // Skip the rows of a gap between separate parts of the polygon
+            y = edges[next_edge].y_top;
         }
-        else
+
+        // Edges starting on this row join the list, which is then sorted by crossing.
+        // The order barely changes from one row to the next, so insertion sort is close to linear.
+        while (next_edge < edge_count && edges[next_edge].y_top == y)
         {
-            x_start = x_left;
-            x_stop = x_right;
-            y_start = y_top;
-            y_stop = y_bottom;
+            edges[next_edge].next = active;
+            active = &edges[next_edge++];
         }
-        int x_step = x_diff > 0 ? 1 : -1;
-        int error = 2 * x_diff_abs - y_diff;
-        int x = y_start;
-        for (int y = y_start; y < y_stop; y++)
+        canvas_polygon_edge_t *sorted = NULL;
+        while (active)
         {
-            canvas_buffer_set_pixel(buffer, pixel, pixel_size, width, x, y);
-            if (error > 0)
+            canvas_polygon_edge_t *edge = active;
+            active = edge->next;
+            int64_t x = canvas_polygon_edge_x(edge);
+            link = &sorted;
+            while (*link && canvas_polygon_edge_x(*link) <= x)
             {
-                x += x_step;
-                error += 2 * (x_diff_abs - y_diff);
+                link = &(*link)->next;
             }
-            else
+            edge->next = *link;
+            *link = edge;
+        }
+        active = sorted;
+
+        // Walk the crossings from left to right, merging spans which touch
+        int winding = 0;
+        int64_t span_left = 0;
+        int64_t pending_left = 0;
+        int64_t pending_right = 0;
+        bool pending = false;
+        for (canvas_polygon_edge_t *edge = active; edge; edge = edge->next)
+        {
+            bool was_inside = winding != 0;
+            winding = rule == CANVAS_FILL_EVEN_ODD ? winding ^ 1 : winding + edge->direction;
+            bool inside = winding != 0;
+            if (!was_inside && inside)
             {
-                error += 2 * x_diff_abs;
+                span_left = canvas_polygon_edge_x(edge);
+            }
+            else if (was_inside && !inside)
+            {
+                int64_t span_right = canvas_polygon_edge_x(edge);
+                if (span_left >= span_right)
+                {
+                    continue;
+                }
+                if (pending && span_left <= pending_right)
+                {
+                    pending_right = span_right;
+                    continue;
+                }
+                if (pending)
+                {
+                    function(context, (int)pending_left, (int)pending_right, y);
+                }
+                pending = true;
+                pending_left = span_left;
+                pending_right = span_right;
             }
         }
+        if (pending)
+        {
+            function(context, (int)pending_left, (int)pending_right, y);
+        }
     }
 }
 
 /**
- * For internal use.
- *
- * @param a The first candidate
- * @param b The second candidate
- * @param c The third candidate
- *
- * @return The largest of `a`, `b` and `c`.
+ * Shape of the ends of a thick line or polyline.
+ */
+typedef enum canvas_line_cap_t {
+    CANVAS_CAP_BUTT,    /**< The line ends exactly at its end points */
+    CANVAS_CAP_SQUARE,  /**< The line extends past its end points by half its width */
+    CANVAS_CAP_ROUND,   /**< The line ends in a half-disk around each end point */
+} canvas_line_cap_t;
+
+/**
+ * A horizontal run of pixels on one row.
  */
-CANVAS_STATIC_INLINE size_t canvas_buffer_max_of_3(size_t a, size_t b, size_t c)
+typedef struct canvas_interval_t {
+    int x_left;     /**< X-coordinate of the leftmost pixel */
+    int x_right;    /**< X-coordinate of the rightmost pixel, plus 1. */
+} canvas_interval_t;
+
+/**
+ * For internal use. Narrow the span `[*x_left, *x_right)` to the pixels `x` for which `low <= a * x + b < high`.
+ */
+CANVAS_STATIC_INLINE void canvas_raster_clip_linear(double a, double b, double low, double high, int *x_left, int *x_right)
 {
-    size_t r = a;
-    if (b > r)
+    double x_low;
+    double x_high;
+    if (a > 0)
+    {
+        x_low = ceil((low - b) / a);
+        x_high = ceil((high - b) / a);
+    }
+    else if (a < 0)
+    {
+        x_low = floor((high - b) / a) + 1;
+        x_high = floor((low - b) / a) + 1;
+    }
+    else
+    {
+        if (b < low || b >= high)
+        {
+            *x_right = *x_left;
+        }
+        return;
+    }
+    if (x_low > *x_left)
     {
-        r = b;
+        *x_left = x_low < *x_right ? (int)x_low : *x_right;
     }
-    if (c > r)
+    if (x_high < *x_right)
     {
-        r = c;
+        *x_right = x_high > *x_left ? (int)x_high : *x_left;
     }
-    return r;
 }
 
 /**
- * For internal use.
- *
- * @param a The first candidate
- * @param b The second candidate
- * @param c The third candidate
+ * For internal use. Widen the span `[*x_left, *x_right)` to include the pixels on row `y` inside a disk,
+ * unless the span is empty, in which case it is replaced.
+ */
+CANVAS_STATIC_INLINE void canvas_raster_union_disk(double x_center, double y_center, double radius, int y, int *x_left, int *x_right)
+{
+    double dy = y - y_center;
+    double s2 = radius * radius - dy * dy;
+    if (s2 <= 0)
+    {
+        return;
+    }
+    double s = sqrt(s2);
+    int left = (int)ceil(x_center - s);
+    int right = (int)ceil(x_center + s);
+    if (left >= right)
+    {
+        return;
+    }
+    if (*x_left >= *x_right)
+    {
+        *x_left = left;
+        *x_right = right;
+        return;
+    }
+    *x_left = left < *x_left ? left : *x_left;
+    *x_right = right > *x_right ? right : *x_right;
+}
+
+/**
+ * For internal use. The span of a thick line segment on one row. The segment is convex, so it is always one span.
  *
- * @return The smallest of `a`, `b` and `c`.
+ * @param x_0       X-coordinate of the first end point
+ * @param x_1       X-coordinate of the second end point
+ * @param y_0       Y-coordinate of the first end point
+ * @param y_1       Y-coordinate of the second end point
+ * @param width     Width of the line
+ * @param cap_0     Shape of the end at the first end point
+ * @param cap_1     Shape of the end at the second end point
+ * @param y         Y-coordinate of the row
+ * @param x_left    Receives the X-coordinate of the leftmost pixel
+ * @param x_right   Receives the X-coordinate of the rightmost pixel, plus 1. Equal to `x_left` if the row is empty.
  */
-CANVAS_STATIC_INLINE size_t canvas_buffer_min_of_3(size_t a, size_t b, size_t c)
+CANVAS_STATIC_INLINE void canvas_raster_segment_span(
+    int x_0,
+    int x_1,
+    int y_0,
+    int y_1,
+    int width,
+    canvas_line_cap_t cap_0,
+    canvas_line_cap_t cap_1,
+    int y,
+    int *x_left,
+    int *x_right
+)
 {
-    size_t r = a;
-    if (b < r)
+    if (y_0 > y_1 || (y_0 == y_1 && x_0 > x_1))
+    {
+        // Orient the segment consistently, so that which boundary pixels are included doesn't depend on its direction
+        int swap = x_0; x_0 = x_1; x_1 = swap;
+        swap = y_0; y_0 = y_1; y_1 = swap;
+        canvas_line_cap_t cap = cap_0; cap_0 = cap_1; cap_1 = cap;
+    }
+    double half = width / 2.0;
+    int reach = width + 1;
+    *x_left = (x_0 < x_1 ? x_0 : x_1) - reach;
+    *x_right = (x_0 > x_1 ? x_0 : x_1) + reach;
+
+    double dx = x_1 - x_0;
+    double dy = y_1 - y_0;
+    double length_squared = dx * dx + dy * dy;
+    double length = sqrt(length_squared);
+    if (length_squared == 0)
+    {
+        // A single point only has its caps; a square cap is an axis-aligned square
+        if (cap_0 == CANVAS_CAP_SQUARE || cap_1 == CANVAS_CAP_SQUARE)
+        {
+            canvas_raster_clip_linear(1, -x_0, -half, half, x_left, x_right);
+            canvas_raster_clip_linear(0, y - y_0, -half, half, x_left, x_right);
+        }
+        else
+        {
+            *x_right = *x_left;
+        }
+    }
+    else
     {
-        r = b;
+        // Inside the band of the line, measured along its normal...
+        canvas_raster_clip_linear(-dy, dy * x_0 + dx * (y - y_0), -half * length, half * length, x_left, x_right);
+        // ... and between its ends, measured along its direction
+        canvas_raster_clip_linear(
+            dx,
+            -dx * x_0 + dy * (y - y_0),
+            cap_0 == CANVAS_CAP_SQUARE ? -half * length : 0,
+            length_squared + (cap_1 == CANVAS_CAP_SQUARE ? half * length : 0),
+            x_left,
+            x_right
+        );
+    }
+    if (cap_0 == CANVAS_CAP_ROUND)
+    {
+        canvas_raster_union_disk(x_0, y_0, half, y, x_left, x_right);
     }
-    if (c < r)
+    if (cap_1 == CANVAS_CAP_ROUND)
     {
-        r = c;
+        canvas_raster_union_disk(x_1, y_1, half, y, x_left, x_right);
     }
-    return r;
 }
 
 /**
- * For internal use, for calculating whether a point is inside a triangle.
+ * Rasterize a thick line.
  *
- * @param x_a X coordinate of vertex A
- * @param x_b X coordinate of vertex B
- * @param x_c X coordinate of vertex C
- * @param y_a Y coordinate of vertex A
- * @param y_b Y coordinate of vertex B
- * @param y_c Y coordinate of vertex C
+ * @param x_0      X-coordinate of the first end point
+ * @param x_1      X-coordinate of the second end point
+ * @param y_0      Y-coordinate of the first end point
+ * @param y_1      Y-coordinate of the second end point
+ * @param width    Width of the line, in pixels
+ * @param cap      Shape of the ends of the line
+ * @param function Called with each span
+ * @param context  Passed to `function`
  *
- * @return Whether the edge function of the three vertices is smaller then 0.
+ * The line covers the pixels whose coordinates lie within `width / 2` of the segment between the end points,
+ * extended according to `cap`. A horizontal line with butt caps covers `x_0` up to `x_1` like @ref canvas_raster_line.
+ * Each row is emitted as a single span, so every pixel is written once.
  */
-CANVAS_STATIC_INLINE bool canvas_buffer_edge_function(
-    int x_a,
-    int x_b,
-    int x_c,
-    int y_a,
-    int y_b,
-    int y_c
+CANVAS_STATIC_INLINE void canvas_raster_thick_line(
+    int x_0,
+    int x_1,
+    int y_0,
+    int y_1,
+    int width,
+    canvas_line_cap_t cap,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    return ((x_c - x_a) * (y_b - y_a) - (y_c - y_a) * (x_b - x_a)) < 0;
+    int reach = width + 1;
+    int y_top = (y_0 < y_1 ? y_0 : y_1) - reach;
+    int y_bottom = (y_0 > y_1 ? y_0 : y_1) + reach;
+    for (int y = y_top; y < y_bottom; y++)
+    {
+        int x_left, x_right;
+        canvas_raster_segment_span(x_0, x_1, y_0, y_1, width, cap, cap, y, &x_left, &x_right);
+        if (x_left < x_right)
+        {
+            function(context, x_left, x_right, y);
+        }
+    }
 }
 
 /**
- * Place a filled triangle on the canvas
+ * Rasterize a thick polyline: thick line segments joined with round joins.
  *
- * @param[out] buffer      The buffer into which the triangle will be placed
- * @param[in]  pixel       Pixel data for a single pixel. Each pixel inside the triangle will have this pixel value.
- * @param      pixel_size  The size per pixel in bytes
- * @param      width       Width of the canvas
- * @param      x_0         X-coordinate of the first vertex
- * @param      x_1         X-coordinate of the second vertex
- * @param      x_2         X-coordinate of the third vertex
- * @param      y_0         Y-coordinate of the first vertex
- * @param      y_1         Y-coordinate of the second vertex
- * @param      y_2         Y-coordinate of the third vertex
+ * @param points    The points of the polyline, in order
+ * @param count     Number of points
+ * @param width     Width of the line, in pixels
+ * @param cap       Shape of the two ends of the polyline. Ignored if it is closed.
+ * @param closed    Whether to join the last point back to the first, for the outline of a polygon
+ * @param intervals Working memory for `count` intervals
+ * @param function  Called with each span
+ * @param context   Passed to `function`
+ *
+ * The spans of all segments on a row are merged before they are emitted, so every pixel is written once,
+ * also where segments overlap at joins or cross each other.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_fill_triangle(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_0,
-    size_t x_1,
-    size_t x_2,
-    size_t y_0,
-    size_t y_1,
-    size_t y_2
+CANVAS_STATIC_INLINE void canvas_raster_polyline(
+    const canvas_point_t* CANVAS_RESTRICT points,
+    size_t count,
+    int width,
+    canvas_line_cap_t cap,
+    bool closed,
+    canvas_interval_t* CANVAS_RESTRICT intervals,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    size_t x_max = canvas_buffer_max_of_3(x_0, x_1, x_2);
-    size_t x_min = canvas_buffer_min_of_3(x_0, x_1, x_2);
-    size_t y_max = canvas_buffer_max_of_3(y_0, y_1, y_2);
-    size_t y_min = canvas_buffer_min_of_3(y_0, y_1, y_2);
+    if (count == 0)
+    {
+        return;
+    }
+    size_t segment_count = count == 1 ? 1 : closed ? count : count - 1;
+    int reach = width + 1;
+    int y_top = points[0].y;
+    int y_bottom = points[0].y;
+    for (size_t i = 1; i < count; i++)
+    {
+        y_top = points[i].y < y_top ? points[i].y : y_top;
+        y_bottom = points[i].y > y_bottom ? points[i].y : y_bottom;
+    }
 
-    for (size_t y = y_min; y < y_max; y++)
+    for (int y = y_top - reach; y < y_bottom + reach; y++)
     {
-        for (size_t x = x_min; x < x_max; x++)
+        // Gather the span of each segment which reaches this row, sorted by left end
+        size_t interval_count = 0;
+        for (size_t i = 0; i < segment_count; i++)
+        {
+            canvas_point_t a = points[i];
+            canvas_point_t b = points[i + 1 < count ? i + 1 : 0];
+            if (y < (a.y < b.y ? a.y : b.y) - reach || y >= (a.y > b.y ? a.y : b.y) + reach)
+            {
+                continue;
+            }
+            // Inner ends are round, which joins the segments
+            canvas_line_cap_t cap_a = (closed || i > 0) ? CANVAS_CAP_ROUND : cap;
+            canvas_line_cap_t cap_b = (closed || i + 1 < segment_count) ? CANVAS_CAP_ROUND : cap;
+            canvas_interval_t interval;
+            canvas_raster_segment_span(a.x, b.x, a.y, b.y, width, cap_a, cap_b, y, &interval.x_left, &interval.x_right);
+            if (interval.x_left >= interval.x_right)
+            {
+                continue;
+            }
+            size_t j = interval_count++;
+            while (j > 0 && intervals[j - 1].x_left > interval.x_left)
+            {
+                intervals[j] = intervals[j - 1];
+                j--;
+            }
+            intervals[j] = interval;
+        }
+
+        // Merge overlapping and touching spans
+        for (size_t i = 0; i < interval_count; )
         {
-            if (
-                   canvas_buffer_edge_function(x_0, x_1, x, y_0, y_1, y)
-                && canvas_buffer_edge_function(x_1, x_2, x, y_1, y_2, y)
-                && canvas_buffer_edge_function(x_2, x_0, x, y_2, y_0, y)
-            )
+            int x_left = intervals[i].x_left;
+            int x_right = intervals[i].x_right;
+            for (i++; i < interval_count && intervals[i].x_left <= x_right; i++)
             {
-                canvas_buffer_set_pixel(buffer, pixel, pixel_size, width, x, y);
+                x_right = intervals[i].x_right > x_right ? intervals[i].x_right : x_right;
             }
+            function(context, x_left, x_right, y);
         }
     }
 }
 
 /**
- * Place a rectangle into the canvas
+ * Rasterize the edges of a rectangle, with the given width inwards from the sides.
  *
- * @param[out] buffer           The buffer into which the rectangle will be placed
- * @param[in]  pixel            Pixel data for a single pixel. Each pixel on the rectangle edges will have this pixel value.
- * @param      pixel_size       The size per pixel in bytes
- * @param      width            Width of the canvas
- * @param      x_left           X-coordinate of the left side of the rectangle
- * @param      x_right          X-coordinate of the right side of the rectangle (minus 1)
- * @param      y_top            Y-coordinate of the top side of the rectangle
- * @param      y_bottom         Y-coordinate of the bottom side of the rectangle (minus 1)
- *
- * If a filled rectangle is desired, use @ref canvas_buffer_fill_rect.
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param width    Width of the edges, in pixels. A width of 1 is the same as @ref canvas_raster_rect.
+ * @param function Called with each span
+ * @param context  Passed to `function`
  */
-CANVAS_STATIC_INLINE void canvas_buffer_draw_rect(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
+CANVAS_STATIC_INLINE void canvas_raster_thick_rect(
+    int x_left,
+    int x_right,
+    int y_top,
+    int y_bottom,
+    int width,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    canvas_buffer_draw_horizontal_line(buffer, pixel, pixel_size, width, x_left, x_right-1, y_top);
-    canvas_buffer_draw_horizontal_line(buffer, pixel, pixel_size, width, x_left, x_right-1, y_bottom-1);
-    canvas_buffer_draw_vertical_line(buffer, pixel, pixel_size, width, x_left, y_top, y_bottom-1);
-    canvas_buffer_draw_vertical_line(buffer, pixel, pixel_size, width, x_right-1, y_top, y_bottom-1);
+    if (x_left >= x_right || y_top >= y_bottom || width <= 0)
+    {
+        return;
+    }
+    for (int y = y_top; y < y_bottom; y++)
+    {
+        if (y < y_top + width || y >= y_bottom - width || x_right - x_left <= 2 * width)
+        {
+            function(context, x_left, x_right, y);
+        }
+        else
+        {
+            function(context, x_left, x_left + width, y);
+            function(context, x_right - width, x_right, y);
+        }
+    }
 }
 
 /**
- * For internal use, when drawing circles.
+ * For internal use. Integer square root.
  *
- * @param[out] buffer      The buffer into which the pixels will be placed
- * @param[in]  pixel       Pixel data for a single pixel. Each pixel will have this pixel value.
- * @param      pixel_size  The size per pixel in bytes
- * @param      width       Width of the canvas
- * @param      x_center    X-coordinate of the center of the circle
- * @param      y_center    Y-coordinate of the center of the circle
- * @param      x_diff      X-coordinate difference between the center and the point in the second octant, in pixels
- * @param      y_diff      Y-coordinate difference between the center and the point in the second octant, in pixels
+ * @param value A non-negative value
+ *
+ * @return `sqrt(value)`, rounded down
  */
-CANVAS_STATIC_INLINE void canvas_buffer_draw_octants(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_center,
-    size_t y_center,
-    size_t x_diff,
-    size_t y_diff
-)
+CANVAS_STATIC_INLINE int64_t canvas_raster_isqrt(int64_t value)
 {
-    size_t coordinates[8][2] = {
-        { x_center + x_diff, y_center + y_diff },
-        { x_center + x_diff, y_center - y_diff },
-        { x_center + y_diff, y_center + x_diff },
-        { x_center + y_diff, y_center - x_diff },
-        { x_center - x_diff, y_center + y_diff },
-        { x_center - x_diff, y_center - y_diff },
-        { x_center - y_diff, y_center + x_diff },
-        { x_center - y_diff, y_center - x_diff },
-    };
-
-    for (int i = 0; i < 8; i++)
+    int64_t root = (int64_t)sqrt((double)value);
+    while (root * root > value)
     {
-        canvas_buffer_set_pixel(
-            buffer,
-            pixel,
-            pixel_size,
-            width,
-            coordinates[i][0],
-            coordinates[i][1]
-        );
+        root--;
+    }
+    while ((root + 1) * (root + 1) <= value)
+    {
+        root++;
     }
+    return root;
 }
 
 /**
- * For internal use, when drawing filled circles (disks).
+ * Rasterize a thick circle (ring).
  *
- * @param[out] buffer      The buffer into which the pixels will be placed
- * @param[in]  pixel       Pixel data for a single pixel. Each pixel will have this pixel value.
- * @param      pixel_size  The size per pixel in bytes
- * @param      width       Width of the canvas
- * @param      x_center    X-coordinate of the center of the circle
- * @param      y_center    Y-coordinate of the center of the circle
- * @param      x_diff      X-coordinate difference between the center and the point in the second octant, in pixels
- * @param      y_diff      Y-coordinate difference between the center and the point in the second octant, in pixels
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ * @param width    Width of the ring, in pixels, centered on the radius
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * The ring covers the pixels whose distance `d` from the center satisfies `radius - width / 2 <= d < radius + width / 2`,
+ * computed exactly in integers. Each row is emitted as one or two spans, so every pixel is written once.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_fill_octants(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_center,
-    size_t y_center,
-    size_t x_diff,
-    size_t y_diff
+CANVAS_STATIC_INLINE void canvas_raster_thick_circle(
+    int x_center,
+    int y_center,
+    int radius,
+    int width,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    size_t coordinates[8][2] = {
-        { x_center + x_diff, y_center + y_diff },
-        { x_center + x_diff, y_center - y_diff },
-        { x_center + y_diff, y_center + x_diff },
-        { x_center + y_diff, y_center - x_diff },
-        { x_center - x_diff, y_center + y_diff },
-        { x_center - x_diff, y_center - y_diff },
-        { x_center - y_diff, y_center + x_diff },
-        { x_center - y_diff, y_center - x_diff },
-    };
-
-    for (int i = 0; i < 8; i++)
+    // Distances are compared doubled, so that half widths stay integers
+    int64_t outer = (int64_t)(2 * radius + width) * (2 * radius + width);
+    int64_t inner = 2 * radius > width ? (int64_t)(2 * radius - width) * (2 * radius - width) : 0;
+    int reach = radius + width;
+    for (int y = -reach; y <= reach; y++)
     {
-        size_t x = coordinates[i][0];
-        size_t x_max = x > x_center ? x : x_center;
-        size_t x_min = x < x_center ? x : x_center;
-        for (size_t x_i = x_min; x_i <= x_max; x_i++)
-        {
-            canvas_buffer_set_pixel(
-                buffer,
-                pixel,
-                pixel_size,
-                width,
-                x_i,
-                coordinates[i][1]
-            );
+        int64_t outer_left = outer - 4 * (int64_t)y * y;
+        if (outer_left <= 0)
+        {
+            continue;
+        }
+        // Largest x with 4 * (x * x + y * y) < outer, and likewise for the hole
+        int x_outer = (int)(canvas_raster_isqrt(outer_left - 1) / 2);
+        int64_t inner_left = inner - 4 * (int64_t)y * y;
+        if (inner_left <= 0)
+        {
+            function(context, x_center - x_outer, x_center + x_outer + 1, y_center + y);
+            continue;
+        }
+        int x_inner = (int)(canvas_raster_isqrt(inner_left - 1) / 2);
+        if (x_inner < x_outer)
+        {
+            function(context, x_center - x_outer, x_center - x_inner, y_center + y);
+            function(context, x_center + x_inner + 1, x_center + x_outer + 1, y_center + y);
         }
     }
 }
 
+#ifndef CANVAS_CORNER_MAX_RADIUS
+    /** Largest corner radius of a rounded rectangle, in pixels */
+    #define CANVAS_CORNER_MAX_RADIUS 64
+#endif
+
 /**
- * Draw a circle on the canvas
+ * The shape of the corners of a rounded rectangle, as the number of pixels cut off each row of a corner.
  *
- * @param[out] buffer      The buffer into which the circle will be placed
- * @param[in]  pixel       Pixel data for a single pixel. Each pixel will have this pixel value.
- * @param      pixel_size  The size per pixel in bytes
- * @param      width       Width of the canvas
- * @param      x_center    X-coordinate of the center of the circle
- * @param      y_center    Y-coordinate of the center of the circle
- * @param      radius      The radius of the circle
+ * Computing the shape takes a square root per row, so it is done once by @ref canvas_corner_init
+ * and kept for every rectangle with the same radius and edge width, e.g. all buttons of a user interface.
+ */
+typedef struct canvas_corner_t {
+    size_t radius;                              /**< Radius of the corners */
+    size_t width;                               /**< Width of the edges when outlining, or 0 if only used for filling */
+    uint16_t outer[CANVAS_CORNER_MAX_RADIUS];   /**< For each row from the top, number of pixels outside the corner */
+    uint16_t inner[CANVAS_CORNER_MAX_RADIUS];   /**< Likewise for the inside of the edges, for the rows from `width` down */
+} canvas_corner_t;
+
+/**
+ * For internal use. Compute the inset of each row of a corner.
  *
- * For a filled circle (disk), use @ref canvas_buffer_fill_circle.
+ * @param insets Receives the inset of each row
+ * @param radius Radius of the corner
+ *
+ * A pixel is inside the corner if its center is within `radius` of the center of the corner,
+ * compared in integers at twice the resolution.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_draw_circle(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_center,
-    size_t y_center,
-    size_t radius
-)
+CANVAS_STATIC_INLINE void canvas_corner_insets(uint16_t *insets, int64_t radius)
 {
-    // Algorithm due to Stefan Gustavson, "An Efficient Circle Drawing Algorithm", 2003-08-20
-    size_t x = 0;
-    size_t y = radius;
-    int d = 5 - 4 * radius;
-    int da = 12;
-    int db = 20 - 8 * radius;
-    while (x < y)
+    for (int64_t row = 0; row < radius; row++)
     {
-        canvas_buffer_draw_octants(buffer, pixel, pixel_size, width, x_center, y_center, x, y);
-        if (d < 0)
-        {
-            d += da;
-            db += 8;
-        }
-        else
-        {
-            y--;
-            d += db;
-            db += 16;
-        }
-        x++;
-        da += 8;
+        int64_t dy = 2 * radius - 2 * row - 1;
+        int64_t dx = canvas_raster_isqrt(4 * radius * radius - dy * dy);
+        int64_t inset = (2 * radius - 1 - dx + 1) / 2;
+        insets[row] = (uint16_t)(inset > 0 ? inset : 0);
     }
-
-    // The original algorithm doesn't fill the corners; do so here
-    size_t radius_div_sqrt2 = radius * 70 / 99;
-    canvas_buffer_draw_octants(buffer, pixel, pixel_size, width, x_center, y_center, radius_div_sqrt2, radius_div_sqrt2);
 }
 
 /**
- * Draw a filled circle (disk) on the canvas
+ * Compute the shape of the corners of a rounded rectangle.
  *
- * @param[out] buffer      The buffer into which the circle will be placed
- * @param[in]  pixel       Pixel data for a single pixel. Each pixel will have this pixel value.
- * @param      pixel_size  The size per pixel in bytes
- * @param      width       Width of the canvas
- * @param      x_center    X-coordinate of the center of the circle
- * @param      y_center    Y-coordinate of the center of the circle
- * @param      radius      The radius of the circle
+ * @param corner Receives the shape
+ * @param radius Radius of the corners, at most @ref CANVAS_CORNER_MAX_RADIUS
+ * @param width  Width of the edges for @ref canvas_raster_rounded_rect, or 0 if only used for filling
+ *
+ * @return Whether the radius is supported
  */
-CANVAS_STATIC_INLINE void canvas_buffer_fill_circle(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t pixel_size,
-    size_t width,
-    size_t x_center,
-    size_t y_center,
-    size_t radius
-)
+CANVAS_STATIC_INLINE bool canvas_corner_init(canvas_corner_t *corner, size_t radius, size_t width)
 {
-    // Algorithm due to Stefan Gustavson, "An Efficient Circle Drawing Algorithm", 2003-08-20
-    size_t x = 0;
-    size_t y = radius;
-    int d = 5 - 4 * radius;
-    int da = 12;
-    int db = 20 - 8 * radius;
-    while (x < y)
+    if (radius > CANVAS_CORNER_MAX_RADIUS)
     {
-        canvas_buffer_fill_octants(buffer, pixel, pixel_size, width, x_center, y_center, x, y);
-        if (d < 0)
-        {
-            d += da;
-            db += 8;
-        }
-        else
-        {
-            y--;
-            d += db;
-            db += 16;
-        }
-        x++;
-        da += 8;
+        return false;
+    }
+    corner->radius = radius;
+    corner->width = width;
+    canvas_corner_insets(corner->outer, (int64_t)radius);
+    if (width < radius)
+    {
+        canvas_corner_insets(corner->inner, (int64_t)(radius - width));
     }
+    return true;
+}
 
-    // The original algorithm doesn't fill the "corners; do so here"
-    size_t radius_div_sqrt2 = radius * 70 / 99;
-    canvas_buffer_fill_octants(buffer, pixel, pixel_size, width, x_center, y_center, radius_div_sqrt2, radius_div_sqrt2);
+/**
+ * For internal use. The inset of a row of a rounded rectangle.
+ *
+ * @param insets The insets of a corner
+ * @param radius Radius of the corner
+ * @param row    Row from the top of the rectangle
+ * @param height Height of the rectangle
+ */
+CANVAS_STATIC_INLINE int canvas_corner_inset(const uint16_t *insets, int radius, int row, int height)
+{
+    // Rows are counted from the nearest of the top and bottom side
+    int from_edge = row < height - 1 - row ? row : height - 1 - row;
+    return from_edge < radius ? insets[from_edge] : 0;
 }
 
 /**
- * Copy a bitmap into the canvas.
+ * Rasterize a filled rectangle with rounded corners.
  *
- * @param[out] buffer      The buffer into which the bitmap will be placed
- * @param[in]  bitmap      Pixel data for the bitmap
- * @param      pixel_size  The size per pixel in bytes
- * @param      width       Width of the canvas
- * @param      x_left      X-coordinate of the left side of the bitmap (relative to the left side of the canvas)
- * @param      x_right     X-coordinate of the right side of the bitmap (relative to the left side of the canvas)
- * @param      y_top       Y-coordinate of the top side of the bitmap (relative to the top side of the canvas)
- * @param      y_bottom    Y-coordinate of the bottom side of the bitmap (relative to the top side of the canvas)
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param corner   The shape of the corners, from @ref canvas_corner_init
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * Each row is emitted as a single span. The rectangle should be at least twice the radius wide and tall.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap(
-    uint8_t* CANVAS_RESTRICT buffer,
-    const uint8_t* CANVAS_RESTRICT bitmap,
-    size_t pixel_size,
-    size_t width,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
+CANVAS_STATIC_INLINE void canvas_raster_fill_rounded_rect(
+    int x_left,
+    int x_right,
+    int y_top,
+    int y_bottom,
+    const canvas_corner_t *corner,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    size_t width_rect = x_right - x_left;
-
-    size_t offset_top_left = (y_top * width + x_left) * pixel_size;
-    size_t offset_bottom_right = (y_bottom * width + x_right) * pixel_size;
-    size_t offset_from_end_of_row_to_start_of_next = (width - width_rect) * pixel_size;
-
-    size_t offset = offset_top_left;
-    size_t offset_bitmap = 0;
-    while (offset < offset_bottom_right)
+    for (int y = y_top; y < y_bottom; y++)
     {
-        for (size_t i = 0; i < width_rect; i++)
+        int inset = canvas_corner_inset(corner->outer, (int)corner->radius, y - y_top, y_bottom - y_top);
+        if (x_left + inset < x_right - inset)
         {
-            memcpy(buffer + offset, bitmap + offset_bitmap, pixel_size);
-            offset += pixel_size;
-            offset_bitmap += pixel_size;
+            function(context, x_left + inset, x_right - inset, y);
         }
-        offset += offset_from_end_of_row_to_start_of_next;
     }
 }
 
 /**
- * Extract a bitmap from the canvas.
+ * Rasterize the edges of a rectangle with rounded corners, with the given width inwards from the sides.
  *
- * @param[in]  buffer      The buffer from which the bitmap will be extracted
- * @param[out] bitmap      Pixel data for the bitmap will be placed here
- * @param      pixel_size  The size per pixel in bytes
- * @param      width       Width of the canvas
- * @param      x_left      X-coordinate of the left side of the bitmap (relative to the left side of the canvas)
- * @param      x_right     X-coordinate of the right side of the bitmap (relative to the left side of the canvas)
- * @param      y_top       Y-coordinate of the top side of the bitmap (relative to the top side of the canvas)
- * @param      y_bottom    Y-coordinate of the bottom side of the bitmap (relative to the top side of the canvas)
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param corner   The shape of the corners and the width of the edges, from @ref canvas_corner_init
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * The inside of the edges is a rounded rectangle too, with the radius reduced by the width.
+ * Each row is emitted as one or two spans, so every pixel is written once.
  */
-CANVAS_STATIC_INLINE void canvas_buffer_extract_bitmap(
-    const uint8_t* CANVAS_RESTRICT buffer,
-    uint8_t* CANVAS_RESTRICT bitmap,
-    size_t pixel_size,
-    size_t width,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
+CANVAS_STATIC_INLINE void canvas_raster_rounded_rect(
+    int x_left,
+    int x_right,
+    int y_top,
+    int y_bottom,
+    const canvas_corner_t *corner,
+    canvas_span_function_t function,
+    void *context
 )
 {
-    size_t width_rect = x_right - x_left;
-
-    size_t offset_top_left = (y_top * width + x_left) * pixel_size;
-    size_t offset_bottom_right = (y_bottom * width + x_right) * pixel_size;
-    size_t offset_from_end_of_row_to_start_of_next = (width - width_rect) * pixel_size;
-
-    size_t offset = offset_top_left;
-    size_t offset_bitmap = 0;
-    while (offset < offset_bottom_right)
+    int width = (int)corner->width;
+    int inner_radius = corner->radius > corner->width ? (int)(corner->radius - corner->width) : 0;
+    for (int y = y_top; y < y_bottom; y++)
     {
-        for (size_t i = 0; i < width_rect; i++)
+        int outer = canvas_corner_inset(corner->outer, (int)corner->radius, y - y_top, y_bottom - y_top);
+        int left = x_left + outer;
+        int right = x_right - outer;
+        if (left >= right)
+        {
+            continue;
+        }
+        if (y < y_top + width || y >= y_bottom - width)
+        {
+            function(context, left, right, y);
+            continue;
+        }
+        int inner = width + canvas_corner_inset(corner->inner, inner_radius, y - y_top - width, y_bottom - y_top - 2 * width);
+        if (x_left + inner >= x_right - inner)
+        {
+            function(context, left, right, y);
+            continue;
+        }
+        // With no width, or where the edges are thinner than a pixel, a side can be empty
+        int inner_left = x_left + inner > left ? x_left + inner : left;
+        int inner_right = x_right - inner < right ? x_right - inner : right;
+        if (left < inner_left)
+        {
+            function(context, left, inner_left, y);
+        }
+        if (inner_right < right)
         {
-            memcpy(bitmap + offset_bitmap, buffer + offset, pixel_size);
-            offset += pixel_size;
-            offset_bitmap += pixel_size;
+            function(context, inner_right, right, y);
         }
-        offset += offset_from_end_of_row_to_start_of_next;
     }
 }
 
-
 /**
- * Copy a region from one location of the buffer into another
- *
- * @param[in]  buffer           The buffer on which the data will be copied
- * @param      temporary        Temporary buffer to hold a copy of the source region during the transfer.
- *                              It can be discarded after the call.
- * @param      pixel_size       The size per pixel in bytes
- * @param      width            Width of the canvas
- * @param      source_x_left    X-coordinate of the left side of the source region
- * @param      source_x_right   X-coordinate of the right side of the source region
- * @param      source_y_top     Y-coordinate of the top side of the source region
- * @param      source_y_bottom  Y-coordinate of the bottom side of the source region
- * @param      dest_x_left      X-coordinate of the left side of the destination region
- * @param      dest_y_top       Y-coordinate of the top side of the destionation region
+ * For internal use. The unit vector pointing in a direction.
  *
- * @note The temporary buffer must have a capacity of at least `(x_right - x_left) * (y_bottom - y_top) * pixel_size`.
+ * @param angle Direction, in degrees clockwise from the positive X-axis
+ * @param dir_x Receives the X-component
+ * @param dir_y Receives the Y-component
  */
-CANVAS_STATIC_INLINE void canvas_buffer_copy_region(
-    uint8_t* CANVAS_RESTRICT buffer,
-    uint8_t* CANVAS_RESTRICT temporary,
-    size_t pixel_size,
-    size_t width,
-    size_t source_x_left,
-    size_t source_x_right,
-    size_t source_y_top,
-    size_t source_y_bottom,
-    size_t dest_x_left,
-    size_t dest_y_top
-)
+CANVAS_STATIC_INLINE void canvas_raster_direction(double angle, double *dir_x, double *dir_y)
 {
-    canvas_buffer_extract_bitmap(
-        buffer,
-        temporary,
-        pixel_size,
-        width,
-        source_x_left,
-        source_x_right,
-        source_y_top,
-        source_y_bottom
-    );
-    canvas_buffer_place_bitmap(
-        buffer,
-        temporary,
-        pixel_size,
-        width,
-        dest_x_left,
-        dest_x_left + source_x_right - source_x_left,
-        dest_y_top,
-        dest_y_top + source_y_bottom - source_y_top
-    );
+    double radians = angle * (3.14159265358979323846 / 180);
+    *dir_x = cos(radians);
+    *dir_y = sin(radians);
+    // Snap directions along the axes, so that the row and column through the center are split exactly
+    *dir_x = fabs(*dir_x) < 1e-12 ? 0 : *dir_x;
+    *dir_y = fabs(*dir_y) < 1e-12 ? 0 : *dir_y;
 }
 
 /**
- * @}
- */
-
-/**
- * @defgroup CANVAS_API Canvas API
+ * For internal use. Narrow a span to the pixels on one side of a line through the center of an arc.
  *
- * @{
+ * @param dir_x     X-component of the direction of the line, from @ref canvas_raster_direction
+ * @param dir_y     Y-component of the direction of the line
+ * @param clockwise Whether to keep the pixels clockwise of the line, including the line itself,
+ *                  or the pixels counterclockwise of it, excluding the line
+ * @param x_center  X-coordinate of the center
+ * @param dy        Y-coordinate of the row, relative to the center
+ * @param interval  The span to narrow
  */
+CANVAS_STATIC_INLINE void canvas_raster_half_plane(
+    double dir_x,
+    double dir_y,
+    bool clockwise,
+    int x_center,
+    int dy,
+    canvas_interval_t *interval
+)
+{
+    // The cross product of the direction and the pixel, dir_x * dy - dir_y * (x - x_center), is positive clockwise of the line
+    double a = -dir_y;
+    double b = dir_x * dy + dir_y * x_center;
+    canvas_raster_clip_linear(a, b, clockwise ? 0 : -HUGE_VAL, clockwise ? HUGE_VAL : 0, &interval->x_left, &interval->x_right);
+}
 
 /**
- * Holds information about the canvas.
+ * Rasterize a sector of a ring: an arc when the ring is thin, or a pie slice when it has no hole.
  *
- * For the canvas to be valid, it must be a return value from @ref canvas_init,
- * and it must have been passed to @ref canvas_set_memory with a pointer to valid memory.
+ * @param x_center X-coordinate of the center
+ * @param y_center Y-coordinate of the center
+ * @param outer    Pixels are inside if four times the squared distance of their center from `(x_center, y_center)` is below this
+ * @param inner    ... and at least this
+ * @param start    Direction of the start of the sector, in degrees clockwise from the positive X-axis
+ * @param sweep    Angle covered by the sector, in degrees clockwise. 360 or more is the whole ring.
+ * @param function Called with each span
+ * @param context  Passed to `function`
  */
-typedef struct canvas_t {
-    size_t width;           /**< Width of the canvas, in number of pixels */
-    size_t height;          /**< Height of the canvas, in number of pixels */
-    size_t pixel_size;      /**< Number of bytes per pixel */
-    size_t buffer_size;     /**< Size of the buffer, in bytes. */
-    size_t alloc_size;      /**< Number of bytes that must be allocated for the buffer provided in @ref canvas_set_memory */
-    uint8_t *buffer;        /**< The buffer that currently holds valid data. */
-    #if CANVAS_FEATURE_TWO_BUFFERS
-        uint8_t *_temp_buffer;  /**< Internal. A secondary buffer used to hold temporary data during certain actions such as canvas rotations. Exists only if @ref CANVAS_FEATURE_TWO_BUFFERS=1 */
-        bool _swapped;          /**< Internal. Whether the primary and secondary buffer have been swapped. Exists only if @ref CANVAS_FEATURE_TWO_BUFFERS=1 */
-    #endif
-} canvas_t;
+CANVAS_STATIC_INLINE void canvas_raster_ring_sector(
+    int x_center,
+    int y_center,
+    int64_t outer,
+    int64_t inner,
+    double start,
+    double sweep,
+    canvas_span_function_t function,
+    void *context
+)
+{
+    if (sweep <= 0)
+    {
+        return;
+    }
+    // The directions of the two sides are the same on every row
+    double start_x, start_y, end_x, end_y;
+    canvas_raster_direction(start, &start_x, &start_y);
+    canvas_raster_direction(start + sweep, &end_x, &end_y);
+    int reach = (int)(canvas_raster_isqrt(outer) / 2) + 1;
+    for (int dy = -reach; dy <= reach; dy++)
+    {
+        int64_t outer_left = outer - 4 * (int64_t)dy * dy;
+        if (outer_left <= 0)
+        {
+            continue;
+        }
+        int x_outer = (int)(canvas_raster_isqrt(outer_left - 1) / 2);
+        int64_t inner_left = inner - 4 * (int64_t)dy * dy;
+        int x_inner = inner_left > 0 ? (int)(canvas_raster_isqrt(inner_left - 1) / 2) : -1;
 
-#if CANVAS_FEATURE_TWO_BUFFERS
+        // The ring on this row, as up to two spans
+        canvas_interval_t ring[2] = {
+            { x_center - x_outer, x_center - x_inner },
+            { x_center + x_inner + 1, x_center + x_outer + 1 },
+        };
+        if (x_inner < 0)
+        {
+            ring[0].x_right = ring[1].x_right;
+            ring[1].x_left = ring[1].x_right;
+        }
+
+        // The sector on this row, as up to two spans: the pixels clockwise from the start and counterclockwise from the end.
+        // Both hold up to half a turn; a larger sweep takes either, a smaller one both.
+        canvas_interval_t sector[2] = { { ring[0].x_left, ring[1].x_right }, { 0, 0 } };
+        size_t sector_count = 1;
+        if (sweep < 360)
+        {
+            canvas_interval_t from_start = sector[0];
+            canvas_interval_t to_end = sector[0];
+            canvas_raster_half_plane(start_x, start_y, true, x_center, dy, &from_start);
+            canvas_raster_half_plane(end_x, end_y, false, x_center, dy, &to_end);
+            if (sweep <= 180)
+            {
+                sector[0].x_left = from_start.x_left > to_end.x_left ? from_start.x_left : to_end.x_left;
+                sector[0].x_right = from_start.x_right < to_end.x_right ? from_start.x_right : to_end.x_right;
+            }
+            else if (from_start.x_left >= from_start.x_right || to_end.x_left >= to_end.x_right)
+            {
+                sector[0] = from_start.x_left < from_start.x_right ? from_start : to_end;
+            }
+            else
+            {
+                // Sort the two, and merge them if they overlap
+                bool start_first = from_start.x_left <= to_end.x_left;
+                sector[0] = start_first ? from_start : to_end;
+                sector[1] = start_first ? to_end : from_start;
+                if (sector[1].x_left <= sector[0].x_right)
+                {
+                    sector[0].x_right = sector[1].x_right > sector[0].x_right ? sector[1].x_right : sector[0].x_right;
+                }
+                else
+                {
+                    sector_count = 2;
+                }
+            }
+        }
+
+        // Intersect the two. Both are sorted and disjoint, so the results come out sorted.
+        canvas_interval_t pending = { 0, 0 };
+        for (size_t i = 0; i < sector_count; i++)
+        {
+            for (size_t j = 0; j < 2; j++)
+            {
+                int x_left = sector[i].x_left > ring[j].x_left ? sector[i].x_left : ring[j].x_left;
+                int x_right = sector[i].x_right < ring[j].x_right ? sector[i].x_right : ring[j].x_right;
+                if (x_left >= x_right)
+                {
+                    continue;
+                }
+                if (pending.x_left < pending.x_right && x_left <= pending.x_right)
+                {
+                    pending.x_right = x_right > pending.x_right ? x_right : pending.x_right;
+                    continue;
+                }
+                if (pending.x_left < pending.x_right)
+                {
+                    function(context, pending.x_left, pending.x_right, y_center + dy);
+                }
+                pending.x_left = x_left;
+                pending.x_right = x_right;
+            }
+        }
+        if (pending.x_left < pending.x_right)
+        {
+            function(context, pending.x_left, pending.x_right, y_center + dy);
+        }
+    }
+}
+
+/**
+ * Rasterize an arc: a part of a thick circle (see @ref canvas_raster_thick_circle).
+ *
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ * @param width    Width of the arc, in pixels, centered on the radius
+ * @param start    Direction of the start of the arc, in degrees clockwise from the positive X-axis; -90 is straight up
+ * @param sweep    Angle covered by the arc, in degrees clockwise
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * Pixels on the line from the center towards `start` are included and those towards `start + sweep` are not,
+ * so arcs which continue each other don't overlap. Every pixel is emitted once.
+ */
+CANVAS_STATIC_INLINE void canvas_raster_arc(
+    int x_center,
+    int y_center,
+    int radius,
+    int width,
+    double start,
+    double sweep,
+    canvas_span_function_t function,
+    void *context
+)
+{
+    int64_t outer = (int64_t)(2 * radius + width) * (2 * radius + width);
+    int64_t inner = 2 * radius > width ? (int64_t)(2 * radius - width) * (2 * radius - width) : 0;
+    canvas_raster_ring_sector(x_center, y_center, outer, inner, start, sweep, function, context);
+}
+
+/**
+ * Rasterize a pie slice: a part of a disk.
+ *
+ * @param x_center X-coordinate of the center of the disk
+ * @param y_center Y-coordinate of the center of the disk
+ * @param radius   The radius of the disk
+ * @param start    Direction of the start of the slice, in degrees clockwise from the positive X-axis; -90 is straight up
+ * @param sweep    Angle covered by the slice, in degrees clockwise
+ * @param function Called with each span
+ * @param context  Passed to `function`
+ *
+ * Covers the pixels within `radius` of the center, split along the lines like @ref canvas_raster_arc.
+ */
+CANVAS_STATIC_INLINE void canvas_raster_fill_pie(
+    int x_center,
+    int y_center,
+    int radius,
+    double start,
+    double sweep,
+    canvas_span_function_t function,
+    void *context
+)
+{
+    canvas_raster_ring_sector(x_center, y_center, 4 * (int64_t)radius * radius + 1, 0, start, sweep, function, context);
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup KERNELS Kernels
+ *
+ * The inner loops of the buffer functions: filling a run of pixels, copying a run of bytes,
+ * expanding palette indices and moving every pixel of a buffer to its rotated or flipped place.
+ * Each kernel has a portable version, which the buffer functions call directly.
+ * Fills and copies of @ref CANVAS_STREAM_THRESHOLD bytes or more use streaming variants, which bypass the cache on x86
+ * if @ref CANVAS_FEATURE_STREAM_STORES=1, and are the plain kernels otherwise.
+ *
+ * With `CANVAS_FEATURE_DISPATCH`, the buffer functions call them through a @ref canvas_kernels_t table instead,
+ * picked for the CPU the first time it is needed. On x86 with GCC or Clang there are tables for AVX2 and for
+ * AVX-512 next to the portable one. They hold the same portable kernels compiled again with `target` attributes,
+ * not hand-written intrinsics, so they gain what the compiler vectorizes with the wider registers, mostly in the
+ * fills and copies, and a binary built for the baseline instruction set still gets that where the CPU has it.
+ * The portable table is always available, as the fallback.
+ * The choice can be overridden with the `CANVAS_KERNELS` environment variable or with @ref canvas_kernels_select,
+ * e.g. to compare the paths or to rule one out while hunting a bug.
+ *
+ * The table is looked up once per buffer function call, not once per row, and runs shorter than
+ * @ref CANVAS_KERNEL_DISPATCH_SIZE, such as most spans from the rasterizers, skip it and use the portable kernel.
+ * Like everything else in this header, the selection lives in static variables, so each translation unit
+ * that includes canvas.h makes its own selection on first use, and @ref canvas_kernels_select only affects
+ * the translation unit it is called from.
+ *
+ * @{
+ */
+
+#if defined(__GNUC__)
+    #define CANVAS_KERNEL_INLINE CANVAS_STATIC_INLINE __attribute__((always_inline))
+#else
+    #define CANVAS_KERNEL_INLINE CANVAS_STATIC_INLINE
+#endif
+
+/**
+ * Size in bytes of the blocks that @ref canvas_kernel_fill stores at once.
+ * A multiple of 2, 3 and 4 bytes, so whole blocks can be stored for the common pixel sizes.
+ */
+#ifndef CANVAS_KERNEL_BLOCK_SIZE
+    #define CANVAS_KERNEL_BLOCK_SIZE 192
+#endif
+
+#if defined(__GNUC__)
     /**
-     * Only intended for internal use.
-     *
-     * Swap the primary and secondary buffers so that the primary buffer holds
-     *
-     * @param cv Canvas
+     * For internal use. Part of a fill block, as a vector which the compiler stores with one instruction
+     * where the instruction set has 32-byte registers and with two 16-byte stores otherwise.
+     * Plain copies of the same size are split into 16-byte moves by some compilers regardless.
      */
-    CANVAS_STATIC_INLINE void canvas_swap_buffers(canvas_t *cv)
+    typedef uint8_t canvas_kernel_vector_t __attribute__((vector_size(32), aligned(1), may_alias));
+#endif
+
+/**
+ * For internal use. Run the statements in `...` with `name` defined as `size`, specialised for the common pixel sizes.
+ *
+ * Copies of a constant size compile to single loads and stores, so each of the sizes 1 to 4 gets its own copy
+ * of the statements, in which `name` is a constant. Other sizes share one copy with the size as a variable,
+ * so `size` must not refer to a variable called `name`.
+ */
+#define CANVAS_KERNEL_SIZE_SWITCH(size, name, ...) \
+    switch (size) \
+    { \
+        case 1: { const size_t name = 1; __VA_ARGS__ } break; \
+        case 2: { const size_t name = 2; __VA_ARGS__ } break; \
+        case 3: { const size_t name = 3; __VA_ARGS__ } break; \
+        case 4: { const size_t name = 4; __VA_ARGS__ } break; \
+        default: { const size_t name = (size); __VA_ARGS__ } break; \
+    }
+
+/**
+ * Fill a run of pixels with one pixel value.
+ *
+ * @param[out] destination      The first pixel of the run
+ * @param[in]  pixel            Data for the pixel
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      count            Number of pixels in the run
+ */
+CANVAS_KERNEL_INLINE void canvas_kernel_fill(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t count
+)
+{
+    if (pixel_size == 1)
     {
-        size_t buffer_size = cv->buffer_size;
-        if (cv->_swapped)
+        memset(destination, pixel[0], count);
+        return;
+    }
+    size_t size = count * pixel_size;
+    if (size >= CANVAS_KERNEL_BLOCK_SIZE)
+    {
+        // Repeat the pixel across a block and store whole blocks.
+        // Copies of a fixed size compile to the widest stores of the instruction set the kernel is compiled for.
+        uint8_t block[CANVAS_KERNEL_BLOCK_SIZE];
+        size_t block_size = CANVAS_KERNEL_BLOCK_SIZE - CANVAS_KERNEL_BLOCK_SIZE % pixel_size;
+        for (size_t i = 0; i < block_size; i += pixel_size)
         {
-            cv->buffer -= buffer_size;
-            cv->_temp_buffer += buffer_size;
+            memcpy(block + i, pixel, pixel_size);
         }
-        else
+        if (block_size == CANVAS_KERNEL_BLOCK_SIZE)
         {
-            cv->buffer += buffer_size;
-            cv->_temp_buffer -= buffer_size;
+            for (; size >= CANVAS_KERNEL_BLOCK_SIZE; size -= CANVAS_KERNEL_BLOCK_SIZE)
+            {
+                #if defined(__GNUC__)
+                    for (size_t i = 0; i < CANVAS_KERNEL_BLOCK_SIZE / sizeof(canvas_kernel_vector_t); i++)
+                    {
+                        ((canvas_kernel_vector_t *)destination)[i] = ((const canvas_kernel_vector_t *)block)[i];
+                    }
+                #else
+                    memcpy(destination, block, CANVAS_KERNEL_BLOCK_SIZE);
+                #endif
+                destination += CANVAS_KERNEL_BLOCK_SIZE;
+            }
         }
-        cv->_swapped = !cv->_swapped;
+        for (; size >= block_size; size -= block_size)
+        {
+            memcpy(destination, block, block_size);
+            destination += block_size;
+        }
+        memcpy(destination, block, size);
+        return;
+    }
+    for (size_t i = 0; i < size; i += pixel_size)
+    {
+        memcpy(destination + i, pixel, pixel_size);
+    }
+}
+
+/**
+ * Copy a run of bytes, e.g. one row of a bitmap.
+ *
+ * @param[out] destination      Where the bytes will be placed
+ * @param[in]  source           Where the bytes come from
+ * @param      size             Number of bytes
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_KERNEL_INLINE void canvas_kernel_copy(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t size
+)
+{
+    memcpy(destination, source, size);
+}
+
+/**
+ * Size in bytes from which @ref canvas_buffer_fill_stride and @ref canvas_buffer_place_bitmap_stride write with streaming stores.
+ *
+ * Streaming stores go to memory without first pulling the destination into the cache, so filling or copying
+ * a large frame doesn't evict the data of everything else running on the machine. Below the threshold
+ * the frame is likely to be read again soon, e.g. to draw over it, and is better off in the cache.
+ * The size is that of the whole call, not of one row. Define as `SIZE_MAX` to never stream.
+ * Only has an effect if @ref CANVAS_FEATURE_STREAM_STORES=1, which also brings in `<emmintrin.h>` on x86.
+ */
+#ifndef CANVAS_STREAM_THRESHOLD
+    #define CANVAS_STREAM_THRESHOLD (4 * 1024 * 1024)
+#endif
+
+/**
+ * Fill a run of pixels with one pixel value, using streaming stores where the CPU has them.
+ *
+ * @param[out] destination      The first pixel of the run
+ * @param[in]  pixel            Data for the pixel
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      count            Number of pixels in the run
+ *
+ * Must be followed by @ref canvas_kernel_stream_fence before the pixels are handed to another thread.
+ */
+CANVAS_KERNEL_INLINE void canvas_kernel_stream_fill(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t count
+)
+{
+    #if CANVAS_STREAM_STORES
+        size_t size = count * pixel_size;
+        // A block of three 16-byte vectors holds a whole number of pixels of the common sizes
+        if (size >= 64 && 48 % pixel_size == 0)
+        {
+            // Streaming stores must be aligned, so whole pixels are stored normally up to the first aligned address,
+            // and the block starts partway into a pixel to continue from there
+            size_t head = (16 - (uintptr_t)destination % 16) % 16;
+            canvas_kernel_fill(destination, pixel, pixel_size, (head + pixel_size - 1) / pixel_size);
+            uint8_t block[48];
+            for (size_t i = 0; i < 48; i++)
+            {
+                block[i] = pixel[(head + i) % pixel_size];
+            }
+            __m128i vector_0 = _mm_loadu_si128((const __m128i *)block);
+            __m128i vector_1 = _mm_loadu_si128((const __m128i *)(block + 16));
+            __m128i vector_2 = _mm_loadu_si128((const __m128i *)(block + 32));
+            destination += head;
+            size -= head;
+            for (; size >= 48; size -= 48)
+            {
+                _mm_stream_si128((__m128i *)destination, vector_0);
+                _mm_stream_si128((__m128i *)(destination + 16), vector_1);
+                _mm_stream_si128((__m128i *)(destination + 32), vector_2);
+                destination += 48;
+            }
+            memcpy(destination, block, size);
+            return;
+        }
+    #endif
+    canvas_kernel_fill(destination, pixel, pixel_size, count);
+}
+
+/**
+ * Copy a run of bytes, using streaming stores where the CPU has them.
+ *
+ * @param[out] destination      Where the bytes will be placed
+ * @param[in]  source           Where the bytes come from
+ * @param      size             Number of bytes
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ *
+ * Must be followed by @ref canvas_kernel_stream_fence before the bytes are handed to another thread.
+ */
+CANVAS_KERNEL_INLINE void canvas_kernel_stream_copy(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t size
+)
+{
+    #if CANVAS_STREAM_STORES
+        if (size >= 64)
+        {
+            size_t head = (16 - (uintptr_t)destination % 16) % 16;
+            memcpy(destination, source, head);
+            destination += head;
+            source += head;
+            size -= head;
+            for (; size >= 64; size -= 64)
+            {
+                __m128i vector_0 = _mm_loadu_si128((const __m128i *)source);
+                __m128i vector_1 = _mm_loadu_si128((const __m128i *)(source + 16));
+                __m128i vector_2 = _mm_loadu_si128((const __m128i *)(source + 32));
+                __m128i vector_3 = _mm_loadu_si128((const __m128i *)(source + 48));
+                _mm_stream_si128((__m128i *)destination, vector_0);
+                _mm_stream_si128((__m128i *)(destination + 16), vector_1);
+                _mm_stream_si128((__m128i *)(destination + 32), vector_2);
+                _mm_stream_si128((__m128i *)(destination + 48), vector_3);
+                destination += 64;
+                source += 64;
+            }
+        }
+    #endif
+    memcpy(destination, source, size);
+}
+
+/**
+ * Order streaming stores before the stores that follow, so that another thread which sees those,
+ * e.g. a present thread woken up for the frame, also sees the streamed pixels.
+ */
+CANVAS_STATIC_INLINE void canvas_kernel_stream_fence(void)
+{
+    #if CANVAS_STREAM_STORES
+        _mm_sfence();
+    #endif
+}
+
+/**
+ * Expand palette indices into pixels. See @ref canvas_buffer_expand_indexed.
+ */
+CANVAS_KERNEL_INLINE void canvas_kernel_expand_indexed(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    const uint8_t* CANVAS_RESTRICT colors,
+    size_t color_size,
+    size_t count
+)
+{
+    CANVAS_KERNEL_SIZE_SWITCH(color_size, size,
+        for (size_t i = 0; i < count; i++)
+        {
+            memcpy(destination + i * size, colors + source[i] * size, size);
+        }
+    )
+}
+
+/**
+ * Move every pixel of a buffer to a new place, for the rotations and flips.
+ *
+ * @param[out] destination      Destination buffer
+ * @param[in]  source           Source buffer
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next, in both buffers
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ * @param      origin           Offset in bytes into `destination` where the source pixel at (0, 0) goes
+ * @param      x_step           Offset in bytes in `destination` between source pixels that are next to each other on a row
+ * @param      y_step           Offset in bytes in `destination` between source pixels that are above each other
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_KERNEL_INLINE void canvas_kernel_transform(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height,
+    ptrdiff_t origin,
+    ptrdiff_t x_step,
+    ptrdiff_t y_step
+)
+{
+    for (size_t y = 0; y < height; y++)
+    {
+        const uint8_t *source_row = source + y * stride;
+        uint8_t *destination_row = destination + origin + (ptrdiff_t)y * y_step;
+        CANVAS_KERNEL_SIZE_SWITCH(pixel_size, size,
+            for (size_t x = 0; x < width; x++)
+            {
+                memcpy(destination_row + (ptrdiff_t)x * x_step, source_row + x * size, size);
+            }
+        )
+    }
+}
+
+#if CANVAS_FEATURE_DISPATCH
+
+/**
+ * A set of kernels compiled for one instruction set.
+ */
+typedef struct canvas_kernels_t
+{
+    const char *name;   /**< Name of the set, as accepted by @ref canvas_kernels_select: "scalar", "avx2" or "avx512" */
+
+    /** See @ref canvas_kernel_fill */
+    void (*fill)(uint8_t *destination, const uint8_t *pixel, size_t pixel_size, size_t count);
+    /** See @ref canvas_kernel_copy */
+    void (*copy)(uint8_t *destination, const uint8_t *source, size_t size);
+    /** See @ref canvas_kernel_stream_fill */
+    void (*stream_fill)(uint8_t *destination, const uint8_t *pixel, size_t pixel_size, size_t count);
+    /** See @ref canvas_kernel_stream_copy */
+    void (*stream_copy)(uint8_t *destination, const uint8_t *source, size_t size);
+    /** See @ref canvas_kernel_expand_indexed */
+    void (*expand_indexed)(uint8_t *destination, const uint8_t *source, const uint8_t *colors, size_t color_size, size_t count);
+    /** See @ref canvas_kernel_transform */
+    void (*transform)(
+        uint8_t *destination,
+        const uint8_t *source,
+        size_t pixel_size,
+        size_t stride,
+        size_t width,
+        size_t height,
+        ptrdiff_t origin,
+        ptrdiff_t x_step,
+        ptrdiff_t y_step
+    );
+} canvas_kernels_t;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define CANVAS_KERNELS_X86 1
+#else
+    #define CANVAS_KERNELS_X86 0
+#endif
+
+/**
+ * For internal use. Compile the portable kernels again for the instruction set `isa`,
+ * as functions with `suffix` appended to their names.
+ */
+#define CANVAS_KERNELS_DEFINE(suffix, isa) \
+    __attribute__((target(isa))) static void canvas_kernel_fill_##suffix( \
+        uint8_t *destination, const uint8_t *pixel, size_t pixel_size, size_t count) \
+    { \
+        canvas_kernel_fill(destination, pixel, pixel_size, count); \
+    } \
+    __attribute__((target(isa))) static void canvas_kernel_copy_##suffix( \
+        uint8_t *destination, const uint8_t *source, size_t size) \
+    { \
+        canvas_kernel_copy(destination, source, size); \
+    } \
+    __attribute__((target(isa))) static void canvas_kernel_stream_fill_##suffix( \
+        uint8_t *destination, const uint8_t *pixel, size_t pixel_size, size_t count) \
+    { \
+        canvas_kernel_stream_fill(destination, pixel, pixel_size, count); \
+    } \
+    __attribute__((target(isa))) static void canvas_kernel_stream_copy_##suffix( \
+        uint8_t *destination, const uint8_t *source, size_t size) \
+    { \
+        canvas_kernel_stream_copy(destination, source, size); \
+    } \
+    __attribute__((target(isa))) static void canvas_kernel_expand_indexed_##suffix( \
+        uint8_t *destination, const uint8_t *source, const uint8_t *colors, size_t color_size, size_t count) \
+    { \
+        canvas_kernel_expand_indexed(destination, source, colors, color_size, count); \
+    } \
+    __attribute__((target(isa))) static void canvas_kernel_transform_##suffix( \
+        uint8_t *destination, const uint8_t *source, size_t pixel_size, size_t stride, size_t width, size_t height, \
+        ptrdiff_t origin, ptrdiff_t x_step, ptrdiff_t y_step) \
+    { \
+        canvas_kernel_transform(destination, source, pixel_size, stride, width, height, origin, x_step, y_step); \
+    }
+
+#if CANVAS_KERNELS_X86
+    CANVAS_KERNELS_DEFINE(avx2, "avx2")
+    CANVAS_KERNELS_DEFINE(avx512, "avx512f,avx512bw")
+#endif
+
+/**
+ * Look up a set of kernels by name.
+ *
+ * @param name The name of the set: "scalar", "avx2" or "avx512"
+ *
+ * @returns The set, or `NULL` if there is no set of that name in this build or the CPU can't run it
+ */
+CANVAS_STATIC_INLINE const canvas_kernels_t *canvas_kernels_find(const char *name)
+{
+    static const canvas_kernels_t scalar = {
+        "scalar",
+        canvas_kernel_fill,
+        canvas_kernel_copy,
+        canvas_kernel_stream_fill,
+        canvas_kernel_stream_copy,
+        canvas_kernel_expand_indexed,
+        canvas_kernel_transform
+    };
+    if (strcmp(name, scalar.name) == 0)
+    {
+        return &scalar;
+    }
+    #if CANVAS_KERNELS_X86
+        static const canvas_kernels_t avx2 = {
+            "avx2",
+            canvas_kernel_fill_avx2,
+            canvas_kernel_copy_avx2,
+            canvas_kernel_stream_fill_avx2,
+            canvas_kernel_stream_copy_avx2,
+            canvas_kernel_expand_indexed_avx2,
+            canvas_kernel_transform_avx2
+        };
+        static const canvas_kernels_t avx512 = {
+            "avx512",
+            canvas_kernel_fill_avx512,
+            canvas_kernel_copy_avx512,
+            canvas_kernel_stream_fill_avx512,
+            canvas_kernel_stream_copy_avx512,
+            canvas_kernel_expand_indexed_avx512,
+            canvas_kernel_transform_avx512
+        };
+        __builtin_cpu_init();
+        if (strcmp(name, avx2.name) == 0 && __builtin_cpu_supports("avx2"))
+        {
+            return &avx2;
+        }
+        if (strcmp(name, avx512.name) == 0 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        {
+            return &avx512;
+        }
+    #endif
+    return NULL;
+}
+
+/**
+ * For internal use. The selected set of kernels, or `NULL` before the first use.
+ */
+CANVAS_STATIC_INLINE const canvas_kernels_t **canvas_kernels_selected(void)
+{
+    static const canvas_kernels_t *selected = NULL;
+    return &selected;
+}
+
+/**
+ * Choose the set of kernels used by the buffer functions.
+ *
+ * @param name The name of the set: "scalar", "avx2" or "avx512",
+ *             or `NULL` to pick the widest set the CPU can run, unless the `CANVAS_KERNELS` environment variable names another
+ *
+ * @returns `false`, leaving the choice unchanged, if `name` is not a set in this build or the CPU can't run it
+ *
+ * The choice applies to the translation unit it is made in, as each one has its own copy of the library.
+ * It should be made before any other thread draws.
+ */
+CANVAS_STATIC_INLINE bool canvas_kernels_select(const char *name)
+{
+    const canvas_kernels_t *kernels = NULL;
+    if (name)
+    {
+        kernels = canvas_kernels_find(name);
+        if (!kernels)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        const char *override = getenv("CANVAS_KERNELS");
+        if (override)
+        {
+            kernels = canvas_kernels_find(override);
+        }
+        // An override the CPU can't run is ignored rather than trusted
+        static const char *const names[] = {"avx512", "avx2", "scalar"};
+        for (size_t i = 0; !kernels; i++)
+        {
+            kernels = canvas_kernels_find(names[i]);
+        }
+    }
+    #if defined(__GNUC__)
+        __atomic_store_n(canvas_kernels_selected(), kernels, __ATOMIC_RELEASE);
+    #else
+        *canvas_kernels_selected() = kernels;
+    #endif
+    return true;
+}
+
+/**
+ * The set of kernels used by the buffer functions. Picked with @ref canvas_kernels_select on first use.
+ */
+CANVAS_STATIC_INLINE const canvas_kernels_t *canvas_kernels(void)
+{
+    #if defined(__GNUC__)
+        const canvas_kernels_t *kernels = __atomic_load_n(canvas_kernels_selected(), __ATOMIC_ACQUIRE);
+    #else
+        const canvas_kernels_t *kernels = *canvas_kernels_selected();
+    #endif
+    if (!kernels)
+    {
+        // Threads racing here all pick the same set
+        canvas_kernels_select(NULL);
+        return canvas_kernels();
+    }
+    return kernels;
+}
+
+/**
+ * For internal use. Look up the selected set of kernels for the rest of the function. Must come before
+ * @ref CANVAS_KERNEL, and belongs outside any loops, so that an operation looks the set up only once.
+ */
+#define CANVAS_KERNELS_LOAD() const canvas_kernels_t *canvas_kernels_loaded = canvas_kernels()
+
+/**
+ * For internal use. The kernel `name` of the set looked up by @ref CANVAS_KERNELS_LOAD.
+ */
+#define CANVAS_KERNEL(name) (canvas_kernels_loaded->name)
+
+#else
+
+#define CANVAS_KERNELS_LOAD() (void)0
+
+#define CANVAS_KERNEL(name) canvas_kernel_##name
+
+#endif
+
+/**
+ * Runs shorter than this many bytes are filled with the portable kernel even with `CANVAS_FEATURE_DISPATCH`,
+ * as wider vectors gain too little on them to pay for the table lookup and the indirect call.
+ */
+#ifndef CANVAS_KERNEL_DISPATCH_SIZE
+    #define CANVAS_KERNEL_DISPATCH_SIZE 256
+#endif
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup BUFFER_API Buffer API
+ *
+ * @{
+ */
+
+/**
+ * Set a single pixel value in the buffer
+ *
+ * @param[out] buffer           The buffer in which to place the pixel
+ * @param[in]  pixel            Data for the pixel
+ * @param[in]  pixel_size       The size per pixel in bytes
+ * @param[in]  stride           Number of bytes from the start of one row to the start of the next
+ * @param[in]  x                X coordinate in pixels
+ * @param[in]  y                Y cooridnate in pixels
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_set_pixel_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t x,
+    size_t y
+)
+{
+    size_t offset = y * stride + x * pixel_size;
+    memcpy(buffer + offset, pixel, pixel_size);
+}
+
+/**
+ * Set a single pixel value in the buffer
+ *
+ * @param[out] buffer           The buffer in which to place the pixel
+ * @param[in]  pixel            Data for the pixel
+ * @param[in]  pixel_size       The size per pixel in bytes
+ * @param[in]  width            The width of the canvas in pixels
+ * @param[in]  x                X coordinate in pixels
+ * @param[in]  y                Y cooridnate in pixels
+ *
+ * Equivalent to canvas_buffer_set_pixel_stride() on a canvas with packed rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_set_pixel(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x,
+    size_t y
+)
+{
+    canvas_buffer_set_pixel_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        x,
+        y
+    );
+}
+
+/**
+ * Fill the entire canvas with one pixel value
+ *
+ * @param[out] buffer           The buffer of data to fill
+ * @param[in]  pixel            Data for the pixel
+ * @param[in]  pixel_size       The size per pixel in bytes
+ * @param[in]  stride           Number of bytes from the start of one row to the start of the next
+ * @param[in]  width            Width of the canvas
+ * @param[in]  height           Height of the canvas
+ *
+ * Padding at the end of each row is left untouched.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height
+)
+{
+    CANVAS_KERNELS_LOAD();
+    bool stream = width * height * pixel_size >= CANVAS_STREAM_THRESHOLD;
+    if (stride == width * pixel_size)
+    {
+        // No padding, so the rows can be filled as one
+        width *= height;
+        height = 1;
+    }
+    for (size_t y = 0; y < height; y++)
+    {
+        if (stream)
+        {
+            CANVAS_KERNEL(stream_fill)(buffer + y * stride, pixel, pixel_size, width);
+        }
+        else
+        {
+            CANVAS_KERNEL(fill)(buffer + y * stride, pixel, pixel_size, width);
+        }
+    }
+    if (stream)
+    {
+        canvas_kernel_stream_fence();
+    }
+}
+
+/**
+ * Fill the entire canvas with one pixel value
+ *
+ * @param[out] buffer           The buffer of data to fill
+ * @param[in]  pixel            Data for the pixel
+ * @param[in]  pixel_size       The size per pixel in bytes
+ * @param[in]  memory_size      The total memory size of the canvas in bytes
+ *
+ * Equivalent to canvas_buffer_fill_stride() on a canvas with packed rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t memory_size
+)
+{
+    canvas_buffer_fill_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        memory_size,
+        memory_size / pixel_size,
+        1
+    );
+}
+
+/**
+ * Rotate the canvas 90 degrees clockwise
+ *
+ * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next, in both buffers
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ *       The rotated canvas is `height` pixels wide and `width` pixels tall and is placed with the same stride,
+ *       so the destination must have room for it.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_rotate_90_cw_stride(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height
+)
+{
+    CANVAS_KERNELS_LOAD();
+    CANVAS_KERNEL(transform)(
+        destination,
+        source,
+        pixel_size,
+        stride,
+        width,
+        height,
+        (ptrdiff_t)((height - 1) * pixel_size),
+        (ptrdiff_t)stride,
+        -(ptrdiff_t)pixel_size
+    );
+}
+
+/**
+ * Rotate the canvas 90 degrees clockwise
+ *
+ * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      memory_size      The total memory size of the canvas in bytes
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * Equivalent to canvas_buffer_rotate_90_cw_stride() on a canvas with packed rows.
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_rotate_90_cw(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t memory_size,
+    size_t width,
+    size_t height
+)
+{
+    (void)memory_size;
+    canvas_buffer_rotate_90_cw_stride(
+        destination,
+        source,
+        pixel_size,
+        width * pixel_size,
+        width,
+        height
+    );
+}
+
+/**
+ * Rotate the canvas 90 degrees counter-clockwise
+ *
+ * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next, in both buffers
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ *       The rotated canvas is `height` pixels wide and `width` pixels tall and is placed with the same stride,
+ *       so the destination must have room for it.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_rotate_90_ccw_stride(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height
+)
+{
+    CANVAS_KERNELS_LOAD();
+    CANVAS_KERNEL(transform)(
+        destination,
+        source,
+        pixel_size,
+        stride,
+        width,
+        height,
+        (ptrdiff_t)((width - 1) * stride),
+        -(ptrdiff_t)stride,
+        (ptrdiff_t)pixel_size
+    );
+}
+
+/**
+ * Rotate the canvas 90 degrees counter-clockwise
+ *
+ * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      memory_size      The total memory size of the canvas in bytes
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * Equivalent to canvas_buffer_rotate_90_ccw_stride() on a canvas with packed rows.
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_rotate_90_ccw(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t memory_size,
+    size_t width,
+    size_t height
+)
+{
+    (void)memory_size;
+    canvas_buffer_rotate_90_ccw_stride(
+        destination,
+        source,
+        pixel_size,
+        width * pixel_size,
+        width,
+        height
+    );
+}
+
+/**
+ * Rotate the canvas by 180 degrees
+ *
+ * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next, in both buffers
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_rotate_180_stride(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height
+)
+{
+    CANVAS_KERNELS_LOAD();
+    CANVAS_KERNEL(transform)(
+        destination,
+        source,
+        pixel_size,
+        stride,
+        width,
+        height,
+        (ptrdiff_t)((width - 1) * pixel_size + (height - 1) * stride),
+        -(ptrdiff_t)pixel_size,
+        -(ptrdiff_t)stride
+    );
+}
+
+/**
+ * Rotate the canvas by 180 degrees
+ *
+ * @param[out] destination      Destination buffer; the rotated canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      memory_size      The total memory size of the canvas in bytes
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * Equivalent to canvas_buffer_rotate_180_stride() on a canvas with packed rows.
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_rotate_180(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t memory_size,
+    size_t width,
+    size_t height
+)
+{
+    (void)memory_size;
+    canvas_buffer_rotate_180_stride(
+        destination,
+        source,
+        pixel_size,
+        width * pixel_size,
+        width,
+        height
+    );
+}
+
+/**
+ * Flip the canvas along the horizontal axis
+ *
+ * @param[out] destination      Destination buffer; the flipped canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next, in both buffers
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_flip_up_down_stride(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height
+)
+{
+    CANVAS_KERNELS_LOAD();
+    // Rows stay intact, so they can be copied whole
+    for (size_t y = 0; y < height; y++)
+    {
+        CANVAS_KERNEL(copy)(destination + (height - 1 - y) * stride, source + y * stride, width * pixel_size);
+    }
+}
+
+/**
+ * Flip the canvas along the horizontal axis
+ *
+ * @param[out] destination      Destination buffer; the flipped canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      memory_size      The total memory size of the canvas in bytes
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * Equivalent to canvas_buffer_flip_up_down_stride() on a canvas with packed rows.
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_flip_up_down(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t memory_size,
+    size_t width,
+    size_t height
+)
+{
+    (void)memory_size;
+    canvas_buffer_flip_up_down_stride(
+        destination,
+        source,
+        pixel_size,
+        width * pixel_size,
+        width,
+        height
+    );
+}
+
+/**
+ * Flip the canvas along the vertical axis
+ *
+ * @param[out] destination      Destination buffer; the flipped canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next, in both buffers
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_flip_left_right_stride(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height
+)
+{
+    CANVAS_KERNELS_LOAD();
+    CANVAS_KERNEL(transform)(
+        destination,
+        source,
+        pixel_size,
+        stride,
+        width,
+        height,
+        (ptrdiff_t)((width - 1) * pixel_size),
+        -(ptrdiff_t)pixel_size,
+        (ptrdiff_t)stride
+    );
+}
+
+/**
+ * Flip the canvas along the vertical axis
+ *
+ * @param[out] destination      Destination buffer; the flipped canvas will be placed here.
+ * @param[in]  source           Source buffer; the original canvas comes from here.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      memory_size      The total memory size of the canvas in bytes
+ * @param      width            Width of the source canvas
+ * @param      height           Height of the source canvas
+ *
+ * Equivalent to canvas_buffer_flip_left_right_stride() on a canvas with packed rows.
+ *
+ * @note `source` and `destination` must not point to overlapping memory.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_flip_left_right(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    size_t pixel_size,
+    size_t memory_size,
+    size_t width,
+    size_t height
+)
+{
+    (void)memory_size;
+    canvas_buffer_flip_left_right_stride(
+        destination,
+        source,
+        pixel_size,
+        width * pixel_size,
+        width,
+        height
+    );
+}
+
+/**
+ * Place a filled rectangle into the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next
+ * @param      x_left           X-coordinate of the left side of the rectangle
+ * @param      x_right          X-coordinate of the right side of the rectangle (minus 1)
+ * @param      y_top            Y-coordinate of the top side of the rectangle
+ * @param      y_bottom         Y-coordinate of the bottom side of the rectangle (minus 1)
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_rect_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    CANVAS_KERNELS_LOAD();
+    size_t width_rect = x_right - x_left;
+    uint8_t *row = buffer + y_top * stride + x_left * pixel_size;
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        CANVAS_KERNEL(fill)(row, pixel, pixel_size, width_rect);
+        row += stride;
+    }
+}
+
+/**
+ * Place a filled rectangle into the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      width            Width of the canvas
+ * @param      x_left           X-coordinate of the left side of the rectangle
+ * @param      x_right          X-coordinate of the right side of the rectangle (minus 1)
+ * @param      y_top            Y-coordinate of the top side of the rectangle
+ * @param      y_bottom         Y-coordinate of the bottom side of the rectangle (minus 1)
+ *
+ * Equivalent to canvas_buffer_fill_rect_stride() on a canvas with packed rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_rect(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_fill_rect_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        x_left,
+        x_right,
+        y_top,
+        y_bottom
+    );
+}
+
+/**
+ * Draw a horizontal line on the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next
+ * @param      x_left           X-coordinate of the left edge of the line
+ * @param      x_right          X-coordinate of the right edge of the line (minus 1)
+ * @param      y                Y-coordinate of the line
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_horizontal_line_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t x_left,
+    size_t x_right,
+    size_t y
+)
+{
+    if (x_left >= x_right)
+    {
+        return;
+    }
+    uint8_t *destination = buffer + y * stride + x_left * pixel_size;
+    size_t count = x_right - x_left;
+    if (count * pixel_size < CANVAS_KERNEL_DISPATCH_SIZE)
+    {
+        canvas_kernel_fill(destination, pixel, pixel_size, count);
+        return;
+    }
+    CANVAS_KERNELS_LOAD();
+    CANVAS_KERNEL(fill)(destination, pixel, pixel_size, count);
+}
+
+/**
+ * Draw a horizontal line on the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      width            Width of the canvas
+ * @param      x_left           X-coordinate of the left edge of the line
+ * @param      x_right          X-coordinate of the right edge of the line (minus 1)
+ * @param      y                Y-coordinate of the line
+ *
+ * Equivalent to canvas_buffer_draw_horizontal_line_stride() on a canvas with packed rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_horizontal_line(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x_left,
+    size_t x_right,
+    size_t y
+)
+{
+    canvas_buffer_draw_horizontal_line_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        x_left,
+        x_right,
+        y
+    );
+}
+
+/**
+ * Draw a vertical line on the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next
+ * @param      x                X-coordinate of the line
+ * @param      y_top            Y-coordinate of the top edge of the line
+ * @param      y_bottom         Y-coordinate of the bottom edge of the line (minus 1)
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_vertical_line_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t x,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        canvas_buffer_set_pixel_stride(buffer, pixel, pixel_size, stride, x, y);
+    }
+}
+
+/**
+ * Draw a vertical line on the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      width            Width of the canvas
+ * @param      x                X-coordinate of the line
+ * @param      y_top            Y-coordinate of the top edge of the line
+ * @param      y_bottom         Y-coordinate of the bottom edge of the line (minus 1)
+ *
+ * Equivalent to canvas_buffer_draw_vertical_line_stride() on a canvas with packed rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_vertical_line(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_draw_vertical_line_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        x,
+        y_top,
+        y_bottom
+    );
+}
+
+/**
+ * Context for @ref canvas_buffer_span.
+ */
+typedef struct canvas_buffer_span_context_t {
+    uint8_t *buffer;        /**< The buffer into which the spans will be placed */
+    const uint8_t *pixel;   /**< Pixel data for a single pixel. Each pixel in the spans will have this pixel value. */
+    size_t pixel_size;      /**< The size per pixel in bytes */
+    size_t stride;          /**< Number of bytes from the start of one row to the start of the next */
+} canvas_buffer_span_context_t;
+
+/**
+ * Span function which places each span into a buffer, for passing to the rasterizers in the @ref RASTER_API.
+ *
+ * @param context  Pointer to a @ref canvas_buffer_span_context_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_buffer_span_context_t *span = (const canvas_buffer_span_context_t *)context;
+    canvas_buffer_draw_horizontal_line_stride(
+        span->buffer,
+        span->pixel,
+        span->pixel_size,
+        span->stride,
+        (size_t)x_left,
+        (size_t)x_right,
+        (size_t)y
+    );
+}
+
+/**
+ * Context for @ref canvas_buffer_clipped_span.
+ */
+typedef struct canvas_buffer_clipped_span_context_t {
+    canvas_buffer_span_context_t span;  /**< Where and how to place the spans */
+    size_t width;                       /**< Width of the buffer, in pixels */
+    size_t height;                      /**< Height of the buffer, in pixels */
+} canvas_buffer_clipped_span_context_t;
+
+/**
+ * Span function which clips each span to a buffer and places it there, for shapes that may reach past the edges.
+ *
+ * @param context  Pointer to a @ref canvas_buffer_clipped_span_context_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_clipped_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_buffer_clipped_span_context_t *clipped = (const canvas_buffer_clipped_span_context_t *)context;
+    x_left = x_left < 0 ? 0 : x_left;
+    x_right = (int64_t)x_right > (int64_t)clipped->width ? (int)clipped->width : x_right;
+    if (y < 0 || (size_t)y >= clipped->height || x_left >= x_right)
+    {
+        return;
+    }
+    canvas_buffer_span((void *)&clipped->span, x_left, x_right, y);
+}
+
+/**
+ * Draw a line on the canvas using Bresenham's line algorithm.
+ *
+ * @param[out] buffer           The buffer into which the line will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel on the line will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width     Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height    Height of the buffer in pixels
+ * @param      x_left           X-coordinate of the leftmost point on the line
+ * @param      x_right          X-coordinate of the rightmost point on the line (minus 1)
+ * @param      y_top            Y-coordinate of the topmost point on the line
+ * @param      y_bottom         Y-coordinate of the bottom point of the line (minus 1)
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_line_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_line(
+        (int)x_left,
+        (int)x_right,
+        (int)y_top,
+        (int)y_bottom,
+        canvas_buffer_clipped_span,
+        &span
+    );
+}
+
+/**
+ * Draw a line on the canvas using Bresenham's line algorithm.
+ *
+ * @param[out] buffer           The buffer into which the line will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel on the line will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      width            Width of the canvas
+ * @param      x_left           X-coordinate of the leftmost point on the line
+ * @param      x_right          X-coordinate of the rightmost point on the line (minus 1)
+ * @param      y_top            Y-coordinate of the topmost point on the line
+ * @param      y_bottom         Y-coordinate of the bottom point of the line (minus 1)
+ *
+ * Equivalent to canvas_buffer_draw_line_stride() on a canvas with packed rows.
+ * The shape is clipped to the top, left and right edges of the canvas, but must not reach past the bottom.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_line(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_draw_line_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        width,
+        SIZE_MAX,
+        x_left,
+        x_right,
+        y_top,
+        y_bottom
+    );
+}
+
+/**
+ * Place a filled triangle on the canvas
+ *
+ * @param[out] buffer         The buffer into which the triangle will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel inside the triangle will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_0            X-coordinate of the first vertex
+ * @param      x_1            X-coordinate of the second vertex
+ * @param      x_2            X-coordinate of the third vertex
+ * @param      y_0            Y-coordinate of the first vertex
+ * @param      y_1            Y-coordinate of the second vertex
+ * @param      y_2            Y-coordinate of the third vertex
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_triangle_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_fill_triangle(
+        (int)x_0,
+        (int)x_1,
+        (int)x_2,
+        (int)y_0,
+        (int)y_1,
+        (int)y_2,
+        canvas_buffer_clipped_span,
+        &span
+    );
+}
+
+/**
+ * Place a filled triangle on the canvas
+ *
+ * @param[out] buffer      The buffer into which the triangle will be placed
+ * @param[in]  pixel       Pixel data for a single pixel. Each pixel inside the triangle will have this pixel value.
+ * @param      pixel_size  The size per pixel in bytes
+ * @param      width       Width of the canvas
+ * @param      x_0         X-coordinate of the first vertex
+ * @param      x_1         X-coordinate of the second vertex
+ * @param      x_2         X-coordinate of the third vertex
+ * @param      y_0         Y-coordinate of the first vertex
+ * @param      y_1         Y-coordinate of the second vertex
+ * @param      y_2         Y-coordinate of the third vertex
+ *
+ * Equivalent to canvas_buffer_fill_triangle_stride() on a canvas with packed rows.
+ * The shape is clipped to the top, left and right edges of the canvas, but must not reach past the bottom.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_triangle(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    canvas_buffer_fill_triangle_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        width,
+        SIZE_MAX,
+        x_0,
+        x_1,
+        x_2,
+        y_0,
+        y_1,
+        y_2
+    );
+}
+
+/**
+ * Place a rectangle into the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel on the rectangle edges will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width     Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height    Height of the buffer in pixels
+ * @param      x_left           X-coordinate of the left side of the rectangle
+ * @param      x_right          X-coordinate of the right side of the rectangle (minus 1)
+ * @param      y_top            Y-coordinate of the top side of the rectangle
+ * @param      y_bottom         Y-coordinate of the bottom side of the rectangle (minus 1)
+ *
+ * If a filled rectangle is desired, use @ref canvas_buffer_fill_rect_stride.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_rect_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_rect(
+        (int)x_left,
+        (int)x_right,
+        (int)y_top,
+        (int)y_bottom,
+        canvas_buffer_clipped_span,
+        &span
+    );
+}
+
+/**
+ * Place a rectangle into the canvas
+ *
+ * @param[out] buffer           The buffer into which the rectangle will be placed
+ * @param[in]  pixel            Pixel data for a single pixel. Each pixel on the rectangle edges will have this pixel value.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      width            Width of the canvas
+ * @param      x_left           X-coordinate of the left side of the rectangle
+ * @param      x_right          X-coordinate of the right side of the rectangle (minus 1)
+ * @param      y_top            Y-coordinate of the top side of the rectangle
+ * @param      y_bottom         Y-coordinate of the bottom side of the rectangle (minus 1)
+ *
+ * Equivalent to canvas_buffer_draw_rect_stride() on a canvas with packed rows.
+ * The shape is clipped to the top, left and right edges of the canvas, but must not reach past the bottom.
+ *
+ * If a filled rectangle is desired, use @ref canvas_buffer_fill_rect.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_rect(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_draw_rect_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        width,
+        SIZE_MAX,
+        x_left,
+        x_right,
+        y_top,
+        y_bottom
+    );
+}
+
+/**
+ * Draw a circle on the canvas
+ *
+ * @param[out] buffer         The buffer into which the circle will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_center       X-coordinate of the center of the circle
+ * @param      y_center       Y-coordinate of the center of the circle
+ * @param      radius         The radius of the circle
+ *
+ * For a filled circle (disk), use @ref canvas_buffer_fill_circle_stride.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_circle_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_circle((int)x_center, (int)y_center, (int)radius, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Draw a circle on the canvas
+ *
+ * @param[out] buffer      The buffer into which the circle will be placed
+ * @param[in]  pixel       Pixel data for a single pixel. Each pixel will have this pixel value.
+ * @param      pixel_size  The size per pixel in bytes
+ * @param      width       Width of the canvas
+ * @param      x_center    X-coordinate of the center of the circle
+ * @param      y_center    Y-coordinate of the center of the circle
+ * @param      radius      The radius of the circle
+ *
+ * Equivalent to canvas_buffer_draw_circle_stride() on a canvas with packed rows.
+ * The shape is clipped to the top, left and right edges of the canvas, but must not reach past the bottom.
+ *
+ * For a filled circle (disk), use @ref canvas_buffer_fill_circle.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_circle(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_buffer_draw_circle_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        width,
+        SIZE_MAX,
+        x_center,
+        y_center,
+        radius
+    );
+}
+
+/**
+ * Draw a filled circle (disk) on the canvas
+ *
+ * @param[out] buffer         The buffer into which the circle will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_center       X-coordinate of the center of the circle
+ * @param      y_center       Y-coordinate of the center of the circle
+ * @param      radius         The radius of the circle
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_circle_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_fill_circle((int)x_center, (int)y_center, (int)radius, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Draw a filled circle (disk) on the canvas
+ *
+ * @param[out] buffer      The buffer into which the circle will be placed
+ * @param[in]  pixel       Pixel data for a single pixel. Each pixel will have this pixel value.
+ * @param      pixel_size  The size per pixel in bytes
+ * @param      width       Width of the canvas
+ * @param      x_center    X-coordinate of the center of the circle
+ * @param      y_center    Y-coordinate of the center of the circle
+ * @param      radius      The radius of the circle
+ *
+ * Equivalent to canvas_buffer_fill_circle_stride() on a canvas with packed rows.
+ * The shape is clipped to the top, left and right edges of the canvas, but must not reach past the bottom.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_circle(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t width,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_buffer_fill_circle_stride(
+        buffer,
+        pixel,
+        pixel_size,
+        width * pixel_size,
+        width,
+        SIZE_MAX,
+        x_center,
+        y_center,
+        radius
+    );
+}
+
+/**
+ * Place a filled polygon on the canvas. See @ref canvas_raster_fill_polygon.
+ *
+ * @param[out] buffer         The buffer into which the polygon will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel inside the polygon will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param[in]  points         The vertices of the polygon, in order
+ * @param      count          Number of vertices
+ * @param      rule           Decides which pixels are inside where the outline overlaps itself
+ * @param[out] edges          Working memory for `count` edges
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_polygon(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    const canvas_point_t* CANVAS_RESTRICT points,
+    size_t count,
+    canvas_fill_rule_t rule,
+    canvas_polygon_edge_t* CANVAS_RESTRICT edges
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_fill_polygon(points, count, rule, edges, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Draw a thick line on the canvas. See @ref canvas_raster_thick_line.
+ *
+ * @param[out] buffer         The buffer into which the line will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel on the line will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_0            X-coordinate of the first end point
+ * @param      x_1            X-coordinate of the second end point
+ * @param      y_0            Y-coordinate of the first end point
+ * @param      y_1            Y-coordinate of the second end point
+ * @param      width          Width of the line, in pixels
+ * @param      cap            Shape of the ends of the line
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_thick_line(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_0,
+    size_t x_1,
+    size_t y_0,
+    size_t y_1,
+    size_t width,
+    canvas_line_cap_t cap
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_thick_line((int)x_0, (int)x_1, (int)y_0, (int)y_1, (int)width, cap, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Draw a thick polyline on the canvas. See @ref canvas_raster_polyline.
+ *
+ * @param[out] buffer         The buffer into which the polyline will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel on the polyline will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param[in]  points         The points of the polyline, in order
+ * @param      count          Number of points
+ * @param      width          Width of the line, in pixels
+ * @param      cap            Shape of the two ends of the polyline. Ignored if it is closed.
+ * @param      closed         Whether to join the last point back to the first
+ * @param[out] intervals      Working memory for `count` intervals
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_polyline(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    const canvas_point_t* CANVAS_RESTRICT points,
+    size_t count,
+    size_t width,
+    canvas_line_cap_t cap,
+    bool closed,
+    canvas_interval_t* CANVAS_RESTRICT intervals
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_polyline(points, count, (int)width, cap, closed, intervals, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Place a rectangle with thick edges into the canvas. See @ref canvas_raster_thick_rect.
+ *
+ * @param[out] buffer         The buffer into which the rectangle will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel on the rectangle edges will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_left         X-coordinate of the left side of the rectangle
+ * @param      x_right        X-coordinate of the right side of the rectangle, plus 1.
+ * @param      y_top          Y-coordinate of the top side of the rectangle
+ * @param      y_bottom       Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param      width          Width of the edges, in pixels, inwards from the sides
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_thick_rect(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom,
+    size_t width
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_thick_rect((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, (int)width, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Draw a thick circle (ring) on the canvas. See @ref canvas_raster_thick_circle.
+ *
+ * @param[out] buffer         The buffer into which the circle will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_center       X-coordinate of the center of the circle
+ * @param      y_center       Y-coordinate of the center of the circle
+ * @param      radius         The radius of the circle
+ * @param      width          Width of the ring, in pixels, centered on the radius
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_thick_circle(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_center,
+    size_t y_center,
+    size_t radius,
+    size_t width
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_thick_circle((int)x_center, (int)y_center, (int)radius, (int)width, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Place a filled rectangle with rounded corners into the canvas. See @ref canvas_raster_fill_rounded_rect.
+ *
+ * @param[out] buffer         The buffer into which the rectangle will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_left         X-coordinate of the left side of the rectangle
+ * @param      x_right        X-coordinate of the right side of the rectangle, plus 1.
+ * @param      y_top          Y-coordinate of the top side of the rectangle
+ * @param      y_bottom       Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param[in]  corner         The shape of the corners, from @ref canvas_corner_init
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_rounded_rect(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom,
+    const canvas_corner_t* CANVAS_RESTRICT corner
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_fill_rounded_rect((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, corner, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Place the edges of a rectangle with rounded corners into the canvas. See @ref canvas_raster_rounded_rect.
+ *
+ * @param[out] buffer         The buffer into which the rectangle will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel on the rectangle edges will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_left         X-coordinate of the left side of the rectangle
+ * @param      x_right        X-coordinate of the right side of the rectangle, plus 1.
+ * @param      y_top          Y-coordinate of the top side of the rectangle
+ * @param      y_bottom       Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param[in]  corner         The shape of the corners and the width of the edges, from @ref canvas_corner_init
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_rounded_rect(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom,
+    const canvas_corner_t* CANVAS_RESTRICT corner
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_rounded_rect((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, corner, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Draw an arc on the canvas. See @ref canvas_raster_arc.
+ *
+ * @param[out] buffer         The buffer into which the arc will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel on the arc will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_center       X-coordinate of the center of the circle
+ * @param      y_center       Y-coordinate of the center of the circle
+ * @param      radius         The radius of the circle
+ * @param      width          Width of the arc, in pixels, centered on the radius
+ * @param      start          Direction of the start of the arc, in degrees clockwise from the positive X-axis
+ * @param      sweep          Angle covered by the arc, in degrees clockwise
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_draw_arc(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_center,
+    size_t y_center,
+    size_t radius,
+    size_t width,
+    double start,
+    double sweep
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_arc((int)x_center, (int)y_center, (int)radius, (int)width, start, sweep, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Place a filled pie slice into the canvas. See @ref canvas_raster_fill_pie.
+ *
+ * @param[out] buffer         The buffer into which the slice will be placed
+ * @param[in]  pixel          Pixel data for a single pixel. Each pixel inside the slice will have this pixel value.
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      stride         Number of bytes from the start of one row to the start of the next
+ * @param      buffer_width   Width of the buffer in pixels. The shape is clipped to the buffer.
+ * @param      buffer_height  Height of the buffer in pixels
+ * @param      x_center       X-coordinate of the center of the disk
+ * @param      y_center       Y-coordinate of the center of the disk
+ * @param      radius         The radius of the disk
+ * @param      start          Direction of the start of the slice, in degrees clockwise from the positive X-axis
+ * @param      sweep          Angle covered by the slice, in degrees clockwise
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_pie(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t pixel_size,
+    size_t stride,
+    size_t buffer_width,
+    size_t buffer_height,
+    size_t x_center,
+    size_t y_center,
+    size_t radius,
+    double start,
+    double sweep
+)
+{
+    canvas_buffer_clipped_span_context_t span = { { buffer, pixel, pixel_size, stride }, buffer_width, buffer_height };
+    canvas_raster_fill_pie((int)x_center, (int)y_center, (int)radius, start, sweep, canvas_buffer_clipped_span, &span);
+}
+
+/**
+ * Copy a bitmap into the canvas.
+ *
+ * @param[out] buffer      The buffer into which the bitmap will be placed
+ * @param[in]  bitmap      Pixel data for the bitmap
+ * @param      pixel_size  The size per pixel in bytes
+ * @param      stride      Number of bytes from the start of one row to the start of the next
+ * @param      x_left      X-coordinate of the left side of the bitmap (relative to the left side of the canvas)
+ * @param      x_right     X-coordinate of the right side of the bitmap (relative to the left side of the canvas)
+ * @param      y_top       Y-coordinate of the top side of the bitmap (relative to the top side of the canvas)
+ * @param      y_bottom    Y-coordinate of the bottom side of the bitmap (relative to the top side of the canvas)
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    CANVAS_KERNELS_LOAD();
+    size_t row_size_bitmap = (x_right - x_left) * pixel_size;
+    bool stream = row_size_bitmap * (y_bottom - y_top) >= CANVAS_STREAM_THRESHOLD;
+    uint8_t *row = buffer + y_top * stride + x_left * pixel_size;
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        if (stream)
+        {
+            CANVAS_KERNEL(stream_copy)(row, bitmap, row_size_bitmap);
+        }
+        else
+        {
+            CANVAS_KERNEL(copy)(row, bitmap, row_size_bitmap);
+        }
+        row += stride;
+        bitmap += row_size_bitmap;
+    }
+    if (stream)
+    {
+        canvas_kernel_stream_fence();
+    }
+}
+
+/**
+ * Copy a bitmap into the canvas.
+ *
+ * @param[out] buffer      The buffer into which the bitmap will be placed
+ * @param[in]  bitmap      Pixel data for the bitmap
+ * @param      pixel_size  The size per pixel in bytes
+ * @param      width       Width of the canvas
+ * @param      x_left      X-coordinate of the left side of the bitmap (relative to the left side of the canvas)
+ * @param      x_right     X-coordinate of the right side of the bitmap (relative to the left side of the canvas)
+ * @param      y_top       Y-coordinate of the top side of the bitmap (relative to the top side of the canvas)
+ * @param      y_bottom    Y-coordinate of the bottom side of the bitmap (relative to the top side of the canvas)
+ *
+ * Equivalent to canvas_buffer_place_bitmap_stride() on a canvas with packed rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t width,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_place_bitmap_stride(
+        buffer,
+        bitmap,
+        pixel_size,
+        width * pixel_size,
+        x_left,
+        x_right,
+        y_top,
+        y_bottom
+    );
+}
+
+/**
+ * Extract a bitmap from the canvas.
+ *
+ * @param[in]  buffer      The buffer from which the bitmap will be extracted
+ * @param[out] bitmap      Pixel data for the bitmap will be placed here
+ * @param      pixel_size  The size per pixel in bytes
+ * @param      stride      Number of bytes from the start of one row to the start of the next
+ * @param      x_left      X-coordinate of the left side of the bitmap (relative to the left side of the canvas)
+ * @param      x_right     X-coordinate of the right side of the bitmap (relative to the left side of the canvas)
+ * @param      y_top       Y-coordinate of the top side of the bitmap (relative to the top side of the canvas)
+ * @param      y_bottom    Y-coordinate of the bottom side of the bitmap (relative to the top side of the canvas)
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_extract_bitmap_stride(
+    const uint8_t* CANVAS_RESTRICT buffer,
+    uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    size_t row_size_bitmap = (x_right - x_left) * pixel_size;
+    const uint8_t *row = buffer + y_top * stride + x_left * pixel_size;
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        memcpy(bitmap, row, row_size_bitmap);
+        row += stride;
+        bitmap += row_size_bitmap;
+    }
+}
+
+/**
+ * Extract a bitmap from the canvas.
+ *
+ * @param[in]  buffer      The buffer from which the bitmap will be extracted
+ * @param[out] bitmap      Pixel data for the bitmap will be placed here
+ * @param      pixel_size  The size per pixel in bytes
+ * @param      width       Width of the canvas
+ * @param      x_left      X-coordinate of the left side of the bitmap (relative to the left side of the canvas)
+ * @param      x_right     X-coordinate of the right side of the bitmap (relative to the left side of the canvas)
+ * @param      y_top       Y-coordinate of the top side of the bitmap (relative to the top side of the canvas)
+ * @param      y_bottom    Y-coordinate of the bottom side of the bitmap (relative to the top side of the canvas)
+ *
+ * Equivalent to canvas_buffer_extract_bitmap_stride() on a canvas with packed rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_extract_bitmap(
+    const uint8_t* CANVAS_RESTRICT buffer,
+    uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t width,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_buffer_extract_bitmap_stride(
+        buffer,
+        bitmap,
+        pixel_size,
+        width * pixel_size,
+        x_left,
+        x_right,
+        y_top,
+        y_bottom
+    );
+}
+
+
+/**
+ * Move a region from one location of the buffer into another, which may overlap it.
+ *
+ * @param[in]  buffer           The buffer on which the data will be moved
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next
+ * @param      source_x_left    X-coordinate of the left side of the source region
+ * @param      source_x_right   X-coordinate of the right side of the source region
+ * @param      source_y_top     Y-coordinate of the top side of the source region
+ * @param      source_y_bottom  Y-coordinate of the bottom side of the source region
+ * @param      dest_x_left      X-coordinate of the left side of the destination region
+ * @param      dest_y_top       Y-coordinate of the top side of the destionation region
+ *
+ * Rows are visited bottom-up when moving down and top-down otherwise, so that no source row is overwritten
+ * before it has been moved, and each row is moved with `memmove`. No temporary buffer is needed
+ * and each byte is read and written once.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_move_region(
+    uint8_t *buffer,
+    size_t pixel_size,
+    size_t stride,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_y_top
+)
+{
+    size_t row_size = (source_x_right - source_x_left) * pixel_size;
+    size_t height = source_y_bottom - source_y_top;
+    uint8_t *source = buffer + source_y_top * stride + source_x_left * pixel_size;
+    uint8_t *dest = buffer + dest_y_top * stride + dest_x_left * pixel_size;
+    if (dest_y_top > source_y_top)
+    {
+        for (size_t y = height; y > 0; y--)
+        {
+            memmove(dest + (y - 1) * stride, source + (y - 1) * stride, row_size);
+        }
+    }
+    else
+    {
+        for (size_t y = 0; y < height; y++)
+        {
+            memmove(dest + y * stride, source + y * stride, row_size);
+        }
+    }
+}
+
+/**
+ * Copy a region from one location of the buffer into another
+ *
+ * @param[in]  buffer           The buffer on which the data will be copied
+ * @param      temporary        Not used. Kept for compatibility.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      stride           Number of bytes from the start of one row to the start of the next
+ * @param      source_x_left    X-coordinate of the left side of the source region
+ * @param      source_x_right   X-coordinate of the right side of the source region
+ * @param      source_y_top     Y-coordinate of the top side of the source region
+ * @param      source_y_bottom  Y-coordinate of the bottom side of the source region
+ * @param      dest_x_left      X-coordinate of the left side of the destination region
+ * @param      dest_y_top       Y-coordinate of the top side of the destionation region
+ *
+ * @deprecated Use @ref canvas_buffer_move_region, which does not need a temporary buffer.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_copy_region_stride(
+    uint8_t* CANVAS_RESTRICT buffer,
+    uint8_t* CANVAS_RESTRICT temporary,
+    size_t pixel_size,
+    size_t stride,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_y_top
+)
+{
+    (void)temporary;
+    canvas_buffer_move_region(
+        buffer,
+        pixel_size,
+        stride,
+        source_x_left,
+        source_x_right,
+        source_y_top,
+        source_y_bottom,
+        dest_x_left,
+        dest_y_top
+    );
+}
+
+/**
+ * Copy a region from one location of the buffer into another
+ *
+ * @param[in]  buffer           The buffer on which the data will be copied
+ * @param      temporary        Temporary buffer to hold a copy of the source region during the transfer.
+ *                              It can be discarded after the call.
+ * @param      pixel_size       The size per pixel in bytes
+ * @param      width            Width of the canvas
+ * @param      source_x_left    X-coordinate of the left side of the source region
+ * @param      source_x_right   X-coordinate of the right side of the source region
+ * @param      source_y_top     Y-coordinate of the top side of the source region
+ * @param      source_y_bottom  Y-coordinate of the bottom side of the source region
+ * @param      dest_x_left      X-coordinate of the left side of the destination region
+ * @param      dest_y_top       Y-coordinate of the top side of the destionation region
+ *
+ * Equivalent to canvas_buffer_copy_region_stride() on a canvas with packed rows.
+ *
+ * @note The temporary buffer must have a capacity of at least `(x_right - x_left) * (y_bottom - y_top) * pixel_size`.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_copy_region(
+    uint8_t* CANVAS_RESTRICT buffer,
+    uint8_t* CANVAS_RESTRICT temporary,
+    size_t pixel_size,
+    size_t width,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_y_top
+)
+{
+    canvas_buffer_copy_region_stride(
+        buffer,
+        temporary,
+        pixel_size,
+        width * pixel_size,
+        source_x_left,
+        source_x_right,
+        source_y_top,
+        source_y_bottom,
+        dest_x_left,
+        dest_y_top
+    );
+}
+
+#ifndef CANVAS_SCALE_CHUNK_SIZE
+    /** Number of destination columns whose source offsets are computed at a time by the scaled blits */
+    #define CANVAS_SCALE_CHUNK_SIZE 64
+#endif
+
+/**
+ * For internal use. Copy pixels from scattered offsets in a source row into consecutive pixels.
+ *
+ * @param[out] destination Destination for `count` pixels
+ * @param[in]  source      Source row
+ * @param[in]  offsets     Byte offset into `source` of each pixel to copy
+ * @param      count       Number of pixels to copy
+ * @param      pixel_size  The size per pixel in bytes
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_gather(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    const size_t* CANVAS_RESTRICT offsets,
+    size_t count,
+    size_t pixel_size
+)
+{
+    CANVAS_KERNEL_SIZE_SWITCH(pixel_size, size,
+        for (size_t i = 0; i < count; i++)
+        {
+            memcpy(destination + i * size, source + offsets[i], size);
+        }
+    )
+}
+
+/**
+ * For internal use. Rows `row_first` up to `row_last` of a nearest-neighbour scaled blit.
+ *
+ * @param[out] destination      Leftmost pixel of destination row `row_first`
+ * @param      dest_width       Width of the whole destination region
+ * @param      dest_height      Height of the whole destination region
+ * @param      row_first        First row to produce, relative to the top of the destination region
+ * @param      row_last         Last row to produce plus 1, relative to the top of the destination region
+ *
+ * The other parameters are the same as for @ref canvas_buffer_place_bitmap_scaled.
+ * Splitting a blit into row windows produces exactly the same pixels as doing it in one go,
+ * so callers can write windows to memory that is not contiguous.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap_scaled_rows(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t bitmap_stride,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_width,
+    size_t dest_height,
+    size_t row_first,
+    size_t row_last
+)
+{
+    if (source_x_right <= source_x_left || source_y_bottom <= source_y_top || dest_width == 0 || row_first >= row_last)
+    {
+        return;
+    }
+    uint64_t x_step = ((uint64_t)(source_x_right - source_x_left) << 16) / dest_width;
+    uint64_t y_step = ((uint64_t)(source_y_bottom - source_y_top) << 16) / dest_height;
+
+    size_t offsets[CANVAS_SCALE_CHUNK_SIZE];
+    for (size_t chunk = 0; chunk < dest_width; chunk += CANVAS_SCALE_CHUNK_SIZE)
+    {
+        size_t chunk_width = dest_width - chunk < CANVAS_SCALE_CHUNK_SIZE ? dest_width - chunk : CANVAS_SCALE_CHUNK_SIZE;
+
+        // Sample at the center of each destination pixel
+        uint64_t x_position = x_step / 2 + chunk * x_step;
+        for (size_t i = 0; i < chunk_width; i++)
+        {
+            offsets[i] = (source_x_left + (size_t)(x_position >> 16)) * pixel_size;
+            x_position += x_step;
+        }
+
+        uint8_t *row = destination + chunk * pixel_size;
+        uint64_t y_position = y_step / 2 + row_first * y_step;
+        size_t previous_source_y = (size_t)-1;
+        for (size_t y = row_first; y < row_last; y++)
+        {
+            size_t source_y = source_y_top + (size_t)(y_position >> 16);
+            if (source_y == previous_source_y)
+            {
+                memcpy(row, row - stride, chunk_width * pixel_size);
+            }
+            else
+            {
+                canvas_buffer_gather(row, bitmap + source_y * bitmap_stride, offsets, chunk_width, pixel_size);
+            }
+            previous_source_y = source_y;
+            y_position += y_step;
+            row += stride;
+        }
+    }
+}
+
+/**
+ * Copy a region of a bitmap into a region of the canvas, scaling it with nearest-neighbour sampling.
+ *
+ * @param[out] buffer           The buffer into which the bitmap will be placed
+ * @param[in]  bitmap           Pixel data for the bitmap
+ * @param      pixel_size       The size per pixel in bytes, for both the buffer and the bitmap
+ * @param      stride           Number of bytes from the start of one row to the start of the next in `buffer`
+ * @param      bitmap_stride    Number of bytes from the start of one row to the start of the next in `bitmap`
+ * @param      source_x_left    X-coordinate of the left side of the source region in the bitmap
+ * @param      source_x_right   X-coordinate of the right side of the source region in the bitmap, plus 1.
+ * @param      source_y_top     Y-coordinate of the top side of the source region in the bitmap
+ * @param      source_y_bottom  Y-coordinate of the bottom side of the source region in the bitmap, plus 1.
+ * @param      dest_x_left      X-coordinate of the left side of the destination region in the canvas
+ * @param      dest_x_right     X-coordinate of the right side of the destination region in the canvas, plus 1.
+ * @param      dest_y_top       Y-coordinate of the top side of the destination region in the canvas
+ * @param      dest_y_bottom    Y-coordinate of the bottom side of the destination region in the canvas, plus 1.
+ *
+ * Source coordinates are stepped in 16.16 fixed point. The source offsets of each column are computed once
+ * and reused for every row, and destination rows which sample the same source row are copied from the row above.
+ *
+ * @note `bitmap` must not overlap the destination region.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap_scaled(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t bitmap_stride,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_x_right,
+    size_t dest_y_top,
+    size_t dest_y_bottom
+)
+{
+    if (dest_x_right <= dest_x_left || dest_y_bottom <= dest_y_top)
+    {
+        return;
+    }
+    canvas_buffer_place_bitmap_scaled_rows(
+        buffer + dest_y_top * stride + dest_x_left * pixel_size,
+        bitmap,
+        pixel_size,
+        stride,
+        bitmap_stride,
+        source_x_left,
+        source_x_right,
+        source_y_top,
+        source_y_bottom,
+        dest_x_right - dest_x_left,
+        dest_y_bottom - dest_y_top,
+        0,
+        dest_y_bottom - dest_y_top
+    );
+}
+
+/**
+ * For internal use. Where a destination column or row samples from when scaling with bilinear filtering.
+ */
+typedef struct canvas_bilinear_sample_t {
+    size_t offset[2];   /**< Offsets of the two neighbouring source pixels */
+    uint32_t weight;    /**< Weight of `offset[1]`, from 0 to 256 */
+} canvas_bilinear_sample_t;
+
+/**
+ * For internal use. Compute the bilinear sample for one destination position.
+ *
+ * @param position  Source position of the center of the destination pixel, in 16.16 fixed point,
+ *                  relative to the center of the first source pixel
+ * @param first     Index of the first source pixel in the region
+ * @param count     Number of source pixels in the region
+ * @param scale     Multiplied with indices to get offsets
+ *
+ * @return The sample, clamped to the edges of the region
+ */
+CANVAS_STATIC_INLINE canvas_bilinear_sample_t canvas_bilinear_sample(int64_t position, size_t first, size_t count, size_t scale)
+{
+    canvas_bilinear_sample_t sample;
+    size_t index = position > 0 ? (size_t)(position >> 16) : 0;
+    if (position <= 0 || index >= count - 1)
+    {
+        index = position <= 0 ? 0 : count - 1;
+        sample.offset[0] = sample.offset[1] = (first + index) * scale;
+        sample.weight = 0;
+    }
+    else
+    {
+        sample.offset[0] = (first + index) * scale;
+        sample.offset[1] = (first + index + 1) * scale;
+        sample.weight = (uint32_t)((position >> 8) & 0xFF);
+    }
+    return sample;
+}
+
+/**
+ * For internal use. Rows `row_first` up to `row_last` of a bilinear scaled blit.
+ *
+ * The parameters are the same as for @ref canvas_buffer_place_bitmap_scaled_rows.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap_scaled_bilinear_rows(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t bitmap_stride,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_width,
+    size_t dest_height,
+    size_t row_first,
+    size_t row_last
+)
+{
+    size_t source_width = source_x_right - source_x_left;
+    size_t source_height = source_y_bottom - source_y_top;
+    if (source_x_right <= source_x_left || source_y_bottom <= source_y_top || dest_width == 0 || row_first >= row_last)
+    {
+        return;
+    }
+    int64_t x_step = (int64_t)(((uint64_t)source_width << 16) / dest_width);
+    int64_t y_step = (int64_t)(((uint64_t)source_height << 16) / dest_height);
+
+    canvas_bilinear_sample_t columns[CANVAS_SCALE_CHUNK_SIZE];
+    for (size_t chunk = 0; chunk < dest_width; chunk += CANVAS_SCALE_CHUNK_SIZE)
+    {
+        size_t chunk_width = dest_width - chunk < CANVAS_SCALE_CHUNK_SIZE ? dest_width - chunk : CANVAS_SCALE_CHUNK_SIZE;
+
+        // Centers of destination pixels, relative to the center of the first source pixel
+        int64_t x_position = x_step / 2 - 0x8000 + (int64_t)chunk * x_step;
+        for (size_t i = 0; i < chunk_width; i++)
+        {
+            columns[i] = canvas_bilinear_sample(x_position, source_x_left, source_width, pixel_size);
+            x_position += x_step;
+        }
+
+        uint8_t *row = destination + chunk * pixel_size;
+        int64_t y_position = y_step / 2 - 0x8000 + (int64_t)row_first * y_step;
+        for (size_t y = row_first; y < row_last; y++)
+        {
+            canvas_bilinear_sample_t sample_y = canvas_bilinear_sample(y_position, source_y_top, source_height, bitmap_stride);
+            const uint8_t *top = bitmap + sample_y.offset[0];
+            const uint8_t *bottom = bitmap + sample_y.offset[1];
+            uint32_t weight_bottom = sample_y.weight;
+            uint32_t weight_top = 256 - weight_bottom;
+            for (size_t i = 0; i < chunk_width; i++)
+            {
+                const canvas_bilinear_sample_t *sample_x = &columns[i];
+                uint32_t weight_right = sample_x->weight;
+                uint32_t weight_left = 256 - weight_right;
+                uint8_t *pixel = row + i * pixel_size;
+                for (size_t byte = 0; byte < pixel_size; byte++)
+                {
+                    uint32_t value_top = top[sample_x->offset[0] + byte] * weight_left + top[sample_x->offset[1] + byte] * weight_right;
+                    uint32_t value_bottom = bottom[sample_x->offset[0] + byte] * weight_left + bottom[sample_x->offset[1] + byte] * weight_right;
+                    pixel[byte] = (uint8_t)((value_top * weight_top + value_bottom * weight_bottom + 0x8000) >> 16);
+                }
+            }
+            y_position += y_step;
+            row += stride;
+        }
+    }
+}
+
+/**
+ * Copy a region of a bitmap into a region of the canvas, scaling it with bilinear filtering.
+ *
+ * The parameters are the same as for @ref canvas_buffer_place_bitmap_scaled.
+ *
+ * Every byte of a pixel is interpolated separately, so this suits formats with 8 bits per channel
+ * such as 8-bit grayscale, RGB888 and ARGB8888, but not packed formats such as RGB565.
+ * Coordinates are stepped in 16.16 fixed point and interpolated with 8-bit weights.
+ *
+ * @note `bitmap` must not overlap the destination region.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap_scaled_bilinear(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t bitmap_stride,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_x_right,
+    size_t dest_y_top,
+    size_t dest_y_bottom
+)
+{
+    if (dest_x_right <= dest_x_left || dest_y_bottom <= dest_y_top)
+    {
+        return;
+    }
+    canvas_buffer_place_bitmap_scaled_bilinear_rows(
+        buffer + dest_y_top * stride + dest_x_left * pixel_size,
+        bitmap,
+        pixel_size,
+        stride,
+        bitmap_stride,
+        source_x_left,
+        source_x_right,
+        source_y_top,
+        source_y_bottom,
+        dest_x_right - dest_x_left,
+        dest_y_bottom - dest_y_top,
+        0,
+        dest_y_bottom - dest_y_top
+    );
+}
+
+/**
+ * An affine transform from canvas coordinates to bitmap coordinates, in 16.16 fixed point.
+ *
+ * Destination pixel (x, y) is taken from bitmap pixel (u >> 16, v >> 16), where
+ * `u = u_0 + u_x * x + u_y * y` and `v = v_0 + v_x * x + v_y * y`.
+ * Any combination of rotation, scaling, shearing and translation can be expressed this way;
+ * see @ref canvas_affine_rotate_scale for the common case.
+ */
+typedef struct canvas_affine_t {
+    int32_t u_0;    /**< Bitmap X-coordinate for canvas pixel (0, 0) */
+    int32_t u_x;    /**< Change in bitmap X-coordinate per canvas column */
+    int32_t u_y;    /**< Change in bitmap X-coordinate per canvas row */
+    int32_t v_0;    /**< Bitmap Y-coordinate for canvas pixel (0, 0) */
+    int32_t v_x;    /**< Change in bitmap Y-coordinate per canvas column */
+    int32_t v_y;    /**< Change in bitmap Y-coordinate per canvas row */
+} canvas_affine_t;
+
+/**
+ * Returns the transform which rotates and scales a bitmap around a pivot point.
+ *
+ * @param angle            Rotation in radians, clockwise on the screen
+ * @param scale            Scale factor; 1 keeps the size of the bitmap
+ * @param bitmap_pivot_x   X-coordinate of the pivot point in the bitmap, in pixels
+ * @param bitmap_pivot_y   Y-coordinate of the pivot point in the bitmap, in pixels
+ * @param canvas_pivot_x   X-coordinate in the canvas where the pivot point ends up, in pixels
+ * @param canvas_pivot_y   Y-coordinate in the canvas where the pivot point ends up, in pixels
+ *
+ * Pixel centers are at half-integer coordinates, so the pivot of a 9x9 bitmap rotated around its middle is (4.5, 4.5).
+ *
+ * @return Transform for @ref canvas_buffer_place_bitmap_affine
+ */
+CANVAS_STATIC_INLINE canvas_affine_t canvas_affine_rotate_scale(
+    double angle,
+    double scale,
+    double bitmap_pivot_x,
+    double bitmap_pivot_y,
+    double canvas_pivot_x,
+    double canvas_pivot_y
+)
+{
+    // The inverse transform: rotate back by the angle and undo the scale
+    double c = cos(angle) / scale;
+    double s = sin(angle) / scale;
+    double x = 0.5 - canvas_pivot_x;
+    double y = 0.5 - canvas_pivot_y;
+    canvas_affine_t affine;
+    affine.u_0 = (int32_t)lround((c * x + s * y + bitmap_pivot_x) * 65536.0);
+    affine.u_x = (int32_t)lround(c * 65536.0);
+    affine.u_y = (int32_t)lround(s * 65536.0);
+    affine.v_0 = (int32_t)lround((-s * x + c * y + bitmap_pivot_y) * 65536.0);
+    affine.v_x = (int32_t)lround(-s * 65536.0);
+    affine.v_y = (int32_t)lround(c * 65536.0);
+    return affine;
+}
+
+/**
+ * For internal use. Narrow `[*x_left, *x_right)` to the values of `x` for which `0 <= start + step * x < limit`.
+ *
+ * @param start   Value at `x = 0`
+ * @param step    Change per increment of `x`
+ * @param limit   Upper bound, exclusive
+ * @param x_left  Leftmost value of `x`; may be increased
+ * @param x_right Rightmost value of `x` plus 1; may be decreased
+ */
+CANVAS_STATIC_INLINE void canvas_affine_clip(int64_t start, int64_t step, int64_t limit, int64_t *x_left, int64_t *x_right)
+{
+    int64_t lower;
+    int64_t upper;
+    if (step > 0)
+    {
+        lower = -canvas_raster_floor_div(start, step);
+        upper = -canvas_raster_floor_div(start - limit, step);
+    }
+    else if (step < 0)
+    {
+        lower = canvas_raster_floor_div(start - limit, -step) + 1;
+        upper = canvas_raster_floor_div(start, -step) + 1;
+    }
+    else if (start >= 0 && start < limit)
+    {
+        return;
+    }
+    else
+    {
+        *x_right = *x_left;
+        return;
+    }
+    if (lower > *x_left)
+    {
+        *x_left = lower;
+    }
+    if (upper < *x_right)
+    {
+        *x_right = upper;
+    }
+}
+
+/**
+ * For internal use. @ref canvas_buffer_place_bitmap_affine where row `y_top` of the region starts at `destination`
+ * rather than at its position in a buffer, so that callers can write row windows to memory that is not contiguous.
+ *
+ * @param[out] destination      Start of canvas row `y_top`, i.e. the pixel at X-coordinate 0
+ *
+ * The other parameters are the same as for @ref canvas_buffer_place_bitmap_affine.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap_affine_rows(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t bitmap_stride,
+    size_t bitmap_width,
+    size_t bitmap_height,
+    const canvas_affine_t* CANVAS_RESTRICT transform,
+    const uint8_t* CANVAS_RESTRICT color_key,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    int64_t u_limit = (int64_t)bitmap_width << 16;
+    int64_t v_limit = (int64_t)bitmap_height << 16;
+    uint8_t *row = destination;
+    for (size_t y = y_top; y < y_bottom; y++, row += stride)
+    {
+        int64_t u_start = transform->u_0 + (int64_t)transform->u_y * (int64_t)y;
+        int64_t v_start = transform->v_0 + (int64_t)transform->v_y * (int64_t)y;
+        int64_t span_left = (int64_t)x_left;
+        int64_t span_right = (int64_t)x_right;
+        canvas_affine_clip(u_start, transform->u_x, u_limit, &span_left, &span_right);
+        canvas_affine_clip(v_start, transform->v_x, v_limit, &span_left, &span_right);
+
+        int64_t u = u_start + transform->u_x * span_left;
+        int64_t v = v_start + transform->v_x * span_left;
+        uint8_t *pixel = row + (size_t)span_left * pixel_size;
+        for (int64_t x = span_left; x < span_right; x++)
+        {
+            const uint8_t *source = bitmap + (size_t)(v >> 16) * bitmap_stride + (size_t)(u >> 16) * pixel_size;
+            if (!color_key || memcmp(source, color_key, pixel_size) != 0)
+            {
+                memcpy(pixel, source, pixel_size);
+            }
+            pixel += pixel_size;
+            u += transform->u_x;
+            v += transform->v_x;
+        }
+    }
+}
+
+/**
+ * Place a bitmap into a region of the canvas through an affine transform, e.g. rotated by any angle.
+ *
+ * @param[out] buffer           The buffer into which the bitmap will be placed
+ * @param[in]  bitmap           Pixel data for the bitmap
+ * @param      pixel_size       The size per pixel in bytes, for both the buffer and the bitmap
+ * @param      stride           Number of bytes from the start of one row to the start of the next in `buffer`
+ * @param      bitmap_stride    Number of bytes from the start of one row to the start of the next in `bitmap`
+ * @param      bitmap_width     Width of the bitmap
+ * @param      bitmap_height    Height of the bitmap
+ * @param[in]  transform        Maps canvas coordinates to bitmap coordinates
+ * @param[in]  color_key        Pixel data for a transparent colour which is not copied, or NULL to copy every pixel
+ * @param      x_left           X-coordinate of the left side of the region of the canvas that may be drawn into
+ * @param      x_right          X-coordinate of the right side of the region, plus 1.
+ * @param      y_top            Y-coordinate of the top side of the region
+ * @param      y_bottom         Y-coordinate of the bottom side of the region, plus 1.
+ *
+ * For each row, the span of pixels which map to inside the bitmap is solved for directly,
+ * so only covered pixels are visited and bitmap coordinates are stepped incrementally along the span.
+ * Sampling is nearest-neighbour.
+ *
+ * @note `bitmap` must not overlap the destination region.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_bitmap_affine(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t stride,
+    size_t bitmap_stride,
+    size_t bitmap_width,
+    size_t bitmap_height,
+    const canvas_affine_t* CANVAS_RESTRICT transform,
+    const uint8_t* CANVAS_RESTRICT color_key,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    if (y_bottom <= y_top)
+    {
+        return;
+    }
+    canvas_buffer_place_bitmap_affine_rows(
+        buffer + y_top * stride,
+        bitmap,
+        pixel_size,
+        stride,
+        bitmap_stride,
+        bitmap_width,
+        bitmap_height,
+        transform,
+        color_key,
+        x_left,
+        x_right,
+        y_top,
+        y_bottom
+    );
+}
+
+#ifndef CANVAS_GRADIENT_MAX_PIXEL_SIZE
+    /** Largest pixel size a gradient can produce, in bytes */
+    #define CANVAS_GRADIENT_MAX_PIXEL_SIZE 4
+#endif
+
+/** Number of colours a gradient is precomputed into */
+#define CANVAS_GRADIENT_RAMP_SIZE 256
+
+/**
+ * A colour stop of a gradient.
+ */
+typedef struct canvas_gradient_stop_t {
+    double position;        /**< Where along the gradient the colour is reached, from 0 at the start to 1 at the end */
+    const uint8_t *pixel;   /**< Pixel data for the colour */
+} canvas_gradient_stop_t;
+
+/**
+ * Shape of a gradient.
+ */
+typedef enum canvas_gradient_type_t {
+    CANVAS_GRADIENT_LINEAR,     /**< Constant along lines perpendicular to the line from the start point to the end point */
+    CANVAS_GRADIENT_RADIAL,     /**< Constant along circles around the center */
+} canvas_gradient_type_t;
+
+/**
+ * A linear or radial gradient with any number of colour stops.
+ *
+ * The stops are precomputed into a ramp of @ref CANVAS_GRADIENT_RAMP_SIZE colours,
+ * so filling costs one table lookup per pixel regardless of the number of stops or the pixel format.
+ * Positions along the ramp are in 16.16 fixed point. Linear gradients step them incrementally along each span;
+ * radial ones step the squared distance from the center and take one square root per pixel.
+ *
+ * Set it up with @ref canvas_gradient_init, then @ref canvas_gradient_set_linear or @ref canvas_gradient_set_radial.
+ */
+typedef struct canvas_gradient_t {
+    canvas_gradient_type_t type;    /**< Shape of the gradient */
+    size_t pixel_size;              /**< The size per pixel in bytes */
+    bool dither;                    /**< Whether to dither between neighbouring ramp colours with a 4x4 ordered pattern */
+    int64_t t_0;                    /**< Linear: ramp position of pixel (0, 0), in 16.16 fixed point */
+    int64_t t_x;                    /**< Linear: change in ramp position per column */
+    int64_t t_y;                    /**< Linear: change in ramp position per row */
+    double x_center;                /**< Radial: X-coordinate of the center */
+    double y_center;                /**< Radial: Y-coordinate of the center */
+    double scale;                   /**< Radial: ramp position per pixel of distance from the center, in 16.16 fixed point */
+    uint8_t ramp[CANVAS_GRADIENT_RAMP_SIZE * CANVAS_GRADIENT_MAX_PIXEL_SIZE];   /**< Internal. The precomputed colours */
+} canvas_gradient_t;
+
+/**
+ * Set up the colours of a gradient.
+ *
+ * @param[out] gradient    The gradient
+ * @param[in]  stops       Colour stops, in order of increasing position
+ * @param      stop_count  Number of colour stops; at least 1
+ * @param      pixel_size  The size per pixel in bytes, at most @ref CANVAS_GRADIENT_MAX_PIXEL_SIZE
+ * @param      dither      Whether to dither between neighbouring ramp colours, which hides banding in large, subtle gradients
+ *
+ * Colours are interpolated between stops byte by byte, so this suits formats with 8 bits per channel
+ * such as 8-bit grayscale, RGB888 and ARGB8888, but not packed formats such as RGB565.
+ * Before the first stop and after the last one, the colour of that stop is used.
+ *
+ * The gradient is linear from (0, 0) to (1, 0) until @ref canvas_gradient_set_linear or @ref canvas_gradient_set_radial is called.
+ *
+ * @return Whether the arguments were supported
+ */
+CANVAS_STATIC_INLINE bool canvas_gradient_init(
+    canvas_gradient_t* CANVAS_RESTRICT gradient,
+    const canvas_gradient_stop_t* CANVAS_RESTRICT stops,
+    size_t stop_count,
+    size_t pixel_size,
+    bool dither
+)
+{
+    if (stop_count == 0 || pixel_size > CANVAS_GRADIENT_MAX_PIXEL_SIZE)
+    {
+        return false;
+    }
+    gradient->type = CANVAS_GRADIENT_LINEAR;
+    gradient->pixel_size = pixel_size;
+    gradient->dither = dither;
+    gradient->t_0 = 0;
+    gradient->t_x = (int64_t)(CANVAS_GRADIENT_RAMP_SIZE - 1) << 16;
+    gradient->t_y = 0;
+
+    size_t next = 0;
+    for (size_t i = 0; i < CANVAS_GRADIENT_RAMP_SIZE; i++)
+    {
+        double position = (double)i / (CANVAS_GRADIENT_RAMP_SIZE - 1);
+        while (next < stop_count && stops[next].position <= position)
+        {
+            next++;
+        }
+        uint8_t *color = gradient->ramp + i * pixel_size;
+        if (next == 0 || next == stop_count)
+        {
+            memcpy(color, stops[next == 0 ? 0 : stop_count - 1].pixel, pixel_size);
+            continue;
+        }
+        const canvas_gradient_stop_t *before = &stops[next - 1];
+        const canvas_gradient_stop_t *after = &stops[next];
+        uint32_t weight = (uint32_t)lround((position - before->position) / (after->position - before->position) * 256.0);
+        for (size_t byte = 0; byte < pixel_size; byte++)
+        {
+            color[byte] = (uint8_t)((before->pixel[byte] * (256 - weight) + after->pixel[byte] * weight + 128) >> 8);
+        }
+    }
+    return true;
+}
+
+/**
+ * Make a gradient linear, running from a start point to an end point at any angle.
+ *
+ * @param gradient The gradient
+ * @param x_start  X-coordinate of the point with the colour at position 0
+ * @param y_start  Y-coordinate of the point with the colour at position 0
+ * @param x_end    X-coordinate of the point with the colour at position 1
+ * @param y_end    Y-coordinate of the point with the colour at position 1
+ *
+ * Coordinates are in canvas pixels, with pixel centers at half-integer coordinates.
+ */
+CANVAS_STATIC_INLINE void canvas_gradient_set_linear(canvas_gradient_t *gradient, double x_start, double y_start, double x_end, double y_end)
+{
+    double dx = x_end - x_start;
+    double dy = y_end - y_start;
+    double length_squared = dx * dx + dy * dy;
+    double scale = length_squared > 0 ? (CANVAS_GRADIENT_RAMP_SIZE - 1) * 65536.0 / length_squared : 0;
+    gradient->type = CANVAS_GRADIENT_LINEAR;
+    gradient->t_x = (int64_t)llround(dx * scale);
+    gradient->t_y = (int64_t)llround(dy * scale);
+    gradient->t_0 = (int64_t)llround(((0.5 - x_start) * dx + (0.5 - y_start) * dy) * scale);
+}
+
+/**
+ * Make a gradient radial, running from a center point out to a radius.
+ *
+ * @param gradient The gradient
+ * @param x_center X-coordinate of the center, which has the colour at position 0
+ * @param y_center Y-coordinate of the center
+ * @param radius   Distance from the center at which the colour at position 1 is reached
+ *
+ * Coordinates are in canvas pixels, with pixel centers at half-integer coordinates.
+ */
+CANVAS_STATIC_INLINE void canvas_gradient_set_radial(canvas_gradient_t *gradient, double x_center, double y_center, double radius)
+{
+    gradient->type = CANVAS_GRADIENT_RADIAL;
+    gradient->x_center = x_center;
+    gradient->y_center = y_center;
+    gradient->scale = radius > 0 ? (CANVAS_GRADIENT_RAMP_SIZE - 1) * 65536.0 / radius : 0;
+}
+
+/**
+ * Fill part of a row with a gradient.
+ *
+ * @param      gradient The gradient
+ * @param[out] row      Start of the row, i.e. the pixel at X-coordinate 0
+ * @param      x_left   X-coordinate of the leftmost pixel to fill
+ * @param      x_right  X-coordinate of the rightmost pixel to fill, plus 1.
+ * @param      y        Y-coordinate of the row, which determines the colours
+ */
+CANVAS_STATIC_INLINE void canvas_gradient_row(
+    const canvas_gradient_t* CANVAS_RESTRICT gradient,
+    uint8_t* CANVAS_RESTRICT row,
+    size_t x_left,
+    size_t x_right,
+    size_t y
+)
+{
+    // Thresholds for ordered dithering, in 1/16ths of a ramp step
+    static const uint8_t bayer[4][4] = {
+        {  0,  8,  2, 10 },
+        { 12,  4, 14,  6 },
+        {  3, 11,  1,  9 },
+        { 15,  7, 13,  5 },
+    };
+    size_t pixel_size = gradient->pixel_size;
+    const uint8_t *dither = bayer[y & 3];
+    uint8_t *pixel = row + x_left * pixel_size;
+
+    // Linear gradients step by a constant; radial ones step the squared distance by its exact difference
+    int64_t t = gradient->t_0 + gradient->t_x * (int64_t)x_left + gradient->t_y * (int64_t)y;
+    double dx = (double)x_left + 0.5 - gradient->x_center;
+    double dy = (double)y + 0.5 - gradient->y_center;
+    double distance_squared = dx * dx + dy * dy;
+    for (size_t x = x_left; x < x_right; x++)
+    {
+        if (gradient->type == CANVAS_GRADIENT_RADIAL)
+        {
+            t = (int64_t)(sqrt(distance_squared) * gradient->scale);
+            distance_squared += 2 * dx + 1;
+            dx += 1;
+        }
+        int64_t offset = gradient->dither ? dither[x & 3] * 4096 + 2048 : 32768;
+        int64_t index = (t + offset) >> 16;
+        if (index < 0)
+        {
+            index = 0;
+        }
+        else if (index >= CANVAS_GRADIENT_RAMP_SIZE)
+        {
+            index = CANVAS_GRADIENT_RAMP_SIZE - 1;
+        }
+        memcpy(pixel, gradient->ramp + (size_t)index * pixel_size, pixel_size);
+        pixel += pixel_size;
+        t += gradient->t_x;
+    }
+}
+
+/**
+ * Context for @ref canvas_buffer_gradient_span.
+ */
+typedef struct canvas_buffer_gradient_span_context_t {
+    uint8_t *buffer;                        /**< The buffer into which the spans will be placed */
+    const canvas_gradient_t *gradient;      /**< The gradient to fill the spans with */
+    size_t stride;                          /**< Number of bytes from the start of one row to the start of the next */
+} canvas_buffer_gradient_span_context_t;
+
+/**
+ * Span function which fills each span in a buffer with a gradient, for passing to the rasterizers in the @ref RASTER_API.
+ *
+ * @param context  Pointer to a @ref canvas_buffer_gradient_span_context_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_gradient_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_buffer_gradient_span_context_t *span = (const canvas_buffer_gradient_span_context_t *)context;
+    canvas_gradient_row(span->gradient, span->buffer + (size_t)y * span->stride, (size_t)x_left, (size_t)x_right, (size_t)y);
+}
+
+/**
+ * Fill a rectangle with a gradient.
+ *
+ * @param[out] buffer     The buffer into which the rectangle will be placed
+ * @param[in]  gradient   The gradient, with the same pixel size as the buffer
+ * @param      stride     Number of bytes from the start of one row to the start of the next
+ * @param      x_left     X-coordinate of the left side of the rectangle
+ * @param      x_right    X-coordinate of the right side of the rectangle, plus 1.
+ * @param      y_top      Y-coordinate of the top side of the rectangle
+ * @param      y_bottom   Y-coordinate of the bottom side of the rectangle, plus 1.
+ *
+ * The gradient is positioned relative to the buffer, not to the rectangle.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_rect_gradient(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_gradient_t* CANVAS_RESTRICT gradient,
+    size_t stride,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        canvas_gradient_row(gradient, buffer + y * stride, x_left, x_right, y);
+    }
+}
+
+/**
+ * Fill a triangle with a gradient.
+ *
+ * @param[out] buffer     The buffer into which the triangle will be placed
+ * @param[in]  gradient   The gradient, with the same pixel size as the buffer
+ * @param      stride     Number of bytes from the start of one row to the start of the next
+ * @param      x_0        X-coordinate of the first vertex
+ * @param      x_1        X-coordinate of the second vertex
+ * @param      x_2        X-coordinate of the third vertex
+ * @param      y_0        Y-coordinate of the first vertex
+ * @param      y_1        Y-coordinate of the second vertex
+ * @param      y_2        Y-coordinate of the third vertex
+ *
+ * Covers the same pixels as @ref canvas_buffer_fill_triangle_stride.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_triangle_gradient(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_gradient_t* CANVAS_RESTRICT gradient,
+    size_t stride,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    canvas_buffer_gradient_span_context_t span = { buffer, gradient, stride };
+    canvas_raster_fill_triangle(
+        (int)x_0,
+        (int)x_1,
+        (int)x_2,
+        (int)y_0,
+        (int)y_1,
+        (int)y_2,
+        canvas_buffer_gradient_span,
+        &span
+    );
+}
+
+/**
+ * Fill a circle with a gradient.
+ *
+ * @param[out] buffer     The buffer into which the circle will be placed
+ * @param[in]  gradient   The gradient, with the same pixel size as the buffer
+ * @param      stride     Number of bytes from the start of one row to the start of the next
+ * @param      x_center   X-coordinate of the center of the circle
+ * @param      y_center   Y-coordinate of the center of the circle
+ * @param      radius     The radius of the circle
+ *
+ * Covers the same pixels as @ref canvas_buffer_fill_circle_stride.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_circle_gradient(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_gradient_t* CANVAS_RESTRICT gradient,
+    size_t stride,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_buffer_gradient_span_context_t span = { buffer, gradient, stride };
+    canvas_raster_fill_circle((int)x_center, (int)y_center, (int)radius, canvas_buffer_gradient_span, &span);
+}
+
+/**
+ * A bitmap which is repeated in both directions to fill shapes, such as a hatching tile or a texture.
+ *
+ * Set it up with @ref canvas_pattern_init. A bitmap at least as large as the filled area acts as a plain texture.
+ */
+typedef struct canvas_pattern_t {
+    const uint8_t *pixels;  /**< Pixel data for the bitmap */
+    size_t pixel_size;      /**< The size per pixel in bytes */
+    size_t stride;          /**< Number of bytes from the start of one row of the bitmap to the start of the next */
+    size_t width;           /**< Width of the bitmap */
+    size_t height;          /**< Height of the bitmap */
+    size_t x_offset;        /**< X-coordinate in the canvas at which the left side of a copy of the bitmap is placed */
+    size_t y_offset;        /**< Y-coordinate in the canvas at which the top side of a copy of the bitmap is placed */
+} canvas_pattern_t;
+
+/**
+ * Returns a pattern which repeats a bitmap.
+ *
+ * @param pixels     Pixel data for the bitmap, with the same pixel size as the canvas it will fill
+ * @param pixel_size The size per pixel in bytes
+ * @param stride     Number of bytes from the start of one row of the bitmap to the start of the next
+ * @param width      Width of the bitmap; at least 1
+ * @param height     Height of the bitmap; at least 1
+ * @param x_offset   X-coordinate in the canvas at which the left side of a copy of the bitmap is placed
+ * @param y_offset   Y-coordinate in the canvas at which the top side of a copy of the bitmap is placed
+ *
+ * The offsets only matter modulo the size of the bitmap, so they can be used to scroll a texture.
+ *
+ * @return Pattern
+ */
+CANVAS_STATIC_INLINE canvas_pattern_t canvas_pattern_init(
+    const uint8_t *pixels,
+    size_t pixel_size,
+    size_t stride,
+    size_t width,
+    size_t height,
+    size_t x_offset,
+    size_t y_offset
+)
+{
+    canvas_pattern_t pattern;
+    pattern.pixels = pixels;
+    pattern.pixel_size = pixel_size;
+    pattern.stride = stride;
+    pattern.width = width;
+    pattern.height = height;
+    pattern.x_offset = x_offset % width;
+    pattern.y_offset = y_offset % height;
+    return pattern;
+}
+
+/**
+ * Fill part of a row with a pattern.
+ *
+ * @param      pattern  The pattern
+ * @param[out] row      Start of the row, i.e. the pixel at X-coordinate 0
+ * @param      x_left   X-coordinate of the leftmost pixel to fill
+ * @param      x_right  X-coordinate of the rightmost pixel to fill, plus 1.
+ * @param      y        Y-coordinate of the row, which selects the row of the pattern
+ *
+ * The span is filled with whole-row copies: up to where the pattern wraps around,
+ * then one period of it, and then the filled part of the span is copied onto itself in doubling lengths,
+ * so narrow hatching tiles cost a handful of copies per span rather than one per repetition.
+ */
+CANVAS_STATIC_INLINE void canvas_pattern_row(
+    const canvas_pattern_t* CANVAS_RESTRICT pattern,
+    uint8_t* CANVAS_RESTRICT row,
+    size_t x_left,
+    size_t x_right,
+    size_t y
+)
+{
+    if (x_left >= x_right)
+    {
+        return;
+    }
+    size_t pixel_size = pattern->pixel_size;
+    size_t pattern_y = (y + pattern->height - pattern->y_offset) % pattern->height;
+    size_t pattern_x = (x_left + pattern->width - pattern->x_offset) % pattern->width;
+    const uint8_t *source = pattern->pixels + pattern_y * pattern->stride;
+    uint8_t *destination = row + x_left * pixel_size;
+    size_t remaining = x_right - x_left;
+
+    // Up to the point where the pattern wraps around
+    size_t count = pattern->width - pattern_x < remaining ? pattern->width - pattern_x : remaining;
+    memcpy(destination, source + pattern_x * pixel_size, count * pixel_size);
+    destination += count * pixel_size;
+    remaining -= count;
+    if (remaining == 0)
+    {
+        return;
+    }
+
+    // One whole period, after which the rest of the span repeats what has been written
+    count = pattern->width < remaining ? pattern->width : remaining;
+    memcpy(destination, source, count * pixel_size);
+    size_t period_start = 0;
+    size_t written = count * pixel_size;
+    remaining -= count;
+    size_t remaining_bytes = remaining * pixel_size;
+    while (remaining_bytes > 0)
+    {
+        size_t size = written - period_start < remaining_bytes ? written - period_start : remaining_bytes;
+        memcpy(destination + written, destination + period_start, size);
+        written += size;
+        remaining_bytes -= size;
+    }
+}
+
+/**
+ * Context for @ref canvas_buffer_pattern_span.
+ */
+typedef struct canvas_buffer_pattern_span_context_t {
+    uint8_t *buffer;                    /**< The buffer into which the spans will be placed */
+    const canvas_pattern_t *pattern;    /**< The pattern to fill the spans with */
+    size_t stride;                      /**< Number of bytes from the start of one row to the start of the next */
+} canvas_buffer_pattern_span_context_t;
+
+/**
+ * Span function which fills each span in a buffer with a pattern, for passing to the rasterizers in the @ref RASTER_API.
+ *
+ * @param context  Pointer to a @ref canvas_buffer_pattern_span_context_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_pattern_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_buffer_pattern_span_context_t *span = (const canvas_buffer_pattern_span_context_t *)context;
+    canvas_pattern_row(span->pattern, span->buffer + (size_t)y * span->stride, (size_t)x_left, (size_t)x_right, (size_t)y);
+}
+
+/**
+ * Fill a rectangle with a pattern.
+ *
+ * @param[out] buffer     The buffer into which the rectangle will be placed
+ * @param[in]  pattern    The pattern, with the same pixel size as the buffer
+ * @param      stride     Number of bytes from the start of one row to the start of the next
+ * @param      x_left     X-coordinate of the left side of the rectangle
+ * @param      x_right    X-coordinate of the right side of the rectangle, plus 1.
+ * @param      y_top      Y-coordinate of the top side of the rectangle
+ * @param      y_bottom   Y-coordinate of the bottom side of the rectangle, plus 1.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_rect_pattern(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_pattern_t* CANVAS_RESTRICT pattern,
+    size_t stride,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        canvas_pattern_row(pattern, buffer + y * stride, x_left, x_right, y);
+    }
+}
+
+/**
+ * Fill a triangle with a pattern. Covers the same pixels as @ref canvas_buffer_fill_triangle_stride.
+ *
+ * @param[out] buffer     The buffer into which the triangle will be placed
+ * @param[in]  pattern    The pattern, with the same pixel size as the buffer
+ * @param      stride     Number of bytes from the start of one row to the start of the next
+ * @param      x_0        X-coordinate of the first vertex
+ * @param      x_1        X-coordinate of the second vertex
+ * @param      x_2        X-coordinate of the third vertex
+ * @param      y_0        Y-coordinate of the first vertex
+ * @param      y_1        Y-coordinate of the second vertex
+ * @param      y_2        Y-coordinate of the third vertex
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_triangle_pattern(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_pattern_t* CANVAS_RESTRICT pattern,
+    size_t stride,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    canvas_buffer_pattern_span_context_t span = { buffer, pattern, stride };
+    canvas_raster_fill_triangle(
+        (int)x_0,
+        (int)x_1,
+        (int)x_2,
+        (int)y_0,
+        (int)y_1,
+        (int)y_2,
+        canvas_buffer_pattern_span,
+        &span
+    );
+}
+
+/**
+ * Fill a circle with a pattern. Covers the same pixels as @ref canvas_buffer_fill_circle_stride.
+ *
+ * @param[out] buffer     The buffer into which the circle will be placed
+ * @param[in]  pattern    The pattern, with the same pixel size as the buffer
+ * @param      stride     Number of bytes from the start of one row to the start of the next
+ * @param      x_center   X-coordinate of the center of the circle
+ * @param      y_center   Y-coordinate of the center of the circle
+ * @param      radius     The radius of the circle
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_fill_circle_pattern(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_pattern_t* CANVAS_RESTRICT pattern,
+    size_t stride,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_buffer_pattern_span_context_t span = { buffer, pattern, stride };
+    canvas_raster_fill_circle((int)x_center, (int)y_center, (int)radius, canvas_buffer_pattern_span, &span);
+}
+
+/**
+ * @name Run-length encoded sprites
+ *
+ * A compact sprite format for mostly flat images such as UI icons, decoded straight into the canvas.
+ *
+ * Each row of a sprite is a sequence of operations, each starting with one header byte.
+ * The top two bits of the header select the operation and the low six bits hold the pixel count minus 1:
+ * - @ref CANVAS_RLE_SKIP: skip over transparent pixels; no pixel data follows
+ * - @ref CANVAS_RLE_RUN: one pixel follows, which fills the whole count
+ * - @ref CANVAS_RLE_LITERAL: `count` pixels follow, which are copied as they are
+ * - @ref CANVAS_RLE_END_OF_ROW: the rest of the row is transparent; the low bits are ignored
+ *
+ * Every row ends with @ref CANVAS_RLE_END_OF_ROW. Sprites are made by @ref canvas_rle_encode,
+ * typically offline, with the result stored as a constant array in flash.
+ *
+ * @{
+ */
+
+#define CANVAS_RLE_SKIP        0x00  /**< Header of an operation which skips transparent pixels */
+#define CANVAS_RLE_RUN         0x40  /**< Header of an operation which repeats one pixel */
+#define CANVAS_RLE_LITERAL     0x80  /**< Header of an operation which copies pixels */
+#define CANVAS_RLE_END_OF_ROW  0xC0  /**< Header which ends a row */
+#define CANVAS_RLE_MAX_COUNT   64    /**< Largest number of pixels in one operation */
+
+/**
+ * A run-length encoded sprite.
+ */
+typedef struct canvas_rle_sprite_t {
+    const uint8_t *data;    /**< The operations, as produced by @ref canvas_rle_encode */
+    size_t width;           /**< Width of the sprite */
+    size_t height;          /**< Height of the sprite */
+    size_t pixel_size;      /**< The size per pixel in bytes */
+} canvas_rle_sprite_t;
+
+/**
+ * The largest number of bytes @ref canvas_rle_encode can produce for a bitmap of the given size.
+ *
+ * @param width      Width of the bitmap
+ * @param height     Height of the bitmap
+ * @param pixel_size The size per pixel in bytes
+ *
+ * @return Size in bytes
+ */
+CANVAS_STATIC_INLINE size_t canvas_rle_max_size(size_t width, size_t height, size_t pixel_size)
+{
+    // At worst every pixel is an operation of its own, plus the end of each row
+    return height * (width * (1 + pixel_size) + 1);
+}
+
+/**
+ * Run-length encode a bitmap into a sprite.
+ *
+ * @param[out] destination    Receives the encoded operations, or NULL to only measure their size.
+ *                            Must have room for @ref canvas_rle_max_size bytes, or for the size measured beforehand.
+ * @param[in]  bitmap         Pixel data for the bitmap
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      bitmap_stride  Number of bytes from the start of one row of the bitmap to the start of the next
+ * @param      width          Width of the bitmap
+ * @param      height         Height of the bitmap
+ * @param[in]  color_key      Pixel data for a transparent colour which is skipped when placing the sprite,
+ *                            or NULL for a sprite without transparency
+ *
+ * Runs of two or more equal pixels become runs, transparent pixels become skips or are dropped at the end of a row,
+ * and everything else is gathered into literals.
+ *
+ * @return Number of bytes of encoded operations
+ */
+CANVAS_STATIC_INLINE size_t canvas_rle_encode(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t bitmap_stride,
+    size_t width,
+    size_t height,
+    const uint8_t* CANVAS_RESTRICT color_key
+)
+{
+    size_t size = 0;
+    for (size_t y = 0; y < height; y++)
+    {
+        const uint8_t *row = bitmap + y * bitmap_stride;
+        size_t x = 0;
+        while (x < width)
+        {
+            const uint8_t *pixel = row + x * pixel_size;
+            size_t count = 1;
+            if (color_key && memcmp(pixel, color_key, pixel_size) == 0)
+            {
+                while (x + count < width && memcmp(row + (x + count) * pixel_size, color_key, pixel_size) == 0)
+                {
+                    count++;
+                }
+                if (x + count == width)
+                {
+                    break;
+                }
+                for (size_t done = 0; done < count; done += CANVAS_RLE_MAX_COUNT)
+                {
+                    size_t part = count - done < CANVAS_RLE_MAX_COUNT ? count - done : CANVAS_RLE_MAX_COUNT;
+                    if (destination)
+                    {
+                        destination[size] = (uint8_t)(CANVAS_RLE_SKIP | (part - 1));
+                    }
+                    size++;
+                }
+                x += count;
+                continue;
+            }
+
+            while (count < CANVAS_RLE_MAX_COUNT && x + count < width && memcmp(row + (x + count) * pixel_size, pixel, pixel_size) == 0)
+            {
+                count++;
+            }
+            if (count >= 2)
+            {
+                if (destination)
+                {
+                    destination[size] = (uint8_t)(CANVAS_RLE_RUN | (count - 1));
+                    memcpy(destination + size + 1, pixel, pixel_size);
+                }
+                size += 1 + pixel_size;
+                x += count;
+                continue;
+            }
+
+            // Gather pixels until a transparent one or the start of a run
+            count = 1;
+            while (count < CANVAS_RLE_MAX_COUNT && x + count < width)
+            {
+                const uint8_t *next = row + (x + count) * pixel_size;
+                if (color_key && memcmp(next, color_key, pixel_size) == 0)
+                {
+                    break;
+                }
+                if (x + count + 1 < width && memcmp(next, next + pixel_size, pixel_size) == 0)
+                {
+                    break;
+                }
+                count++;
+            }
+            if (destination)
+            {
+                destination[size] = (uint8_t)(CANVAS_RLE_LITERAL | (count - 1));
+                memcpy(destination + size + 1, pixel, count * pixel_size);
+            }
+            size += 1 + count * pixel_size;
+            x += count;
+        }
+        if (destination)
+        {
+            destination[size] = CANVAS_RLE_END_OF_ROW;
+        }
+        size++;
+    }
+    return size;
+}
+
+/**
+ * For internal use. Decode one row of a sprite.
+ *
+ * @param[out] row        Leftmost pixel of the row in the destination
+ * @param[in]  data       The operations of the row
+ * @param      pixel_size The size per pixel in bytes
+ *
+ * @return The operations of the next row
+ */
+CANVAS_STATIC_INLINE const uint8_t *canvas_rle_decode_row(
+    uint8_t* CANVAS_RESTRICT row,
+    const uint8_t* CANVAS_RESTRICT data,
+    size_t pixel_size
+)
+{
+    for (;;)
+    {
+        uint8_t header = *data++;
+        size_t count = (size_t)(header & 0x3F) + 1;
+        switch (header & 0xC0)
+        {
+            case CANVAS_RLE_SKIP:
+                break;
+            case CANVAS_RLE_RUN:
+                canvas_buffer_fill_rect_stride(row, data, pixel_size, 0, 0, count, 0, 1);
+                data += pixel_size;
+                break;
+            case CANVAS_RLE_LITERAL:
+                memcpy(row, data, count * pixel_size);
+                data += count * pixel_size;
+                break;
+            default:
+                return data;
+        }
+        row += count * pixel_size;
+    }
+}
+
+/**
+ * Place a run-length encoded sprite into the canvas.
+ *
+ * @param[out] buffer      The buffer into which the sprite will be placed
+ * @param[in]  sprite      The sprite, with the same pixel size as the buffer
+ * @param      stride      Number of bytes from the start of one row to the start of the next
+ * @param      x_left      X-coordinate of the left side of the sprite
+ * @param      y_top       Y-coordinate of the top side of the sprite
+ *
+ * Runs become row fills, literals become copies, and transparent pixels are skipped without being read or written.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_rle(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_rle_sprite_t* CANVAS_RESTRICT sprite,
+    size_t stride,
+    size_t x_left,
+    size_t y_top
+)
+{
+    const uint8_t *data = sprite->data;
+    uint8_t *row = buffer + y_top * stride + x_left * sprite->pixel_size;
+    for (size_t y = 0; y < sprite->height; y++)
+    {
+        data = canvas_rle_decode_row(row, data, sprite->pixel_size);
+        row += stride;
+    }
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @name Colour-keyed sprites
+ *
+ * A sprite is a bitmap with a transparent colour, drawn many times at different positions.
+ * Its rows are scanned once into lists of opaque spans, so placing an instance copies the opaque
+ * pixels span by span instead of comparing every pixel against the colour key again.
+ *
+ * @{
+ */
+
+/**
+ * A run of opaque pixels on one row of a sprite.
+ */
+typedef struct canvas_sprite_span_t {
+    size_t y;           /**< Row of the span within the sprite */
+    size_t x_left;      /**< X-coordinate of the leftmost pixel in the span */
+    size_t x_right;     /**< X-coordinate of the rightmost pixel in the span, plus 1. */
+} canvas_sprite_span_t;
+
+/**
+ * A sprite, set up with @ref canvas_sprite_init.
+ */
+typedef struct canvas_sprite_t {
+    const uint8_t *bitmap;              /**< Pixel data for the sprite */
+    size_t pixel_size;                  /**< The size per pixel in bytes */
+    size_t bitmap_stride;               /**< Number of bytes from the start of one row of the bitmap to the start of the next */
+    size_t width;                       /**< Width of the sprite */
+    size_t height;                      /**< Height of the sprite */
+    const canvas_sprite_span_t *spans;  /**< The opaque spans, sorted by row */
+    size_t span_count;                  /**< Number of opaque spans */
+} canvas_sprite_t;
+
+/**
+ * Scan a bitmap for runs of pixels which are not the colour key.
+ *
+ * @param[out] spans          Receives the spans, sorted by row, or NULL to only count them.
+ *                            Room for `height * ((width + 1) / 2)` spans is always enough.
+ * @param[in]  bitmap         Pixel data for the bitmap
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      bitmap_stride  Number of bytes from the start of one row of the bitmap to the start of the next
+ * @param      width          Width of the bitmap
+ * @param      height         Height of the bitmap
+ * @param[in]  color_key      Pixel data for the transparent colour
+ *
+ * @return Number of spans
+ */
+CANVAS_STATIC_INLINE size_t canvas_sprite_scan(
+    canvas_sprite_span_t* CANVAS_RESTRICT spans,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t bitmap_stride,
+    size_t width,
+    size_t height,
+    const uint8_t* CANVAS_RESTRICT color_key
+)
+{
+    size_t count = 0;
+    for (size_t y = 0; y < height; y++)
+    {
+        const uint8_t *row = bitmap + y * bitmap_stride;
+        size_t x = 0;
+        while (x < width)
+        {
+            while (x < width && memcmp(row + x * pixel_size, color_key, pixel_size) == 0)
+            {
+                x++;
+            }
+            if (x == width)
+            {
+                break;
+            }
+            size_t x_left = x;
+            while (x < width && memcmp(row + x * pixel_size, color_key, pixel_size) != 0)
+            {
+                x++;
+            }
+            if (spans)
+            {
+                spans[count].y = y;
+                spans[count].x_left = x_left;
+                spans[count].x_right = x;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Set up a sprite by scanning its bitmap for opaque spans.
+ *
+ * @param[out] sprite         The sprite
+ * @param[out] spans          Receives the spans. Must have room for as many as @ref canvas_sprite_scan counts,
+ *                            and must stay valid as long as the sprite is used.
+ * @param[in]  bitmap         Pixel data for the sprite, which must stay valid as long as the sprite is used
+ * @param      pixel_size     The size per pixel in bytes
+ * @param      bitmap_stride  Number of bytes from the start of one row of the bitmap to the start of the next
+ * @param      width          Width of the sprite
+ * @param      height         Height of the sprite
+ * @param[in]  color_key      Pixel data for the transparent colour
+ */
+CANVAS_STATIC_INLINE void canvas_sprite_init(
+    canvas_sprite_t* CANVAS_RESTRICT sprite,
+    canvas_sprite_span_t* CANVAS_RESTRICT spans,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t pixel_size,
+    size_t bitmap_stride,
+    size_t width,
+    size_t height,
+    const uint8_t* CANVAS_RESTRICT color_key
+)
+{
+    sprite->bitmap = bitmap;
+    sprite->pixel_size = pixel_size;
+    sprite->bitmap_stride = bitmap_stride;
+    sprite->width = width;
+    sprite->height = height;
+    sprite->spans = spans;
+    sprite->span_count = canvas_sprite_scan(spans, bitmap, pixel_size, bitmap_stride, width, height, color_key);
+}
+
+/**
+ * Place the opaque pixels of a sprite into the canvas.
+ *
+ * @param[out] buffer      The buffer into which the sprite will be placed
+ * @param[in]  sprite      The sprite, with the same pixel size as the buffer
+ * @param      stride      Number of bytes from the start of one row to the start of the next
+ * @param      x_left      X-coordinate of the left side of the sprite
+ * @param      y_top       Y-coordinate of the top side of the sprite
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_place_sprite(
+    uint8_t* CANVAS_RESTRICT buffer,
+    const canvas_sprite_t* CANVAS_RESTRICT sprite,
+    size_t stride,
+    size_t x_left,
+    size_t y_top
+)
+{
+    size_t pixel_size = sprite->pixel_size;
+    uint8_t *origin = buffer + y_top * stride + x_left * pixel_size;
+    for (size_t i = 0; i < sprite->span_count; i++)
+    {
+        const canvas_sprite_span_t *span = &sprite->spans[i];
+        memcpy(
+            origin + span->y * stride + span->x_left * pixel_size,
+            sprite->bitmap + span->y * sprite->bitmap_stride + span->x_left * pixel_size,
+            (span->x_right - span->x_left) * pixel_size
+        );
+    }
+}
+
+/**
+ * @}
+ */
+
+/**
+ * Expand palette indices into pixels by looking each index up in a palette.
+ *
+ * @param[out] destination      Destination buffer; `count * color_size` bytes of expanded pixels will be placed here.
+ * @param[in]  source           Source buffer holding `count` one-byte palette indices.
+ * @param[in]  colors           The palette, holding one pixel of `color_size` bytes per index.
+ * @param      color_size       The size per expanded pixel in bytes, e.g. 2 for RGB565, 3 for RGB888 or 4 for ARGB8888
+ * @param      count            Number of pixels to expand
+ *
+ * @note `colors` must have an entry for every index that occurs in `source`.
+ */
+CANVAS_STATIC_INLINE void canvas_buffer_expand_indexed(
+    uint8_t* CANVAS_RESTRICT destination,
+    const uint8_t* CANVAS_RESTRICT source,
+    const uint8_t* CANVAS_RESTRICT colors,
+    size_t color_size,
+    size_t count
+)
+{
+    CANVAS_KERNELS_LOAD();
+    CANVAS_KERNEL(expand_indexed)(destination, source, colors, color_size, count);
+}
+
+/**
+ * @}
+ */
+
+#if CANVAS_FEATURE_THREAD_POOL
+/**
+ * @defgroup THREAD_POOL Thread pool
+ *
+ * Split whole-canvas operations across cores.
+ *
+ * @ref canvas_fill, the rotations and flips, @ref canvas_export_indexed and @ref canvas_place_bitmap
+ * touch every row independently. When a canvas has been given a @ref canvas_parallel_t with @ref canvas_set_parallel,
+ * these operations split their rows into bands and run the bands as tasks on a thread pool,
+ * unless they touch fewer bytes than the threshold, below which the cost of waking threads outweighs the gain.
+ *
+ * The pool can be the built-in one (@ref canvas_thread_pool_start) or any other, through @ref canvas_parallel_function_t.
+ *
+ * Exists only if @ref CANVAS_FEATURE_THREAD_POOL=1. The built-in pool requires POSIX threads.
+ *
+ * @{
+ */
+
+#ifndef CANVAS_THREAD_POOL_MAX_THREADS
+    /** Largest number of worker threads in the built-in thread pool */
+    #define CANVAS_THREAD_POOL_MAX_THREADS 16
+#endif
+
+#ifndef CANVAS_PARALLEL_DEFAULT_THRESHOLD
+    /** Smallest number of bytes an operation must touch before the built-in thread pool splits it */
+    #define CANVAS_PARALLEL_DEFAULT_THRESHOLD (256 * 1024)
+#endif
+
+/**
+ * One of a number of tasks that can run at the same time.
+ *
+ * @param context The context pointer that was passed along with the tasks
+ * @param index   Index of the task, from 0 up to the number of tasks
+ */
+typedef void (*canvas_task_function_t)(void *context, size_t index);
+
+/**
+ * Runs tasks on a thread pool.
+ *
+ * @param pool    The pool, as given in @ref canvas_parallel_t::pool
+ * @param task    Called once for each index from 0 up to `count`, from any thread and in any order
+ * @param context Passed to `task`
+ * @param count   Number of tasks
+ *
+ * Must not return before every task has finished.
+ */
+typedef void (*canvas_parallel_function_t)(void *pool, canvas_task_function_t task, void *context, size_t count);
+
+/**
+ * Describes how a canvas runs its operations in parallel.
+ */
+typedef struct canvas_parallel_t {
+    canvas_parallel_function_t function;    /**< Runs tasks on the pool */
+    void *pool;                             /**< Passed to `function` */
+    size_t band_count;                      /**< Number of row bands to split an operation into, e.g. the number of threads */
+    size_t threshold;                       /**< Operations which touch fewer bytes than this run on the calling thread only */
+} canvas_parallel_t;
+
+/**
+ * A simple built-in thread pool. The calling thread takes part in running the tasks.
+ *
+ * Must be set up with @ref canvas_thread_pool_start, and must not move while it runs.
+ */
+typedef struct canvas_thread_pool_t {
+    pthread_t threads[CANVAS_THREAD_POOL_MAX_THREADS];  /**< Internal. The worker threads */
+    size_t thread_count;                                /**< Number of worker threads */
+    pthread_mutex_t mutex;                              /**< Internal. Guards the fields below, except `next` */
+    pthread_cond_t wake;                                /**< Internal. Signalled when there are new tasks or the pool stops */
+    pthread_cond_t done;                                /**< Internal. Signalled when the last worker finishes its tasks */
+    canvas_task_function_t task;                        /**< Internal. The current tasks */
+    void *context;                                      /**< Internal. Passed to `task` */
+    size_t count;                                       /**< Internal. Number of current tasks */
+    size_t next;                                        /**< Internal. Index of the next task to take. Taken with an atomic increment. */
+    size_t active;                                      /**< Internal. Number of workers still taking current tasks */
+    size_t generation;                                  /**< Internal. Incremented for each call to @ref canvas_thread_pool_run */
+    bool stopping;                                      /**< Internal. Set to stop the workers */
+} canvas_thread_pool_t;
+
+/**
+ * For internal use. Take and run tasks until there are none left.
+ */
+CANVAS_STATIC_INLINE void canvas_thread_pool_drain(canvas_thread_pool_t *pool)
+{
+    for (;;)
+    {
+        size_t index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (index >= pool->count)
+        {
+            return;
+        }
+        pool->task(pool->context, index);
+    }
+}
+
+/**
+ * For internal use. Body of each worker thread of the built-in thread pool.
+ */
+CANVAS_STATIC_INLINE void *canvas_thread_pool_worker(void *argument)
+{
+    canvas_thread_pool_t *pool = (canvas_thread_pool_t *)argument;
+    size_t generation = 0;
+    pthread_mutex_lock(&pool->mutex);
+    for (;;)
+    {
+        while (pool->generation == generation && !pool->stopping)
+        {
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->stopping)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        canvas_thread_pool_drain(pool);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->active == 0)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+}
+
+/**
+ * Run tasks on the built-in thread pool and wait for them to finish. Matches @ref canvas_parallel_function_t.
+ *
+ * @param pool    Pointer to a @ref canvas_thread_pool_t
+ * @param task    Called once for each index from 0 up to `count`
+ * @param context Passed to `task`
+ * @param count   Number of tasks
+ *
+ * Must only be called from one thread at a time.
+ */
+CANVAS_STATIC_INLINE void canvas_thread_pool_run(void *pool, canvas_task_function_t task, void *context, size_t count)
+{
+    canvas_thread_pool_t *thread_pool = (canvas_thread_pool_t *)pool;
+    pthread_mutex_lock(&thread_pool->mutex);
+    thread_pool->task = task;
+    thread_pool->context = context;
+    thread_pool->count = count;
+    thread_pool->next = 0;
+    thread_pool->active = thread_pool->thread_count;
+    thread_pool->generation++;
+    pthread_cond_broadcast(&thread_pool->wake);
+    pthread_mutex_unlock(&thread_pool->mutex);
+
+    canvas_thread_pool_drain(thread_pool);
+
+    // Every worker must be done with this generation before the next one overwrites the tasks
+    pthread_mutex_lock(&thread_pool->mutex);
+    while (thread_pool->active > 0)
+    {
+        pthread_cond_wait(&thread_pool->done, &thread_pool->mutex);
+    }
+    pthread_mutex_unlock(&thread_pool->mutex);
+}
+
+/**
+ * Stop the workers of the built-in thread pool and wait for them to finish.
+ *
+ * @param pool A pool set up with @ref canvas_thread_pool_start
+ */
+CANVAS_STATIC_INLINE void canvas_thread_pool_stop(canvas_thread_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    for (size_t i = 0; i < pool->thread_count; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+/**
+ * Start the built-in thread pool.
+ *
+ * @param pool         The pool
+ * @param thread_count Number of worker threads, up to @ref CANVAS_THREAD_POOL_MAX_THREADS.
+ *                     The calling thread also runs tasks, so one less than the number of cores keeps every core busy.
+ *
+ * @return Whether the pool was started. On failure, `errno` is set.
+ */
+CANVAS_STATIC_INLINE bool canvas_thread_pool_start(canvas_thread_pool_t *pool, size_t thread_count)
+{
+    if (thread_count > CANVAS_THREAD_POOL_MAX_THREADS)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        int error = pthread_create(&pool->threads[i], NULL, canvas_thread_pool_worker, pool);
+        if (error != 0)
+        {
+            canvas_thread_pool_stop(pool);
+            errno = error;
+            return false;
+        }
+        pool->thread_count = i + 1;
+    }
+    return true;
+}
+
+/**
+ * Returns a description of the built-in thread pool, for @ref canvas_set_parallel.
+ *
+ * @param pool A pool set up with @ref canvas_thread_pool_start
+ *
+ * Operations are split into one band per thread, including the calling thread,
+ * and run in parallel from @ref CANVAS_PARALLEL_DEFAULT_THRESHOLD bytes.
+ *
+ * @return Description of the pool
+ */
+CANVAS_STATIC_INLINE canvas_parallel_t canvas_thread_pool_parallel(canvas_thread_pool_t *pool)
+{
+    canvas_parallel_t parallel;
+    parallel.function = canvas_thread_pool_run;
+    parallel.pool = pool;
+    parallel.band_count = pool->thread_count + 1;
+    parallel.threshold = CANVAS_PARALLEL_DEFAULT_THRESHOLD;
+    return parallel;
+}
+
+/**
+ * @}
+ */
+#endif
+
+#if CANVAS_FEATURE_FAST_CLEAR
+/**
+ * @defgroup FAST_CLEAR Fast clear
+ *
+ * Clear the canvas without writing to it.
+ *
+ * Frames are often cleared in full and then mostly redrawn, which writes most pixels twice.
+ * When a canvas has been given a @ref canvas_fast_clear_t with @ref canvas_set_fast_clear,
+ * @ref canvas_fill only records the pixel value and marks every tile of the canvas as cleared.
+ * A marked tile is filled the first time anything draws into it or reads it, and not at all if it is covered
+ * by a rectangle, bitmap or glyph that replaces every pixel in it. Exporting, presenting, rotating or flipping the canvas
+ * fills all the tiles that are still marked.
+ *
+ * The functions of the @ref CANVAS_API take care of this. Code that accesses the buffer directly,
+ * e.g. through @ref canvas_row, must first call @ref canvas_fast_clear_resolve for the pixels it touches,
+ * or @ref canvas_fast_clear_resolve_all.
+ *
+ * Views made with @ref canvas_view share the tiles of their parent, so drawing into a view fills the parent's tiles it touches,
+ * and filling a view fills it immediately.
+ *
+ * Tiles are filled on the thread that draws into them, so a canvas with pending tiles must not be drawn into
+ * from several threads at once. Operations that split across a thread pool fill the tiles they touch before splitting.
+ *
+ * @{
+ */
+
+#ifndef CANVAS_FAST_CLEAR_MAX_PIXEL_SIZE
+    /** Largest pixel size that can be cleared lazily, in bytes. Canvases with larger pixels are cleared immediately. */
+    #define CANVAS_FAST_CLEAR_MAX_PIXEL_SIZE 4
+#endif
+
+/**
+ * Tiles of a canvas and the pixel value that marked tiles are cleared to.
+ */
+typedef struct canvas_fast_clear_t {
+    size_t tile_width;      /**< Width of a tile, in pixels */
+    size_t tile_height;     /**< Height of a tile, in pixels */
+    uint8_t *flags;         /**< One byte per tile, row by row; non-zero if the tile is marked */
+    size_t capacity;        /**< Number of bytes at `flags` */
+    size_t columns;         /**< Internal. Number of tiles across the canvas at the last clear */
+    size_t pending;         /**< Internal. Number of tiles still marked */
+    uint8_t *buffer;        /**< Internal. Buffer of the canvas at the last clear, which the tiles are laid over */
+    size_t width;           /**< Internal. Width of the canvas at the last clear */
+    size_t height;          /**< Internal. Height of the canvas at the last clear */
+    uint8_t pixel[CANVAS_FAST_CLEAR_MAX_PIXEL_SIZE];  /**< Internal. Pixel value of the last clear */
+} canvas_fast_clear_t;
+
+/**
+ * Number of tiles needed to cover a canvas.
+ *
+ * @param width       Width of the canvas in pixels
+ * @param height      Height of the canvas in pixels
+ * @param tile_width  Width of a tile in pixels
+ * @param tile_height Height of a tile in pixels
+ *
+ * @return Number of bytes needed for the flags
+ */
+CANVAS_STATIC_INLINE size_t canvas_fast_clear_tile_count(size_t width, size_t height, size_t tile_width, size_t tile_height)
+{
+    return ((width + tile_width - 1) / tile_width) * ((height + tile_height - 1) / tile_height);
+}
+
+/**
+ * Returns the tiles for @ref canvas_set_fast_clear, with none marked.
+ *
+ * @param tile_width  Width of a tile in pixels. A tile as wide as the canvas clears whole rows at once.
+ * @param tile_height Height of a tile in pixels
+ * @param flags       Memory for the flags, of the size given by @ref canvas_fast_clear_tile_count or larger,
+ *                    which must remain valid for as long as it is in use
+ * @param capacity    Number of bytes at `flags`. If a canvas needs more tiles than this, it is cleared immediately.
+ *
+ * @return Tiles
+ */
+CANVAS_STATIC_INLINE canvas_fast_clear_t canvas_fast_clear_init(
+    size_t tile_width,
+    size_t tile_height,
+    uint8_t *flags,
+    size_t capacity
+)
+{
+    canvas_fast_clear_t clear;
+    memset(&clear, 0, sizeof(clear));
+    clear.tile_width = tile_width;
+    clear.tile_height = tile_height;
+    clear.flags = flags;
+    clear.capacity = capacity;
+    return clear;
+}
+
+/**
+ * @}
+ */
+#endif
+
+/**
+ * @defgroup CANVAS_API Canvas API
+ *
+ * @{
+ */
+
+/**
+ * Holds information about the canvas.
+ *
+ * For the canvas to be valid, it must be a return value from @ref canvas_init,
+ * and it must have been passed to @ref canvas_set_memory with a pointer to valid memory.
+ */
+typedef struct canvas_t {
+    size_t width;           /**< Width of the canvas, in number of pixels */
+    size_t height;          /**< Height of the canvas, in number of pixels */
+    size_t pixel_size;      /**< Number of bytes per pixel */
+    size_t stride;          /**< Number of bytes from the start of one row to the start of the next. At least `width * pixel_size`. */
+    size_t buffer_size;     /**< Size of the buffer, in bytes. */
+    size_t alloc_size;      /**< Number of bytes that must be allocated for the buffer provided in @ref canvas_set_memory */
+    uint8_t *buffer;        /**< The buffer that currently holds valid data. */
+    size_t row_origin;      /**< Row of the buffer that holds canvas row 0. Canvas row `y` is held in buffer row `(y + row_origin) % height`; see @ref canvas_scroll_up. */
+    #if CANVAS_FEATURE_TWO_BUFFERS
+        uint8_t *_temp_buffer;  /**< Internal. A secondary buffer used to hold temporary data during certain actions such as canvas rotations. Exists only if @ref CANVAS_FEATURE_TWO_BUFFERS=1 */
+        bool _swapped;          /**< Internal. Whether the primary and secondary buffer have been swapped. Exists only if @ref CANVAS_FEATURE_TWO_BUFFERS=1 */
+    #endif
+    #if CANVAS_FEATURE_THREAD_POOL
+        const canvas_parallel_t *parallel;  /**< How to split operations across threads, or NULL to run them on the calling thread. See @ref canvas_set_parallel. Exists only if @ref CANVAS_FEATURE_THREAD_POOL=1 */
+    #endif
+    #if CANVAS_FEATURE_FAST_CLEAR
+        canvas_fast_clear_t *fast_clear;    /**< Tiles for clearing lazily, or NULL to clear immediately. See @ref canvas_set_fast_clear. Exists only if @ref CANVAS_FEATURE_FAST_CLEAR=1 */
+        bool _fast_clear_view;              /**< Internal. Whether this is a view sharing its parent's tiles, which cannot mark them. Exists only if @ref CANVAS_FEATURE_FAST_CLEAR=1 */
+    #endif
+} canvas_t;
+
+#if CANVAS_FEATURE_TWO_BUFFERS
+    /**
+     * Only intended for internal use.
+     *
+     * Swap the primary and secondary buffers so that the primary buffer holds
+     *
+     * @param cv Canvas
+     */
+    CANVAS_STATIC_INLINE void canvas_swap_buffers(canvas_t *cv)
+    {
+        size_t buffer_size = cv->buffer_size;
+        if (cv->_swapped)
+        {
+            cv->buffer -= buffer_size;
+            cv->_temp_buffer += buffer_size;
+        }
+        else
+        {
+            cv->buffer += buffer_size;
+            cv->_temp_buffer -= buffer_size;
+        }
+        cv->_swapped = !cv->_swapped;
+    }
+
+    /**
+     * Copy the contents of the primary buffer into the temporary buffer.
+     * For testing; should not be required.
+     *
+     * @param cv Canvas
+     * @return nothing
+     */
+    CANVAS_STATIC_INLINE void canvas_sync_buffers(canvas_t *cv)
+    {
+        memcpy(cv->_temp_buffer, cv->buffer, cv->buffer_size);
+    }
+#endif
+
+/**
+ * Returns a new canvas where everything has been initialized except the actual memory,
+ * and where each row starts `stride` bytes after the previous one.
+ *
+ * @param width       Width of the canvas in pixels.
+ * @param height      Height of the canvas in pixels.
+ * @param pixel_size  The size of one pixel in memory, in bytes. For example, if your pixels are 3-byte RGB values, pixel_size should be 3.
+ * @param stride      Number of bytes from the start of one row to the start of the next. Must be at least `width * pixel_size`.
+ *
+ * Use this to pad rows to an alignment (see @ref canvas_aligned_stride),
+ * or to wrap memory whose pitch is dictated by someone else, such as a display driver.
+ *
+ * @warning After calling `canvas_t cv = canvas_init_with_stride(...)`, the application must provide a buffer of size `cv.alloc_size` or larger
+ *          by calling `canvas_set_memory(&cv, buffer)`.
+ *
+ * @return Canvas
+ */
+CANVAS_STATIC_INLINE canvas_t canvas_init_with_stride(
+    size_t width,
+    size_t height,
+    size_t pixel_size,
+    size_t stride
+)
+{
+    size_t buffer_size = stride * height;
+
+    canvas_t cv;
+    memset(&cv, 0, sizeof(cv));
+    cv.width = width;
+    cv.height = height;
+    cv.pixel_size = pixel_size;
+    cv.stride = stride;
+    cv.buffer_size = buffer_size;
+    #if CANVAS_FEATURE_TWO_BUFFERS
+        cv.alloc_size = buffer_size * 2;
+        cv._swapped = false;
+    #else
+        cv.alloc_size = buffer_size;
+    #endif
+    return cv;
+}
+
+/**
+ * Returns a new canvas where everything has been initialized except the actual memory.
+ *
+ * @param width       Width of the canvas in pixels.
+ * @param height      Height of the canvas in pixels.
+ * @param pixel_size  The size of one pixel in memory, in bytes. For example, if your pixels are 3-byte RGB values, pixel_size should be 3.
+ *
+ * @warning After calling `canvas_t cv = canvas_init(...)`, the application must provide a buffer of size `cv.alloc_size` or larger
+ *          by calling `canvas_set_memory(&cv, buffer)`.
+ *
+ * @note The only supported interactions with the canvas object are the provided API functions, as well as
+ *       passing cv.buffer to other functions for display.
+ *
+ * @return Canvas
+ */
+CANVAS_STATIC_INLINE canvas_t canvas_init(
+    size_t width,
+    size_t height,
+    size_t pixel_size
+)
+{
+    return canvas_init_with_stride(width, height, pixel_size, width * pixel_size);
+}
+
+/**
+ * The smallest stride which fits a row and is a multiple of `alignment`.
+ *
+ * @param width       Width of the canvas in pixels.
+ * @param pixel_size  The size of one pixel in memory, in bytes.
+ * @param alignment   Required alignment in bytes, e.g. 64 for a cache line
+ *
+ * @return Stride to pass to @ref canvas_init_with_stride
+ *
+ * Every row is only aligned if the memory passed to @ref canvas_set_memory is aligned as well.
+ */
+CANVAS_STATIC_INLINE size_t canvas_aligned_stride(size_t width, size_t pixel_size, size_t alignment)
+{
+    return (width * pixel_size + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Provide the canvas with a pixel buffer.
+ *
+ * @param canvas A canvas that was returned from @ref canvas_init
+ * @param memory Pointer to a buffer of size `cv.alloc_size` or larger
+ *
+ * @warning The memory pointed to by `memory` must remain valid for as long as `cv` is in use.
+ *          This can be achieved by allocating it statically, globally, or with an allocator such as `malloc`.
+ *          If `memory` was allocated on the stack, it will be invalid when the caller returns.
+ */
+CANVAS_STATIC_INLINE void canvas_set_memory(canvas_t *cv, uint8_t *memory)
+{
+    cv->buffer = memory;
+    #if CANVAS_FEATURE_TWO_BUFFERS
+        cv->_temp_buffer = memory + cv->buffer_size;
+    #endif
+}
+
+/**
+ * Returns a pointer to the start of a row of the canvas, taking the row origin into account.
+ *
+ * @param canvas Canvas
+ * @param y      Y-coordinate in the canvas. Must be less than the height of the canvas.
+ *
+ * @return Pointer to the pixel at (0, y)
+ */
+CANVAS_STATIC_INLINE uint8_t *canvas_row(const canvas_t *cv, size_t y)
+{
+    size_t row = y + cv->row_origin;
+    if (row >= cv->height)
+    {
+        row -= cv->height;
+    }
+    return cv->buffer + row * cv->stride;
+}
+
+/**
+ * For internal use. A run of canvas rows which are consecutive in memory.
+ */
+typedef struct canvas_segment_t {
+    size_t y_top;       /**< Y-coordinate of the first row */
+    size_t y_bottom;    /**< Y-coordinate of the last row, plus 1. */
+    uint8_t *row;       /**< Start of row `y_top` in memory */
+} canvas_segment_t;
+
+/**
+ * For internal use. Split a range of canvas rows at the point where the ring of rows wraps around in memory.
+ *
+ * @param      canvas    Canvas
+ * @param      y_top     Y-coordinate of the first row
+ * @param      y_bottom  Y-coordinate of the last row, plus 1. Must not be greater than the height of the canvas.
+ * @param[out] segments  Receives the runs of rows, in order from the top
+ *
+ * With a row origin of 0 the range is always a single run.
+ *
+ * @return Number of runs placed in `segments`; 0, 1 or 2
+ */
+CANVAS_STATIC_INLINE size_t canvas_segments(const canvas_t *cv, size_t y_top, size_t y_bottom, canvas_segment_t segments[2])
+{
+    // Canvas row `wrap` is the one held in the first row of the buffer
+    size_t wrap = cv->height - cv->row_origin;
+    size_t count = 0;
+    if (y_top < wrap && y_top < y_bottom)
+    {
+        segments[count].y_top = y_top;
+        segments[count].y_bottom = y_bottom < wrap ? y_bottom : wrap;
+        segments[count].row = canvas_row(cv, y_top);
+        count++;
+    }
+    if (y_bottom > wrap && y_top < y_bottom)
+    {
+        segments[count].y_top = y_top > wrap ? y_top : wrap;
+        segments[count].y_bottom = y_bottom;
+        segments[count].row = canvas_row(cv, segments[count].y_top);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Whether the canvas has tiles which are marked as cleared but not yet filled. See @ref FAST_CLEAR.
+ *
+ * @param cv Canvas
+ *
+ * Always false if @ref CANVAS_FEATURE_FAST_CLEAR=0.
+ */
+CANVAS_STATIC_INLINE bool canvas_fast_clear_pending(const canvas_t *cv)
+{
+    #if CANVAS_FEATURE_FAST_CLEAR
+        return cv->fast_clear && cv->fast_clear->pending;
+    #else
+        (void)cv;
+        return false;
+    #endif
+}
+
+#if CANVAS_FEATURE_FAST_CLEAR
+    /**
+     * For internal use. Fill the marked tiles that overlap a rectangle of the buffer that the tiles are laid over,
+     * ignoring the row origin.
+     */
+    CANVAS_STATIC_INLINE void canvas_fast_clear_resolve_buffer(
+        const canvas_t *cv,
+        size_t x_left,
+        size_t x_right,
+        size_t y_top,
+        size_t y_bottom,
+        bool overwrite
+    )
+    {
+        canvas_fast_clear_t *clear = cv->fast_clear;
+        for (size_t ty = y_top / clear->tile_height; ty * clear->tile_height < y_bottom && clear->pending; ty++)
+        {
+            size_t tile_top = ty * clear->tile_height;
+            size_t tile_bottom = tile_top + clear->tile_height < clear->height ? tile_top + clear->tile_height : clear->height;
+            for (size_t tx = x_left / clear->tile_width; tx * clear->tile_width < x_right; tx++)
+            {
+                uint8_t *flag = &clear->flags[ty * clear->columns + tx];
+                if (!*flag)
+                {
+                    continue;
+                }
+                *flag = 0;
+                clear->pending--;
+                size_t tile_left = tx * clear->tile_width;
+                size_t tile_right = tile_left + clear->tile_width < clear->width ? tile_left + clear->tile_width : clear->width;
+                bool covered = tile_left >= x_left && tile_right <= x_right && tile_top >= y_top && tile_bottom <= y_bottom;
+                if (!(overwrite && covered))
+                {
+                    canvas_buffer_fill_rect_stride(
+                        clear->buffer,
+                        clear->pixel,
+                        cv->pixel_size,
+                        cv->stride,
+                        tile_left,
+                        tile_right,
+                        tile_top,
+                        tile_bottom
+                    );
+                }
+            }
+        }
+    }
+#endif
+
+/**
+ * Fill the marked tiles that a rectangle of the canvas overlaps, before drawing into it or reading it. See @ref FAST_CLEAR.
+ *
+ * @param cv        Canvas
+ * @param x_left    X-coordinate of the left side of the rectangle
+ * @param x_right   X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top     Y-coordinate of the top side of the rectangle
+ * @param y_bottom  Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param overwrite Whether every pixel in the rectangle is about to be replaced,
+ *                  in which case tiles that lie wholly inside it are only unmarked
+ *
+ * The rectangle is clipped to the canvas. Does nothing if no tiles are marked.
+ */
+CANVAS_STATIC_INLINE void canvas_fast_clear_resolve(
+    const canvas_t *cv,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom,
+    bool overwrite
+)
+{
+    #if CANVAS_FEATURE_FAST_CLEAR
+        if (!canvas_fast_clear_pending(cv))
+        {
+            return;
+        }
+        x_right = x_right < cv->width ? x_right : cv->width;
+        y_bottom = y_bottom < cv->height ? y_bottom : cv->height;
+        if (x_left >= x_right)
+        {
+            return;
+        }
+        // Tiles are laid over the buffer, so they stay put when the row origin moves; views find their window by its address
+        canvas_segment_t segments[2];
+        size_t count = canvas_segments(cv, y_top, y_bottom, segments);
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t offset = (size_t)(segments[i].row - cv->fast_clear->buffer);
+            size_t row = offset / cv->stride;
+            size_t column = offset % cv->stride / cv->pixel_size;
+            canvas_fast_clear_resolve_buffer(
+                cv,
+                x_left + column,
+                x_right + column,
+                row,
+                row + segments[i].y_bottom - segments[i].y_top,
+                overwrite
+            );
+        }
+    #else
+        (void)cv;
+        (void)x_left;
+        (void)x_right;
+        (void)y_top;
+        (void)y_bottom;
+        (void)overwrite;
+    #endif
+}
+
+/**
+ * Fill all marked tiles. See @ref FAST_CLEAR.
+ *
+ * @param cv Canvas
+ */
+CANVAS_STATIC_INLINE void canvas_fast_clear_resolve_all(const canvas_t *cv)
+{
+    canvas_fast_clear_resolve(cv, 0, cv->width, 0, cv->height, false);
+}
+
+#if CANVAS_FEATURE_FAST_CLEAR
+    /**
+     * Let @ref canvas_fill clear the canvas lazily, tile by tile. See @ref FAST_CLEAR.
+     *
+     * @param cv    Canvas, which must not be a view
+     * @param clear The tiles, from @ref canvas_fast_clear_init, or NULL to clear immediately again.
+     *              Must remain valid for as long as it is in use by the canvas, and must not be shared with other canvases
+     *              except views of this one.
+     *
+     * Tiles still marked on the previous @ref canvas_fast_clear_t are filled first.
+     * Views made before this call do not share the new tiles, so they must be made again.
+     *
+     * Exists only if @ref CANVAS_FEATURE_FAST_CLEAR=1.
+     */
+    CANVAS_STATIC_INLINE void canvas_set_fast_clear(canvas_t *cv, canvas_fast_clear_t *clear)
+    {
+        canvas_fast_clear_resolve_all(cv);
+        cv->fast_clear = clear;
+    }
+
+    /**
+     * For internal use. Mark every tile as cleared to a pixel value, for @ref canvas_fill.
+     *
+     * @return Whether the tiles were marked; if not, the canvas must be filled immediately
+     */
+    CANVAS_STATIC_INLINE bool canvas_fast_clear_mark(canvas_t* CANVAS_RESTRICT cv, const uint8_t* CANVAS_RESTRICT pixel)
+    {
+        canvas_fast_clear_t *clear = cv->fast_clear;
+        if (!clear)
+        {
+            return false;
+        }
+        if (cv->_fast_clear_view)
+        {
+            // A view covers only part of the tiles; fill it immediately, over whatever tiles it lies wholly across
+            canvas_fast_clear_resolve(cv, 0, cv->width, 0, cv->height, true);
+            return false;
+        }
+        // Whatever was still marked is about to be overwritten anyway
+        clear->pending = 0;
+        size_t count = canvas_fast_clear_tile_count(cv->width, cv->height, clear->tile_width, clear->tile_height);
+        if (cv->pixel_size > CANVAS_FAST_CLEAR_MAX_PIXEL_SIZE || count > clear->capacity || count == 0)
+        {
+            return false;
+        }
+        clear->columns = (cv->width + clear->tile_width - 1) / clear->tile_width;
+        clear->buffer = cv->buffer;
+        clear->width = cv->width;
+        clear->height = cv->height;
+        memcpy(clear->pixel, pixel, cv->pixel_size);
+        memset(clear->flags, 1, count);
+        clear->pending = count;
+        return true;
+    }
+#endif
+
+/**
+ * Context for @ref canvas_span.
+ */
+typedef struct canvas_span_context_t {
+    const canvas_t *cv;     /**< The canvas into which the spans will be placed */
+    const uint8_t *pixel;   /**< Pixel data for a single pixel. Each pixel in the spans will have this pixel value. */
+} canvas_span_context_t;
+
+/**
+ * Span function which places each span into a canvas, for passing to the rasterizers in the @ref RASTER_API.
+ * Rows are mapped through the row origin of the canvas, spans on rows outside the canvas are skipped,
+ * and the rest are clipped to the width of the canvas.
+ *
+ * @param context  Pointer to a @ref canvas_span_context_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_span_context_t *span = (const canvas_span_context_t *)context;
+    x_left = x_left < 0 ? 0 : x_left;
+    x_right = (int64_t)x_right > (int64_t)span->cv->width ? (int)span->cv->width : x_right;
+    if (y < 0 || (size_t)y >= span->cv->height || x_left >= x_right)
+    {
+        return;
+    }
+    canvas_fast_clear_resolve(span->cv, (size_t)x_left, (size_t)x_right, (size_t)y, (size_t)y + 1, true);
+    canvas_buffer_draw_horizontal_line_stride(
+        canvas_row(span->cv, (size_t)y),
+        span->pixel,
+        span->cv->pixel_size,
+        span->cv->stride,
+        (size_t)x_left,
+        (size_t)x_right,
+        0
+    );
+}
+
+/**
+ * For internal use. Handles the rows from `y_top` up to `y_bottom` of an operation.
+ */
+typedef void (*canvas_rows_task_function_t)(void *context, size_t y_top, size_t y_bottom);
+
+#if CANVAS_FEATURE_THREAD_POOL
+    /**
+     * Let the canvas split large operations across threads.
+     *
+     * @param cv       Canvas
+     * @param parallel How to run tasks, e.g. from @ref canvas_thread_pool_parallel, or NULL to run everything on the calling thread.
+     *                 Must remain valid for as long as it is in use by the canvas.
+     *
+     * Exists only if @ref CANVAS_FEATURE_THREAD_POOL=1.
+     */
+    CANVAS_STATIC_INLINE void canvas_set_parallel(canvas_t *cv, const canvas_parallel_t *parallel)
+    {
+        cv->parallel = parallel;
+    }
+
+    /**
+     * For internal use. One band of rows of an operation that has been split by @ref canvas_parallel_rows.
+     */
+    typedef struct canvas_parallel_rows_t {
+        canvas_rows_task_function_t task;   /**< Handles a band */
+        void *context;                      /**< Passed to `task` */
+        size_t y_top;                       /**< First row of the whole operation */
+        size_t height;                      /**< Number of rows in the whole operation */
+        size_t band_count;                  /**< Number of bands */
+    } canvas_parallel_rows_t;
+
+    /**
+     * For internal use. Task which handles band `index` of an operation.
+     */
+    CANVAS_STATIC_INLINE void canvas_parallel_band(void *context, size_t index)
+    {
+        const canvas_parallel_rows_t *rows = (const canvas_parallel_rows_t *)context;
+        size_t y_top = rows->y_top + rows->height * index / rows->band_count;
+        size_t y_bottom = rows->y_top + rows->height * (index + 1) / rows->band_count;
+        if (y_top < y_bottom)
+        {
+            rows->task(rows->context, y_top, y_bottom);
+        }
+    }
+#endif
+
+/**
+ * For internal use. Run an operation on a range of rows, split into bands across threads
+ * if the canvas allows it and the operation is large enough.
+ *
+ * @param cv       Canvas
+ * @param y_top    First row of the operation
+ * @param y_bottom Last row of the operation, plus 1.
+ * @param bytes    Number of bytes the operation touches, to compare with the threshold
+ * @param task     Handles a band of rows. Bands never overlap.
+ * @param context  Passed to `task`
+ */
+CANVAS_STATIC_INLINE void canvas_parallel_rows(
+    const canvas_t *cv,
+    size_t y_top,
+    size_t y_bottom,
+    size_t bytes,
+    canvas_rows_task_function_t task,
+    void *context
+)
+{
+    #if CANVAS_FEATURE_THREAD_POOL
+        const canvas_parallel_t *parallel = cv->parallel;
+        if (parallel && parallel->band_count > 1 && bytes >= parallel->threshold && y_bottom - y_top > 1)
+        {
+            canvas_parallel_rows_t rows = { task, context, y_top, y_bottom - y_top, parallel->band_count };
+            if (rows.band_count > rows.height)
+            {
+                rows.band_count = rows.height;
+            }
+            parallel->function(parallel->pool, canvas_parallel_band, &rows, rows.band_count);
+            return;
+        }
+    #else
+        (void)cv;
+        (void)bytes;
+    #endif
+    if (y_top < y_bottom)
+    {
+        task(context, y_top, y_bottom);
+    }
+}
+
+/**
+ * Returns a canvas which is a view onto a rectangular window of another canvas.
+ *
+ * @param parent   The canvas to make a view onto. May itself be a view.
+ * @param x_left   X-coordinate of the left side of the window in the parent
+ * @param x_right  X-coordinate of the right side of the window in the parent, plus 1.
+ * @param y_top    Y-coordinate of the top side of the window in the parent
+ * @param y_bottom Y-coordinate of the bottom side of the window in the parent, plus 1.
+ *
+ * The view shares memory with the parent and uses the parent's stride, so drawing into it draws directly into the parent,
+ * with (0, 0) at the top left corner of the window. It does not need @ref canvas_set_memory.
+ * It also shares the parent's tiles for clearing lazily, if any (see @ref FAST_CLEAR).
+ *
+ * @warning The view is only valid for as long as the parent's buffer does not move.
+ *          With @ref CANVAS_FEATURE_TWO_BUFFERS=1, the view must not be rotated or flipped,
+ *          and rotating or flipping the parent invalidates the view.
+ *          Scrolling the parent invalidates the view too, and the window must not straddle
+ *          the point where the rows of the parent wrap around (see @ref canvas_t::row_origin).
+ *
+ * @return Canvas
+ */
+CANVAS_STATIC_INLINE canvas_t canvas_view(
+    const canvas_t *parent,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    size_t width = x_right - x_left;
+    size_t height = y_bottom - y_top;
+    canvas_t cv = canvas_init_with_stride(width, height, parent->pixel_size, parent->stride);
+
+    // The last row is not padded out to the stride, since the padding belongs to the parent
+    cv.buffer_size = height ? (height - 1) * cv.stride + width * cv.pixel_size : 0;
+    cv.alloc_size = 0;
+    cv.buffer = (height ? canvas_row(parent, y_top) : parent->buffer) + x_left * parent->pixel_size;
+    #if CANVAS_FEATURE_TWO_BUFFERS
+        cv._temp_buffer = NULL;
+    #endif
+    #if CANVAS_FEATURE_THREAD_POOL
+        cv.parallel = parent->parallel;
+    #endif
+    #if CANVAS_FEATURE_FAST_CLEAR
+        // Drawing into the view fills the parent's tiles, which it finds from the address of the window
+        cv.fast_clear = parent->fast_clear;
+        cv._fast_clear_view = true;
+    #endif
+    return cv;
+}
+
+/**
+ * Set the value of a single pixel.
+ *
+ * @param canvas Canvas
+ * @param pixel  Pixel data for a single pixel, which will be placed into the canvas at the given coordinates.
+ * @param x      X-coordinate in the canvas
+ * @param y      Y-coordinate in the canvas
+ *
+ * If the pixel data is representable as an integer literal, consider using @ref canvas_set_pixel_literal to avoid using a dummy variable.
+ */
+CANVAS_STATIC_INLINE void canvas_set_pixel(canvas_t* CANVAS_RESTRICT cv, const uint8_t* CANVAS_RESTRICT pixel, size_t x, size_t y)
+{
+    canvas_fast_clear_resolve(cv, x, x + 1, y, y + 1, true);
+    memcpy(canvas_row(cv, y) + x * cv->pixel_size, pixel, cv->pixel_size);
+}
+
+/**
+ * Draw the edges of a rectangle, 1 pixel wide.
+ *
+ * @param canvas  Canvas
+ * @param pixel   Pixel data for a single pixel, which will be used along the edge of the rectangle
+ * @param x_left  X-coordinate of the left side of the rectangle
+ * @param x_right X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top   Y-coordinate of the top side of the rectangle
+ * @param y_right Y-coordinate of the bottom side of the rectangle, plus 1.
+ *
+ * If the pixel data is representable as an integer literal, consider using @ref canvas_draw_rect_literal to avoid using a dummy variable.
+ */
+CANVAS_STATIC_INLINE void canvas_draw_rect(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    if (cv->row_origin == 0 && !canvas_fast_clear_pending(cv))
+    {
+        canvas_buffer_draw_rect_stride(
+            cv->buffer,
+            pixel,
+            cv->pixel_size,
+            cv->stride,
+            cv->width,
+            cv->height,
+            x_left,
+            x_right,
+            y_top,
+            y_bottom
+        );
+        return;
+    }
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_rect((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, canvas_span, &span);
+}
+
+CANVAS_STATIC_INLINE void canvas_draw_horizontal_line(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y
+)
+{
+    canvas_fast_clear_resolve(cv, x_left, x_right, y, y + 1, true);
+    canvas_buffer_draw_horizontal_line_stride(
+        canvas_row(cv, y),
+        pixel,
+        cv->pixel_size,
+        cv->stride,
+        x_left,
+        x_right,
+        0
+    );
+}
+
+CANVAS_STATIC_INLINE void canvas_draw_vertical_line(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_fast_clear_resolve(cv, x, x + 1, y_top, y_bottom, true);
+    canvas_segment_t segments[2];
+    size_t count = canvas_segments(cv, y_top, y_bottom, segments);
+    for (size_t i = 0; i < count; i++)
+    {
+        canvas_buffer_draw_vertical_line_stride(
+            segments[i].row,
+            pixel,
+            cv->pixel_size,
+            cv->stride,
+            x,
+            0,
+            segments[i].y_bottom - segments[i].y_top
+        );
+    }
+}
+
+CANVAS_STATIC_INLINE void canvas_draw_line(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    if (cv->row_origin == 0 && !canvas_fast_clear_pending(cv))
+    {
+        canvas_buffer_draw_line_stride(
+            cv->buffer,
+            pixel,
+            cv->pixel_size,
+            cv->stride,
+            cv->width,
+            cv->height,
+            x_left,
+            x_right,
+            y_top,
+            y_bottom
+        );
+        return;
+    }
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_line((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, canvas_span, &span);
+}
+
+CANVAS_STATIC_INLINE void canvas_fill_rect(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_fast_clear_resolve(cv, x_left, x_right, y_top, y_bottom, true);
+    canvas_segment_t segments[2];
+    size_t count = canvas_segments(cv, y_top, y_bottom, segments);
+    for (size_t i = 0; i < count; i++)
+    {
+        canvas_buffer_fill_rect_stride(
+            segments[i].row,
+            pixel,
+            cv->pixel_size,
+            cv->stride,
+            x_left,
+            x_right,
+            0,
+            segments[i].y_bottom - segments[i].y_top
+        );
+    }
+}
+
+CANVAS_STATIC_INLINE void canvas_draw_circle(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    if (cv->row_origin == 0 && !canvas_fast_clear_pending(cv))
+    {
+        canvas_buffer_draw_circle_stride(
+            cv->buffer,
+            pixel,
+            cv->pixel_size,
+            cv->stride,
+            cv->width,
+            cv->height,
+            x_center,
+            y_center,
+            radius
+        );
+        return;
+    }
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_circle((int)x_center, (int)y_center, (int)radius, canvas_span, &span);
+}
+
+CANVAS_STATIC_INLINE void canvas_fill_triangle(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    if (cv->row_origin == 0 && !canvas_fast_clear_pending(cv))
+    {
+        canvas_buffer_fill_triangle_stride(
+            cv->buffer,
+            pixel,
+            cv->pixel_size,
+            cv->stride,
+            cv->width,
+            cv->height,
+            x_0,
+            x_1,
+            x_2,
+            y_0,
+            y_1,
+            y_2
+        );
+        return;
+    }
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_fill_triangle((int)x_0, (int)x_1, (int)x_2, (int)y_0, (int)y_1, (int)y_2, canvas_span, &span);
+}
+
+CANVAS_STATIC_INLINE void canvas_fill_circle(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    if (cv->row_origin == 0 && !canvas_fast_clear_pending(cv))
+    {
+        canvas_buffer_fill_circle_stride(
+            cv->buffer,
+            pixel,
+            cv->pixel_size,
+            cv->stride,
+            cv->width,
+            cv->height,
+            x_center,
+            y_center,
+            radius
+        );
+        return;
+    }
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_fill_circle((int)x_center, (int)y_center, (int)radius, canvas_span, &span);
+}
+
+/**
+ * Fill a polygon. See @ref canvas_raster_fill_polygon.
+ *
+ * @param canvas Canvas
+ * @param pixel  Pixel data for a single pixel. Each pixel inside the polygon will have this pixel value.
+ * @param points The vertices of the polygon, in order. They may lie outside the canvas; the polygon is clipped to it.
+ * @param count  Number of vertices
+ * @param rule   Decides which pixels are inside where the outline overlaps itself
+ * @param edges  Working memory for `count` edges
+ */
+CANVAS_STATIC_INLINE void canvas_fill_polygon(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    const canvas_point_t* CANVAS_RESTRICT points,
+    size_t count,
+    canvas_fill_rule_t rule,
+    canvas_polygon_edge_t* CANVAS_RESTRICT edges
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_fill_polygon(points, count, rule, edges, canvas_span, &span);
+}
+
+/**
+ * Draw a thick line. See @ref canvas_raster_thick_line.
+ *
+ * @param canvas Canvas
+ * @param pixel  Pixel data for a single pixel. Each pixel on the line will have this pixel value.
+ * @param x_0    X-coordinate of the first end point
+ * @param x_1    X-coordinate of the second end point
+ * @param y_0    Y-coordinate of the first end point
+ * @param y_1    Y-coordinate of the second end point
+ * @param width  Width of the line, in pixels
+ * @param cap    Shape of the ends of the line
+ *
+ * The line is clipped to the canvas.
+ */
+CANVAS_STATIC_INLINE void canvas_draw_thick_line(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_0,
+    size_t x_1,
+    size_t y_0,
+    size_t y_1,
+    size_t width,
+    canvas_line_cap_t cap
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_thick_line((int)x_0, (int)x_1, (int)y_0, (int)y_1, (int)width, cap, canvas_span, &span);
+}
+
+/**
+ * Draw a thick polyline. See @ref canvas_raster_polyline.
+ *
+ * @param canvas    Canvas
+ * @param pixel     Pixel data for a single pixel. Each pixel on the polyline will have this pixel value.
+ * @param points    The points of the polyline, in order. They may lie outside the canvas; the polyline is clipped to it.
+ * @param count     Number of points
+ * @param width     Width of the line, in pixels
+ * @param cap       Shape of the two ends of the polyline. Ignored if it is closed.
+ * @param closed    Whether to join the last point back to the first
+ * @param intervals Working memory for `count` intervals
+ */
+CANVAS_STATIC_INLINE void canvas_draw_polyline(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    const canvas_point_t* CANVAS_RESTRICT points,
+    size_t count,
+    size_t width,
+    canvas_line_cap_t cap,
+    bool closed,
+    canvas_interval_t* CANVAS_RESTRICT intervals
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_polyline(points, count, (int)width, cap, closed, intervals, canvas_span, &span);
+}
+
+/**
+ * Draw the edges of a rectangle, with the given width inwards from the sides. See @ref canvas_raster_thick_rect.
+ *
+ * @param canvas   Canvas
+ * @param pixel    Pixel data for a single pixel, which will be used along the edge of the rectangle
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param width    Width of the edges, in pixels
+ */
+CANVAS_STATIC_INLINE void canvas_draw_thick_rect(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom,
+    size_t width
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_thick_rect((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, (int)width, canvas_span, &span);
+}
+
+/**
+ * Draw a thick circle (ring). See @ref canvas_raster_thick_circle.
+ *
+ * @param canvas   Canvas
+ * @param pixel    Pixel data for a single pixel. Each pixel on the ring will have this pixel value.
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ * @param width    Width of the ring, in pixels, centered on the radius
+ *
+ * The ring is clipped to the canvas.
+ */
+CANVAS_STATIC_INLINE void canvas_draw_thick_circle(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_center,
+    size_t y_center,
+    size_t radius,
+    size_t width
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_thick_circle((int)x_center, (int)y_center, (int)radius, (int)width, canvas_span, &span);
+}
+
+/**
+ * Fill a rectangle with rounded corners. See @ref canvas_raster_fill_rounded_rect.
+ *
+ * @param canvas   Canvas
+ * @param pixel    Pixel data for a single pixel. Each pixel inside the rectangle will have this pixel value.
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param corner   The shape of the corners, from @ref canvas_corner_init
+ */
+CANVAS_STATIC_INLINE void canvas_fill_rounded_rect(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom,
+    const canvas_corner_t* CANVAS_RESTRICT corner
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_fill_rounded_rect((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, corner, canvas_span, &span);
+}
+
+/**
+ * Draw the edges of a rectangle with rounded corners. See @ref canvas_raster_rounded_rect.
+ *
+ * @param canvas   Canvas
+ * @param pixel    Pixel data for a single pixel, which will be used along the edge of the rectangle
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param corner   The shape of the corners and the width of the edges, from @ref canvas_corner_init
+ */
+CANVAS_STATIC_INLINE void canvas_draw_rounded_rect(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom,
+    const canvas_corner_t* CANVAS_RESTRICT corner
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_rounded_rect((int)x_left, (int)x_right, (int)y_top, (int)y_bottom, corner, canvas_span, &span);
+}
+
+/**
+ * Draw an arc, e.g. a progress indicator. See @ref canvas_raster_arc.
+ *
+ * @param canvas   Canvas
+ * @param pixel    Pixel data for a single pixel. Each pixel on the arc will have this pixel value.
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ * @param width    Width of the arc, in pixels, centered on the radius
+ * @param start    Direction of the start of the arc, in degrees clockwise from the positive X-axis; -90 is straight up
+ * @param sweep    Angle covered by the arc, in degrees clockwise
+ *
+ * The arc is clipped to the canvas.
+ */
+CANVAS_STATIC_INLINE void canvas_draw_arc(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_center,
+    size_t y_center,
+    size_t radius,
+    size_t width,
+    double start,
+    double sweep
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_arc((int)x_center, (int)y_center, (int)radius, (int)width, start, sweep, canvas_span, &span);
+}
+
+/**
+ * Fill a pie slice. See @ref canvas_raster_fill_pie.
+ *
+ * @param canvas   Canvas
+ * @param pixel    Pixel data for a single pixel. Each pixel inside the slice will have this pixel value.
+ * @param x_center X-coordinate of the center of the disk
+ * @param y_center Y-coordinate of the center of the disk
+ * @param radius   The radius of the disk
+ * @param start    Direction of the start of the slice, in degrees clockwise from the positive X-axis; -90 is straight up
+ * @param sweep    Angle covered by the slice, in degrees clockwise
+ *
+ * The slice is clipped to the canvas.
+ */
+CANVAS_STATIC_INLINE void canvas_fill_pie(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_center,
+    size_t y_center,
+    size_t radius,
+    double start,
+    double sweep
+)
+{
+    canvas_span_context_t span = { cv, pixel };
+    canvas_raster_fill_pie((int)x_center, (int)y_center, (int)radius, start, sweep, canvas_span, &span);
+}
+
+/**
+ * Context for @ref canvas_gradient_span.
+ */
+typedef struct canvas_gradient_span_context_t {
+    const canvas_t *cv;                 /**< The canvas into which the spans will be placed */
+    const canvas_gradient_t *gradient;  /**< The gradient to fill the spans with */
+} canvas_gradient_span_context_t;
+
+/**
+ * Span function which fills each span in a canvas with a gradient, for passing to the rasterizers in the @ref RASTER_API.
+ * Like @ref canvas_span, rows are mapped through the row origin, spans on rows outside the canvas are skipped
+ * and the rest are clipped to the width of the canvas.
+ *
+ * @param context  Pointer to a @ref canvas_gradient_span_context_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_gradient_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_gradient_span_context_t *span = (const canvas_gradient_span_context_t *)context;
+    x_left = x_left < 0 ? 0 : x_left;
+    x_right = (int64_t)x_right > (int64_t)span->cv->width ? (int)span->cv->width : x_right;
+    if (y < 0 || (size_t)y >= span->cv->height || x_left >= x_right)
+    {
+        return;
+    }
+    canvas_fast_clear_resolve(span->cv, (size_t)x_left, (size_t)x_right, (size_t)y, (size_t)y + 1, true);
+    canvas_gradient_row(span->gradient, canvas_row(span->cv, (size_t)y), (size_t)x_left, (size_t)x_right, (size_t)y);
+}
+
+/**
+ * Fill a rectangle with a gradient.
+ *
+ * @param canvas   Canvas
+ * @param gradient The gradient, with the same pixel size as the canvas
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ *
+ * The gradient is positioned relative to the canvas, not to the rectangle.
+ */
+CANVAS_STATIC_INLINE void canvas_fill_rect_gradient(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_gradient_t* CANVAS_RESTRICT gradient,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    x_right = x_right > cv->width ? cv->width : x_right;
+    y_bottom = y_bottom > cv->height ? cv->height : y_bottom;
+    if (x_left >= x_right)
+    {
+        return;
+    }
+    canvas_fast_clear_resolve(cv, x_left, x_right, y_top, y_bottom, true);
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        canvas_gradient_row(gradient, canvas_row(cv, y), x_left, x_right, y);
+    }
+}
+
+/**
+ * Fill a triangle with a gradient. Covers the same pixels as @ref canvas_fill_triangle.
+ *
+ * @param canvas   Canvas
+ * @param gradient The gradient, with the same pixel size as the canvas
+ * @param x_0      X-coordinate of the first vertex
+ * @param x_1      X-coordinate of the second vertex
+ * @param x_2      X-coordinate of the third vertex
+ * @param y_0      Y-coordinate of the first vertex
+ * @param y_1      Y-coordinate of the second vertex
+ * @param y_2      Y-coordinate of the third vertex
+ */
+CANVAS_STATIC_INLINE void canvas_fill_triangle_gradient(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_gradient_t* CANVAS_RESTRICT gradient,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    canvas_gradient_span_context_t span = { cv, gradient };
+    canvas_raster_fill_triangle((int)x_0, (int)x_1, (int)x_2, (int)y_0, (int)y_1, (int)y_2, canvas_gradient_span, &span);
+}
+
+/**
+ * Fill a circle with a gradient. Covers the same pixels as @ref canvas_fill_circle.
+ *
+ * @param canvas   Canvas
+ * @param gradient The gradient, with the same pixel size as the canvas
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ */
+CANVAS_STATIC_INLINE void canvas_fill_circle_gradient(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_gradient_t* CANVAS_RESTRICT gradient,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_gradient_span_context_t span = { cv, gradient };
+    canvas_raster_fill_circle((int)x_center, (int)y_center, (int)radius, canvas_gradient_span, &span);
+}
+
+/**
+ * Context for @ref canvas_pattern_span.
+ */
+typedef struct canvas_pattern_span_context_t {
+    const canvas_t *cv;                 /**< The canvas into which the spans will be placed */
+    const canvas_pattern_t *pattern;    /**< The pattern to fill the spans with */
+} canvas_pattern_span_context_t;
+
+/**
+ * Span function which fills each span in a canvas with a pattern, for passing to the rasterizers in the @ref RASTER_API.
+ * Like @ref canvas_span, rows are mapped through the row origin, spans on rows outside the canvas are skipped
+ * and the rest are clipped to the width of the canvas.
+ *
+ * @param context  Pointer to a @ref canvas_pattern_span_context_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_pattern_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_pattern_span_context_t *span = (const canvas_pattern_span_context_t *)context;
+    x_left = x_left < 0 ? 0 : x_left;
+    x_right = (int64_t)x_right > (int64_t)span->cv->width ? (int)span->cv->width : x_right;
+    if (y < 0 || (size_t)y >= span->cv->height || x_left >= x_right)
+    {
+        return;
+    }
+    canvas_fast_clear_resolve(span->cv, (size_t)x_left, (size_t)x_right, (size_t)y, (size_t)y + 1, true);
+    canvas_pattern_row(span->pattern, canvas_row(span->cv, (size_t)y), (size_t)x_left, (size_t)x_right, (size_t)y);
+}
+
+/**
+ * Fill a rectangle with a pattern.
+ *
+ * @param canvas   Canvas
+ * @param pattern  The pattern, with the same pixel size as the canvas
+ * @param x_left   X-coordinate of the left side of the rectangle
+ * @param x_right  X-coordinate of the right side of the rectangle, plus 1.
+ * @param y_top    Y-coordinate of the top side of the rectangle
+ * @param y_bottom Y-coordinate of the bottom side of the rectangle, plus 1.
+ *
+ * The pattern is positioned relative to the canvas, through its offsets, so neighbouring shapes line up seamlessly.
+ */
+CANVAS_STATIC_INLINE void canvas_fill_rect_pattern(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_pattern_t* CANVAS_RESTRICT pattern,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    x_right = x_right > cv->width ? cv->width : x_right;
+    y_bottom = y_bottom > cv->height ? cv->height : y_bottom;
+    if (x_left >= x_right)
+    {
+        return;
+    }
+    canvas_fast_clear_resolve(cv, x_left, x_right, y_top, y_bottom, true);
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        canvas_pattern_row(pattern, canvas_row(cv, y), x_left, x_right, y);
+    }
+}
+
+/**
+ * Fill a triangle with a pattern. Covers the same pixels as @ref canvas_fill_triangle.
+ *
+ * @param canvas   Canvas
+ * @param pattern  The pattern, with the same pixel size as the canvas
+ * @param x_0      X-coordinate of the first vertex
+ * @param x_1      X-coordinate of the second vertex
+ * @param x_2      X-coordinate of the third vertex
+ * @param y_0      Y-coordinate of the first vertex
+ * @param y_1      Y-coordinate of the second vertex
+ * @param y_2      Y-coordinate of the third vertex
+ */
+CANVAS_STATIC_INLINE void canvas_fill_triangle_pattern(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_pattern_t* CANVAS_RESTRICT pattern,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    canvas_pattern_span_context_t span = { cv, pattern };
+    canvas_raster_fill_triangle((int)x_0, (int)x_1, (int)x_2, (int)y_0, (int)y_1, (int)y_2, canvas_pattern_span, &span);
+}
+
+/**
+ * Fill a circle with a pattern. Covers the same pixels as @ref canvas_fill_circle.
+ *
+ * @param canvas   Canvas
+ * @param pattern  The pattern, with the same pixel size as the canvas
+ * @param x_center X-coordinate of the center of the circle
+ * @param y_center Y-coordinate of the center of the circle
+ * @param radius   The radius of the circle
+ */
+CANVAS_STATIC_INLINE void canvas_fill_circle_pattern(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_pattern_t* CANVAS_RESTRICT pattern,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_pattern_span_context_t span = { cv, pattern };
+    canvas_raster_fill_circle((int)x_center, (int)y_center, (int)radius, canvas_pattern_span, &span);
+}
+
+/**
+ * For internal use. Context for @ref canvas_place_bitmap_rows.
+ */
+typedef struct canvas_place_bitmap_task_t {
+    const canvas_t *cv;     /**< Canvas */
+    const uint8_t *bitmap;  /**< The whole bitmap */
+    size_t x_left;          /**< X-coordinate of the left side of the bitmap */
+    size_t x_right;         /**< X-coordinate of the right side of the bitmap, plus 1. */
+    size_t y_top;           /**< Y-coordinate of the top side of the bitmap */
+} canvas_place_bitmap_task_t;
+
+/**
+ * For internal use. Place rows `y_top` up to `y_bottom` of a bitmap, for @ref canvas_place_bitmap.
+ */
+CANVAS_STATIC_INLINE void canvas_place_bitmap_rows(void *context, size_t y_top, size_t y_bottom)
+{
+    const canvas_place_bitmap_task_t *task = (const canvas_place_bitmap_task_t *)context;
+    const canvas_t *cv = task->cv;
+    size_t bitmap_stride = (task->x_right - task->x_left) * cv->pixel_size;
+    canvas_segment_t segments[2];
+    size_t count = canvas_segments(cv, y_top, y_bottom, segments);
+    for (size_t i = 0; i < count; i++)
+    {
+        canvas_buffer_place_bitmap_stride(
+            segments[i].row,
+            task->bitmap + (segments[i].y_top - task->y_top) * bitmap_stride,
+            cv->pixel_size,
+            cv->stride,
+            task->x_left,
+            task->x_right,
+            0,
+            segments[i].y_bottom - segments[i].y_top
+        );
+    }
+}
+
+CANVAS_STATIC_INLINE void canvas_place_bitmap(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_fast_clear_resolve(cv, x_left, x_right, y_top, y_bottom, true);
+    canvas_place_bitmap_task_t task = { cv, bitmap, x_left, x_right, y_top };
+    canvas_parallel_rows(
+        cv,
+        y_top,
+        y_bottom,
+        (x_right - x_left) * (y_bottom - y_top) * cv->pixel_size,
+        canvas_place_bitmap_rows,
+        &task
+    );
+}
+
+/**
+ * Copy a region of a bitmap into a region of the canvas, scaling it to fit.
+ *
+ * @param canvas          Canvas
+ * @param bitmap          Pixel data for the bitmap, with the same pixel size as the canvas
+ * @param bitmap_stride   Number of bytes from the start of one row of the bitmap to the start of the next
+ * @param source_x_left   X-coordinate of the left side of the source region in the bitmap
+ * @param source_x_right  X-coordinate of the right side of the source region in the bitmap, plus 1.
+ * @param source_y_top    Y-coordinate of the top side of the source region in the bitmap
+ * @param source_y_bottom Y-coordinate of the bottom side of the source region in the bitmap, plus 1.
+ * @param dest_x_left     X-coordinate of the left side of the destination region in the canvas
+ * @param dest_x_right    X-coordinate of the right side of the destination region in the canvas, plus 1.
+ * @param dest_y_top      Y-coordinate of the top side of the destination region in the canvas
+ * @param dest_y_bottom   Y-coordinate of the bottom side of the destination region in the canvas, plus 1.
+ * @param bilinear        Whether to use bilinear filtering (see @ref canvas_buffer_place_bitmap_scaled_bilinear)
+ *                        rather than nearest-neighbour sampling (see @ref canvas_buffer_place_bitmap_scaled)
+ */
+CANVAS_STATIC_INLINE void canvas_place_bitmap_scaled(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t bitmap_stride,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_x_right,
+    size_t dest_y_top,
+    size_t dest_y_bottom,
+    bool bilinear
+)
+{
+    canvas_fast_clear_resolve(cv, dest_x_left, dest_x_right, dest_y_top, dest_y_bottom, true);
+    canvas_segment_t segments[2];
+    size_t count = canvas_segments(cv, dest_y_top, dest_y_bottom, segments);
+    for (size_t i = 0; i < count; i++)
+    {
+        // Each run of rows is produced as a window of the whole blit, so the wrap leaves no seam
+        (bilinear ? canvas_buffer_place_bitmap_scaled_bilinear_rows : canvas_buffer_place_bitmap_scaled_rows)(
+            segments[i].row + dest_x_left * cv->pixel_size,
+            bitmap,
+            cv->pixel_size,
+            cv->stride,
+            bitmap_stride,
+            source_x_left,
+            source_x_right,
+            source_y_top,
+            source_y_bottom,
+            dest_x_right - dest_x_left,
+            dest_y_bottom - dest_y_top,
+            segments[i].y_top - dest_y_top,
+            segments[i].y_bottom - dest_y_top
+        );
+    }
+}
+
+/**
+ * Place a bitmap into a region of the canvas through an affine transform, e.g. rotated by any angle.
+ *
+ * @param canvas        Canvas
+ * @param bitmap        Pixel data for the bitmap, with the same pixel size as the canvas
+ * @param bitmap_stride Number of bytes from the start of one row of the bitmap to the start of the next
+ * @param bitmap_width  Width of the bitmap
+ * @param bitmap_height Height of the bitmap
+ * @param transform     Maps canvas coordinates to bitmap coordinates, e.g. from @ref canvas_affine_rotate_scale
+ * @param color_key     Pixel data for a transparent colour which is not copied, or NULL to copy every pixel
+ * @param x_left        X-coordinate of the left side of the region of the canvas that may be drawn into
+ * @param x_right       X-coordinate of the right side of the region, plus 1.
+ * @param y_top         Y-coordinate of the top side of the region
+ * @param y_bottom      Y-coordinate of the bottom side of the region, plus 1.
+ *
+ * See @ref canvas_buffer_place_bitmap_affine.
+ */
+CANVAS_STATIC_INLINE void canvas_place_bitmap_affine(
+    canvas_t* CANVAS_RESTRICT cv,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t bitmap_stride,
+    size_t bitmap_width,
+    size_t bitmap_height,
+    const canvas_affine_t* CANVAS_RESTRICT transform,
+    const uint8_t* CANVAS_RESTRICT color_key,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    // Only the pixels that map into the bitmap are replaced
+    canvas_fast_clear_resolve(cv, x_left, x_right, y_top, y_bottom, false);
+    canvas_segment_t segments[2];
+    size_t count = canvas_segments(cv, y_top, y_bottom, segments);
+    for (size_t i = 0; i < count; i++)
+    {
+        canvas_buffer_place_bitmap_affine_rows(
+            segments[i].row,
+            bitmap,
+            cv->pixel_size,
+            cv->stride,
+            bitmap_stride,
+            bitmap_width,
+            bitmap_height,
+            transform,
+            color_key,
+            x_left,
+            x_right,
+            segments[i].y_top,
+            segments[i].y_bottom
+        );
+    }
+}
+
+/**
+ * Place a run-length encoded sprite into the canvas. See @ref canvas_buffer_place_rle.
+ *
+ * @param canvas Canvas
+ * @param sprite The sprite, with the same pixel size as the canvas
+ * @param x_left X-coordinate of the left side of the sprite
+ * @param y_top  Y-coordinate of the top side of the sprite
+ */
+CANVAS_STATIC_INLINE void canvas_place_rle(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_rle_sprite_t* CANVAS_RESTRICT sprite,
+    size_t x_left,
+    size_t y_top
+)
+{
+    canvas_fast_clear_resolve(cv, x_left, x_left + sprite->width, y_top, y_top + sprite->height, false);
+    const uint8_t *data = sprite->data;
+    for (size_t y = 0; y < sprite->height; y++)
+    {
+        data = canvas_rle_decode_row(canvas_row(cv, y_top + y) + x_left * cv->pixel_size, data, cv->pixel_size);
+    }
+}
+
+/**
+ * Position of one instance of a sprite, for @ref canvas_place_sprites.
+ */
+typedef struct canvas_sprite_position_t {
+    int x_left;     /**< X-coordinate of the left side of the instance. May be outside the canvas. */
+    int y_top;      /**< Y-coordinate of the top side of the instance. May be outside the canvas. */
+} canvas_sprite_position_t;
+
+/**
+ * Place many instances of a sprite into the canvas. See @ref canvas_buffer_place_sprite.
+ *
+ * @param canvas    Canvas
+ * @param sprite    The sprite, with the same pixel size as the canvas
+ * @param positions Position of each instance
+ * @param count     Number of instances
+ *
+ * Instances may lie partly or wholly outside the canvas; they are clipped to it.
+ * Instances are placed in order, so later ones cover earlier ones.
+ */
+CANVAS_STATIC_INLINE void canvas_place_sprites(
+    canvas_t* CANVAS_RESTRICT cv,
+    const canvas_sprite_t* CANVAS_RESTRICT sprite,
+    const canvas_sprite_position_t* CANVAS_RESTRICT positions,
+    size_t count
+)
+{
+    size_t pixel_size = cv->pixel_size;
+    for (size_t n = 0; n < count; n++)
+    {
+        int64_t x_left = positions[n].x_left;
+        int64_t y_top = positions[n].y_top;
+        if (x_left >= (int64_t)cv->width || y_top >= (int64_t)cv->height
+            || x_left + (int64_t)sprite->width <= 0 || y_top + (int64_t)sprite->height <= 0)
+        {
+            continue;
+        }
+        canvas_fast_clear_resolve(
+            cv,
+            (size_t)(x_left < 0 ? 0 : x_left),
+            (size_t)(x_left + (int64_t)sprite->width),
+            (size_t)(y_top < 0 ? 0 : y_top),
+            (size_t)(y_top + (int64_t)sprite->height),
+            false
+        );
+        bool inside = x_left >= 0 && y_top >= 0
+            && x_left + (int64_t)sprite->width <= (int64_t)cv->width
+            && y_top + (int64_t)sprite->height <= (int64_t)cv->height;
+        if (inside && cv->row_origin == 0)
+        {
+            canvas_buffer_place_sprite(cv->buffer, sprite, cv->stride, (size_t)x_left, (size_t)y_top);
+            continue;
+        }
+        for (size_t i = 0; i < sprite->span_count; i++)
+        {
+            const canvas_sprite_span_t *span = &sprite->spans[i];
+            int64_t y = y_top + (int64_t)span->y;
+            int64_t span_left = x_left + (int64_t)span->x_left;
+            int64_t span_right = x_left + (int64_t)span->x_right;
+            if (!inside)
+            {
+                if (y < 0 || y >= (int64_t)cv->height)
+                {
+                    continue;
+                }
+                span_left = span_left < 0 ? 0 : span_left;
+                span_right = span_right > (int64_t)cv->width ? (int64_t)cv->width : span_right;
+                if (span_left >= span_right)
+                {
+                    continue;
+                }
+            }
+            memcpy(
+                canvas_row(cv, (size_t)y) + (size_t)span_left * pixel_size,
+                sprite->bitmap + span->y * sprite->bitmap_stride + (size_t)(span_left - x_left) * pixel_size,
+                (size_t)(span_right - span_left) * pixel_size
+            );
+        }
+    }
+}
+
+CANVAS_STATIC_INLINE void canvas_extract_bitmap(
+    const canvas_t* CANVAS_RESTRICT cv,
+    uint8_t* CANVAS_RESTRICT bitmap,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    canvas_fast_clear_resolve(cv, x_left, x_right, y_top, y_bottom, false);
+    size_t bitmap_stride = (x_right - x_left) * cv->pixel_size;
+    canvas_segment_t segments[2];
+    size_t count = canvas_segments(cv, y_top, y_bottom, segments);
+    for (size_t i = 0; i < count; i++)
+    {
+        canvas_buffer_extract_bitmap_stride(
+            segments[i].row,
+            bitmap + (segments[i].y_top - y_top) * bitmap_stride,
+            cv->pixel_size,
+            cv->stride,
+            x_left,
+            x_right,
+            0,
+            segments[i].y_bottom - segments[i].y_top
+        );
+    }
+}
+
+/**
+ * Move a region of the canvas to another location, which may overlap it.
+ *
+ * @param canvas          Canvas
+ * @param source_x_left   X-coordinate of the left side of the source region
+ * @param source_x_right  X-coordinate of the right side of the source region, plus 1.
+ * @param source_y_top    Y-coordinate of the top side of the source region
+ * @param source_y_bottom Y-coordinate of the bottom side of the source region, plus 1.
+ * @param dest_x_left     X-coordinate of the left side of the destination region
+ * @param dest_y_top      Y-coordinate of the top side of the destination region
+ *
+ * See @ref canvas_buffer_move_region.
+ */
+CANVAS_STATIC_INLINE void canvas_move_region(
+    canvas_t *cv,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_y_top
+)
+{
+    // The source is read before the destination is written, so it is filled first
+    canvas_fast_clear_resolve(cv, source_x_left, source_x_right, source_y_top, source_y_bottom, false);
+    canvas_fast_clear_resolve(
+        cv,
+        dest_x_left,
+        dest_x_left + source_x_right - source_x_left,
+        dest_y_top,
+        dest_y_top + source_y_bottom - source_y_top,
+        true
+    );
+    if (cv->row_origin == 0)
+    {
+        canvas_buffer_move_region(
+            cv->buffer,
+            cv->pixel_size,
+            cv->stride,
+            source_x_left,
+            source_x_right,
+            source_y_top,
+            source_y_bottom,
+            dest_x_left,
+            dest_y_top
+        );
+        return;
+    }
+    // Rows are not at fixed distances from each other in memory, so move them one at a time,
+    // in the order that reads every source row before it is overwritten
+    size_t height = source_y_bottom - source_y_top;
+    size_t row_size = (source_x_right - source_x_left) * cv->pixel_size;
+    bool downwards = dest_y_top > source_y_top;
+    for (size_t i = 0; i < height; i++)
+    {
+        size_t dy = downwards ? height - 1 - i : i;
+        memmove(
+            canvas_row(cv, dest_y_top + dy) + dest_x_left * cv->pixel_size,
+            canvas_row(cv, source_y_top + dy) + source_x_left * cv->pixel_size,
+            row_size
+        );
+    }
+}
+
+/**
+ * @deprecated Use @ref canvas_move_region, which does not need a temporary buffer.
+ */
+CANVAS_STATIC_INLINE void canvas_copy_region(
+    canvas_t* CANVAS_RESTRICT cv,
+    uint8_t* CANVAS_RESTRICT bitmap,
+    size_t source_x_left,
+    size_t source_x_right,
+    size_t source_y_top,
+    size_t source_y_bottom,
+    size_t dest_x_left,
+    size_t dest_y_top
+)
+{
+    (void)bitmap;
+    canvas_move_region(cv, source_x_left, source_x_right, source_y_top, source_y_bottom, dest_x_left, dest_y_top);
+}
+
+
+/**
+ * For internal use. Context for @ref canvas_fill_rows.
+ */
+typedef struct canvas_fill_task_t {
+    const canvas_t *cv;     /**< Canvas */
+    const uint8_t *pixel;   /**< Pixel data for a single pixel */
+} canvas_fill_task_t;
+
+/**
+ * For internal use. Fill rows `y_top` up to `y_bottom` of the buffer, for @ref canvas_fill.
+ * The order of the rows does not matter, so they are not mapped through the row origin.
+ */
+CANVAS_STATIC_INLINE void canvas_fill_rows(void *context, size_t y_top, size_t y_bottom)
+{
+    const canvas_fill_task_t *task = (const canvas_fill_task_t *)context;
+    const canvas_t *cv = task->cv;
+    canvas_buffer_fill_stride(
+        cv->buffer + y_top * cv->stride,
+        task->pixel,
+        cv->pixel_size,
+        cv->stride,
+        cv->width,
+        y_bottom - y_top
+    );
+}
+
+/**
+ * Fill the entire canvas with a pixel value.
+ *
+ * @param canvas Canvas
+ * @param pixel  Pixel data for a single pixel. The entire canvas will be filled with this pixel
+ *
+ * If the pixel data is representable as an integer literal, consider using @ref canvas_fill_literal to avoid using a dummy variable.
+ */
+CANVAS_STATIC_INLINE void canvas_fill(canvas_t* CANVAS_RESTRICT cv, const uint8_t* CANVAS_RESTRICT pixel)
+{
+    #if CANVAS_FEATURE_FAST_CLEAR
+        if (canvas_fast_clear_mark(cv, pixel))
+        {
+            return;
+        }
+    #endif
+    canvas_fill_task_t task = { cv, pixel };
+    canvas_parallel_rows(cv, 0, cv->height, cv->height * cv->stride, canvas_fill_rows, &task);
+}
+
+/**
+ * Scroll the contents of the canvas up, and fill the rows that scroll into view at the bottom.
+ *
+ * @param canvas Canvas
+ * @param pixel  Pixel data for a single pixel. The rows that scroll into view will be filled with this pixel.
+ * @param rows   Number of rows to scroll by
+ *
+ * No pixels are moved: the rows of the buffer form a ring, and scrolling only moves the row origin
+ * (see @ref canvas_t::row_origin), so the cost is that of filling the new rows.
+ * All drawing functions take the row origin into account.
+ *
+ * @note Once scrolled, row 0 of the canvas is generally not at the start of `cv->buffer`.
+ *       Code that reads the buffer directly must use @ref canvas_row for each row.
+ */
+CANVAS_STATIC_INLINE void canvas_scroll_up(canvas_t* CANVAS_RESTRICT cv, const uint8_t* CANVAS_RESTRICT pixel, size_t rows)
+{
+    if (rows >= cv->height)
+    {
+        canvas_fill(cv, pixel);
+        return;
+    }
+    cv->row_origin += rows;
+    if (cv->row_origin >= cv->height)
+    {
+        cv->row_origin -= cv->height;
+    }
+    canvas_fill_rect(cv, pixel, 0, cv->width, cv->height - rows, cv->height);
+}
+
+/**
+ * Scroll the contents of the canvas down, and fill the rows that scroll into view at the top.
+ *
+ * @param canvas Canvas
+ * @param pixel  Pixel data for a single pixel. The rows that scroll into view will be filled with this pixel.
+ * @param rows   Number of rows to scroll by
+ *
+ * See @ref canvas_scroll_up.
+ */
+CANVAS_STATIC_INLINE void canvas_scroll_down(canvas_t* CANVAS_RESTRICT cv, const uint8_t* CANVAS_RESTRICT pixel, size_t rows)
+{
+    if (rows >= cv->height)
+    {
+        canvas_fill(cv, pixel);
+        return;
+    }
+    cv->row_origin += cv->height - rows;
+    if (cv->row_origin >= cv->height)
+    {
+        cv->row_origin -= cv->height;
+    }
+    canvas_fill_rect(cv, pixel, 0, cv->width, 0, rows);
+}
+
+#if CANVAS_FEATURE_TWO_BUFFERS
+    /**
+     * Only intended for internal use.
+     *
+     * Move the rows of the canvas so that the row origin is 0, through the secondary buffer.
+     *
+     * @param cv Canvas
+     */
+    CANVAS_STATIC_INLINE void canvas_unwrap_rows(canvas_t *cv)
+    {
+        // The tiles are laid over the buffer, which is about to move
+        canvas_fast_clear_resolve_all(cv);
+        if (cv->row_origin == 0)
+        {
+            return;
+        }
+        size_t wrap = cv->height - cv->row_origin;
+        memcpy(cv->_temp_buffer, cv->buffer + cv->row_origin * cv->stride, wrap * cv->stride);
+        memcpy(cv->_temp_buffer + wrap * cv->stride, cv->buffer, cv->row_origin * cv->stride);
+        canvas_swap_buffers(cv);
+        cv->row_origin = 0;
+    }
+
+    /**
+     * For internal use. Which rotation or flip a @ref canvas_transform_task_t performs.
+     */
+    typedef enum canvas_transform_t {
+        CANVAS_TRANSFORM_ROTATE_90_CW,
+        CANVAS_TRANSFORM_ROTATE_90_CCW,
+        CANVAS_TRANSFORM_ROTATE_180,
+        CANVAS_TRANSFORM_FLIP_UP_DOWN,
+        CANVAS_TRANSFORM_FLIP_LEFT_RIGHT,
+    } canvas_transform_t;
+
+    /**
+     * For internal use. Context for @ref canvas_transform_rows.
+     */
+    typedef struct canvas_transform_task_t {
+        const canvas_t *cv;             /**< Canvas, whose secondary buffer receives the result */
+        canvas_transform_t transform;   /**< The rotation or flip */
+    } canvas_transform_task_t;
+
+    /**
+     * For internal use. Produce rows `y_top` up to `y_bottom` of the rotated or flipped canvas in the secondary buffer.
+     *
+     * Bands are taken in the destination, so that no two threads write to the same row.
+     * Each band of the destination comes from a band of rows or columns of the source,
+     * which is itself a smaller rotation or flip of the same kind.
+     */
+    CANVAS_STATIC_INLINE void canvas_transform_rows(void *context, size_t y_top, size_t y_bottom)
+    {
+        const canvas_transform_task_t *task = (const canvas_transform_task_t *)context;
+        const canvas_t *cv = task->cv;
+        size_t pixel_size = cv->pixel_size;
+        size_t stride = cv->stride;
+        uint8_t *destination = cv->_temp_buffer + y_top * stride;
+        size_t rows = y_bottom - y_top;
+        switch (task->transform)
+        {
+            case CANVAS_TRANSFORM_ROTATE_90_CW:
+                // Destination row y is source column y
+                canvas_buffer_rotate_90_cw_stride(destination, cv->buffer + y_top * pixel_size, pixel_size, stride, rows, cv->height);
+                break;
+            case CANVAS_TRANSFORM_ROTATE_90_CCW:
+                // Destination row y is source column width - 1 - y
+                canvas_buffer_rotate_90_ccw_stride(destination, cv->buffer + (cv->width - y_bottom) * pixel_size, pixel_size, stride, rows, cv->height);
+                break;
+            case CANVAS_TRANSFORM_ROTATE_180:
+                canvas_buffer_rotate_180_stride(destination, cv->buffer + (cv->height - y_bottom) * stride, pixel_size, stride, cv->width, rows);
+                break;
+            case CANVAS_TRANSFORM_FLIP_UP_DOWN:
+                canvas_buffer_flip_up_down_stride(destination, cv->buffer + (cv->height - y_bottom) * stride, pixel_size, stride, cv->width, rows);
+                break;
+            case CANVAS_TRANSFORM_FLIP_LEFT_RIGHT:
+                canvas_buffer_flip_left_right_stride(destination, cv->buffer + y_top * stride, pixel_size, stride, cv->width, rows);
+                break;
+        }
+    }
+
+    /**
+     * For internal use. Rotate or flip the canvas into the secondary buffer, and swap the buffers.
+     *
+     * @param cv        Canvas
+     * @param transform The rotation or flip
+     * @param rows      Number of rows of the result
+     */
+    CANVAS_STATIC_INLINE void canvas_transform(canvas_t *cv, canvas_transform_t transform, size_t rows)
+    {
+        canvas_fast_clear_resolve_all(cv);
+        canvas_transform_task_t task = { cv, transform };
+        canvas_parallel_rows(cv, 0, rows, cv->height * cv->stride, canvas_transform_rows, &task);
+        canvas_swap_buffers(cv);
+    }
+
+    CANVAS_STATIC_INLINE void canvas_rotate_90_cw(canvas_t* cv)
+    {
+        // Rows become columns, which cannot wrap around
+        canvas_unwrap_rows(cv);
+        canvas_transform(cv, CANVAS_TRANSFORM_ROTATE_90_CW, cv->width);
+    }
+
+    CANVAS_STATIC_INLINE void canvas_rotate_90_ccw(canvas_t* cv)
+    {
+        canvas_unwrap_rows(cv);
+        canvas_transform(cv, CANVAS_TRANSFORM_ROTATE_90_CCW, cv->width);
+    }
+
+    CANVAS_STATIC_INLINE void canvas_rotate_180(canvas_t* cv)
+    {
+        canvas_transform(cv, CANVAS_TRANSFORM_ROTATE_180, cv->height);
+        // Reversing the order of the rows in memory reverses the ring as well
+        cv->row_origin = cv->row_origin ? cv->height - cv->row_origin : 0;
+    }
+
+    CANVAS_STATIC_INLINE void canvas_flip_up_down(canvas_t* cv)
+    {
+        canvas_transform(cv, CANVAS_TRANSFORM_FLIP_UP_DOWN, cv->height);
+        // Reversing the order of the rows in memory reverses the ring as well
+        cv->row_origin = cv->row_origin ? cv->height - cv->row_origin : 0;
+    }
+
+    CANVAS_STATIC_INLINE void canvas_flip_left_right(canvas_t* cv)
+    {
+        canvas_transform(cv, CANVAS_TRANSFORM_FLIP_LEFT_RIGHT, cv->height);
+    }
+#endif
+
+static inline void canvas_text_stm_draw_char(
+    canvas_t *cv,
+    sFONT *font,
+    const uint8_t *pixel_foreground,
+    const uint8_t *pixel_background,
+    char character,
+    size_t x_left,
+    size_t y_top
+)
+{
+    // Every pixel of the glyph is set, to the foreground or the background
+    canvas_fast_clear_resolve(cv, x_left, x_left + font->Width, y_top, y_top + font->Height, true);
+    // Gleaned from the format and STM's drivers
+    size_t font_table_index = (character - ' ') * font->Height * ((font->Width + 7) / 8);
+    for (size_t dy = 0; dy < font->Height; dy++)
+    {
+        size_t y = y_top + dy;
+        for (size_t dx = 0; dx < font->Width; dx++)
+        {
+            size_t x = x_left + dx;
+            const uint8_t *pixel = (font->table[font_table_index] & (0x80 >> (dx & 7))) ? pixel_foreground : pixel_background;
+            canvas_set_pixel(cv, pixel, x, y);
+            if ((dx & 7) == 7)
+            {
+                font_table_index++;
+            }
+        }
+        if (font->Width & 7)
+        {
+            font_table_index++;
+        }
+    }
+}
+
+static inline void canvas_text_stm_draw_string(
+    canvas_t *cv,
+    sFONT *font,
+    const uint8_t *pixel_foreground,
+    const uint8_t *pixel_background,
+    const char *string,
+    size_t x_left,
+    size_t y_top
+)
+{
+    size_t len = strlen(string);
+    size_t x = x_left;
+    size_t y = y_top;
+    for (size_t i = 0; i < len; i++)
+    {
+        canvas_text_stm_draw_char(
+            cv,
+            font,
+            pixel_foreground,
+            pixel_background,
+            string[i],
+            x,
+            y
+        );
+
+        x += font->Width;
+        if ((x + font->Width) > cv->width - 5)
+        {
+            y += font->Height;
+            x = x_left;
+        }
+    }
+}
+
+/**
+ * Receives a block of rows during a streaming export.
+ *
+ * @param context  The context pointer that was passed to the export function
+ * @param data     Pixel data for the rows, packed without padding between rows
+ * @param y_top    Y-coordinate of the first row in `data`
+ * @param y_bottom Y-coordinate of the last row in `data`, plus 1.
+ *
+ * The data is only valid for the duration of the call.
+ */
+typedef void (*canvas_rows_function_t)(void *context, const uint8_t *data, size_t y_top, size_t y_bottom);
+
+/**
+ * A palette which maps the one-byte pixels of an indexed canvas to output pixels.
+ *
+ * An indexed canvas is an ordinary canvas with `pixel_size` 1, where each pixel holds an index into the palette.
+ * Drawing into it writes one byte per pixel regardless of the output format,
+ * and swapping the palette recolours the whole canvas without touching it.
+ *
+ * Indices always take a whole byte, even with 16 colours or fewer: every draw path addresses whole pixels,
+ * so there is no packed 4-bit mode.
+ */
+typedef struct canvas_palette_t {
+    const uint8_t *colors;  /**< One output pixel of `color_size` bytes per index */
+    size_t color_size;      /**< Number of bytes per output pixel, e.g. 2 for RGB565, 3 for RGB888 or 4 for ARGB8888 */
+} canvas_palette_t;
+
+/**
+ * For internal use. Context for @ref canvas_export_indexed_rows.
+ */
+typedef struct canvas_export_indexed_task_t {
+    const canvas_t *cv;                 /**< Canvas with `pixel_size` 1 */
+    const canvas_palette_t *palette;    /**< Palette to look the pixels up in */
+    uint8_t *row_buffer;                /**< Receives the expanded rows of the current block */
+    size_t y_top;                       /**< First row of the current block */
+} canvas_export_indexed_task_t;
+
+/**
+ * For internal use. Expand rows `y_top` up to `y_bottom` into the row buffer, for @ref canvas_export_indexed.
+ */
+CANVAS_STATIC_INLINE void canvas_export_indexed_rows(void *context, size_t y_top, size_t y_bottom)
+{
+    const canvas_export_indexed_task_t *task = (const canvas_export_indexed_task_t *)context;
+    size_t row_size = task->cv->width * task->palette->color_size;
+    for (size_t y = y_top; y < y_bottom; y++)
+    {
+        canvas_buffer_expand_indexed(
+            task->row_buffer + (y - task->y_top) * row_size,
+            canvas_row(task->cv, y),
+            task->palette->colors,
+            task->palette->color_size,
+            task->cv->width
+        );
+    }
+}
+
+/**
+ * Export an indexed canvas by expanding it through a palette, a few rows at a time.
+ *
+ * @param cv             Canvas with `pixel_size` 1
+ * @param palette        Palette to look the pixels up in
+ * @param row_buffer     Buffer to hold the expanded rows, of size `rows_per_call * cv->width * palette->color_size` or larger
+ * @param rows_per_call  Number of rows to expand before each call to `function`. Nothing is exported if it is 0.
+ * @param function       Called with each block of expanded rows
+ * @param context        Passed to `function`
+ *
+ * Only `row_buffer` is needed on top of the canvas itself, so the full output frame never has to exist in memory.
+ */
+CANVAS_STATIC_INLINE void canvas_export_indexed(
+    const canvas_t* CANVAS_RESTRICT cv,
+    const canvas_palette_t* CANVAS_RESTRICT palette,
+    uint8_t* CANVAS_RESTRICT row_buffer,
+    size_t rows_per_call,
+    canvas_rows_function_t function,
+    void *context
+)
+{
+    if (rows_per_call == 0)
+    {
+        return;
+    }
+    canvas_fast_clear_resolve_all(cv);
+    for (size_t y_top = 0; y_top < cv->height; y_top += rows_per_call)
+    {
+        size_t y_bottom = y_top + rows_per_call;
+        if (y_bottom > cv->height)
+        {
+            y_bottom = cv->height;
+        }
+        canvas_export_indexed_task_t task = { cv, palette, row_buffer, y_top };
+        canvas_parallel_rows(
+            cv,
+            y_top,
+            y_bottom,
+            (y_bottom - y_top) * cv->width * palette->color_size,
+            canvas_export_indexed_rows,
+            &task
+        );
+        function(context, row_buffer, y_top, y_bottom);
+    }
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup DISPLAY_LIST Display lists
+ *
+ * Record drawing commands instead of executing them immediately, and render them later,
+ * either onto a canvas or in horizontal bands through a buffer that is only a few rows tall.
+ *
+ * @{
+ */
+
+#ifndef CANVAS_COMMAND_MAX_PIXEL_SIZE
+    /** Largest pixel size that can be recorded in a display list, in bytes */
+    #define CANVAS_COMMAND_MAX_PIXEL_SIZE 4
+#endif
+
+/**
+ * Type of a recorded command. Each type corresponds to a function in the @ref CANVAS_API.
+ */
+typedef enum canvas_command_type_t {
+    CANVAS_COMMAND_FILL,                    /**< @ref canvas_fill */
+    CANVAS_COMMAND_SET_PIXEL,               /**< @ref canvas_set_pixel, at (`x[0]`, `y[0]`) */
+    CANVAS_COMMAND_DRAW_RECT,               /**< @ref canvas_draw_rect, from (`x[0]`, `y[0]`) to (`x[1]`, `y[1]`) */
+    CANVAS_COMMAND_DRAW_HORIZONTAL_LINE,    /**< @ref canvas_draw_horizontal_line, from `x[0]` to `x[1]` at `y[0]` */
+    CANVAS_COMMAND_DRAW_VERTICAL_LINE,      /**< @ref canvas_draw_vertical_line, from `y[0]` to `y[1]` at `x[0]` */
+    CANVAS_COMMAND_DRAW_LINE,               /**< @ref canvas_draw_line, from (`x[0]`, `y[0]`) to (`x[1]`, `y[1]`) */
+    CANVAS_COMMAND_FILL_RECT,               /**< @ref canvas_fill_rect, from (`x[0]`, `y[0]`) to (`x[1]`, `y[1]`) */
+    CANVAS_COMMAND_DRAW_CIRCLE,             /**< @ref canvas_draw_circle, around (`x[0]`, `y[0]`) */
+    CANVAS_COMMAND_FILL_TRIANGLE,           /**< @ref canvas_fill_triangle, between `x[0..2]` and `y[0..2]` */
+    CANVAS_COMMAND_FILL_CIRCLE,             /**< @ref canvas_fill_circle, around (`x[0]`, `y[0]`) */
+    CANVAS_COMMAND_PLACE_BITMAP,            /**< @ref canvas_place_bitmap, from (`x[0]`, `y[0]`) to (`x[1]`, `y[1]`) */
+    CANVAS_COMMAND_TEXT_STM_DRAW_STRING,    /**< @ref canvas_text_stm_draw_string, starting at (`x[0]`, `y[0]`) */
+} canvas_command_type_t;
+
+/**
+ * A recorded command.
+ */
+typedef struct canvas_command_t {
+    canvas_command_type_t type;                             /**< Which command this is */
+    uint8_t pixel[CANVAS_COMMAND_MAX_PIXEL_SIZE];           /**< Pixel data; the foreground pixel for text */
+    uint8_t pixel_background[CANVAS_COMMAND_MAX_PIXEL_SIZE];/**< Background pixel data for text */
+    size_t x[3];                                            /**< X-coordinates; see @ref canvas_command_type_t */
+    size_t y[3];                                            /**< Y-coordinates; see @ref canvas_command_type_t */
+    size_t radius;                                          /**< Radius of circles */
+    const uint8_t *bitmap;                                  /**< Bitmap data. Not copied; must remain valid until rendered. */
+    sFONT *font;                                            /**< Font for text */
+    const char *string;                                     /**< String for text. Not copied; must remain valid until rendered. */
+} canvas_command_t;
+
+/**
+ * A list of recorded commands, in the order they were recorded.
+ */
+typedef struct canvas_display_list_t {
+    canvas_command_t *commands; /**< Storage for the commands */
+    size_t capacity;            /**< Number of commands that fit in `commands` */
+    size_t count;               /**< Number of commands recorded so far */
+    size_t width;               /**< Width of the canvas the commands are for, in number of pixels */
+    size_t height;              /**< Height of the canvas the commands are for, in number of pixels */
+    size_t pixel_size;          /**< Number of bytes per pixel */
+} canvas_display_list_t;
+
+/**
+ * Returns a new, empty display list.
+ *
+ * @param commands    Storage for up to `capacity` commands, which must remain valid for as long as the list is in use
+ * @param capacity    Number of commands that fit in `commands`
+ * @param width       Width of the canvas in pixels
+ * @param height      Height of the canvas in pixels
+ * @param pixel_size  The size of one pixel in memory, in bytes. At most @ref CANVAS_COMMAND_MAX_PIXEL_SIZE.
+ *
+ * @return Display list
+ */
+CANVAS_STATIC_INLINE canvas_display_list_t canvas_display_list_init(
+    canvas_command_t *commands,
+    size_t capacity,
+    size_t width,
+    size_t height,
+    size_t pixel_size
+)
+{
+    canvas_display_list_t list;
+    list.commands = commands;
+    list.capacity = capacity;
+    list.count = 0;
+    list.width = width;
+    list.height = height;
+    list.pixel_size = pixel_size;
+    return list;
+}
+
+/**
+ * Remove all commands from the display list.
+ *
+ * @param list Display list
+ */
+CANVAS_STATIC_INLINE void canvas_display_list_clear(canvas_display_list_t *list)
+{
+    list->count = 0;
+}
+
+/**
+ * For internal use. Append a command to the display list.
+ *
+ * @param list  Display list
+ * @param type  Type of the command
+ * @param pixel Pixel data for the command, or NULL
+ *
+ * @return The new command, with its type and pixel set, or NULL if the list is full.
+ */
+CANVAS_STATIC_INLINE canvas_command_t *canvas_display_list_push(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    canvas_command_type_t type,
+    const uint8_t* CANVAS_RESTRICT pixel
+)
+{
+    if (list->count >= list->capacity)
+    {
+        return NULL;
+    }
+    canvas_command_t *command = &list->commands[list->count++];
+    command->type = type;
+    if (pixel)
+    {
+        memcpy(command->pixel, pixel, list->pixel_size);
+    }
+    return command;
+}
+
+/**
+ * For internal use. Append a command with up to two points to the display list.
+ *
+ * @param list  Display list
+ * @param type  Type of the command
+ * @param pixel Pixel data for the command, or NULL
+ * @param x_0   Stored in `x[0]`
+ * @param x_1   Stored in `x[1]`
+ * @param y_0   Stored in `y[0]`
+ * @param y_1   Stored in `y[1]`
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_display_list_push_points(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    canvas_command_type_t type,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_0,
+    size_t x_1,
+    size_t y_0,
+    size_t y_1
+)
+{
+    canvas_command_t *command = canvas_display_list_push(list, type, pixel);
+    if (!command)
+    {
+        return false;
+    }
+    command->x[0] = x_0;
+    command->x[1] = x_1;
+    command->y[0] = y_0;
+    command->y[1] = y_1;
+    return true;
+}
+
+/**
+ * Record a call to @ref canvas_fill.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_fill(canvas_display_list_t* CANVAS_RESTRICT list, const uint8_t* CANVAS_RESTRICT pixel)
+{
+    return canvas_display_list_push(list, CANVAS_COMMAND_FILL, pixel) != NULL;
+}
+
+/**
+ * Record a call to @ref canvas_set_pixel.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_set_pixel(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x,
+    size_t y
+)
+{
+    return canvas_display_list_push_points(list, CANVAS_COMMAND_SET_PIXEL, pixel, x, x + 1, y, y + 1);
+}
+
+/**
+ * Record a call to @ref canvas_draw_rect.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_draw_rect(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    return canvas_display_list_push_points(list, CANVAS_COMMAND_DRAW_RECT, pixel, x_left, x_right, y_top, y_bottom);
+}
+
+/**
+ * Record a call to @ref canvas_draw_horizontal_line.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_draw_horizontal_line(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y
+)
+{
+    return canvas_display_list_push_points(list, CANVAS_COMMAND_DRAW_HORIZONTAL_LINE, pixel, x_left, x_right, y, y + 1);
+}
+
+/**
+ * Record a call to @ref canvas_draw_vertical_line.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_draw_vertical_line(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    return canvas_display_list_push_points(list, CANVAS_COMMAND_DRAW_VERTICAL_LINE, pixel, x, x + 1, y_top, y_bottom);
+}
+
+/**
+ * Record a call to @ref canvas_draw_line.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_draw_line(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    return canvas_display_list_push_points(list, CANVAS_COMMAND_DRAW_LINE, pixel, x_left, x_right, y_top, y_bottom);
+}
+
+/**
+ * Record a call to @ref canvas_fill_rect.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_fill_rect(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    return canvas_display_list_push_points(list, CANVAS_COMMAND_FILL_RECT, pixel, x_left, x_right, y_top, y_bottom);
+}
+
+/**
+ * Record a call to @ref canvas_draw_circle.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_draw_circle(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_command_t *command = canvas_display_list_push(list, CANVAS_COMMAND_DRAW_CIRCLE, pixel);
+    if (!command)
+    {
+        return false;
+    }
+    command->x[0] = x_center;
+    command->y[0] = y_center;
+    command->radius = radius;
+    return true;
+}
+
+/**
+ * Record a call to @ref canvas_fill_triangle.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_fill_triangle(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_0,
+    size_t x_1,
+    size_t x_2,
+    size_t y_0,
+    size_t y_1,
+    size_t y_2
+)
+{
+    canvas_command_t *command = canvas_display_list_push(list, CANVAS_COMMAND_FILL_TRIANGLE, pixel);
+    if (!command)
+    {
+        return false;
+    }
+    command->x[0] = x_0;
+    command->x[1] = x_1;
+    command->x[2] = x_2;
+    command->y[0] = y_0;
+    command->y[1] = y_1;
+    command->y[2] = y_2;
+    return true;
+}
+
+/**
+ * Record a call to @ref canvas_fill_circle.
+ *
+ * @return Whether there was room for the command.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_fill_circle(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT pixel,
+    size_t x_center,
+    size_t y_center,
+    size_t radius
+)
+{
+    canvas_command_t *command = canvas_display_list_push(list, CANVAS_COMMAND_FILL_CIRCLE, pixel);
+    if (!command)
+    {
+        return false;
+    }
+    command->x[0] = x_center;
+    command->y[0] = y_center;
+    command->radius = radius;
+    return true;
+}
+
+/**
+ * Record a call to @ref canvas_place_bitmap.
+ *
+ * @return Whether there was room for the command.
+ *
+ * @warning The bitmap is not copied, and must remain valid until the display list has been rendered.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_place_bitmap(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    const uint8_t* CANVAS_RESTRICT bitmap,
+    size_t x_left,
+    size_t x_right,
+    size_t y_top,
+    size_t y_bottom
+)
+{
+    if (!canvas_display_list_push_points(list, CANVAS_COMMAND_PLACE_BITMAP, NULL, x_left, x_right, y_top, y_bottom))
+    {
+        return false;
+    }
+    list->commands[list->count - 1].bitmap = bitmap;
+    return true;
+}
+
+/**
+ * Record a call to @ref canvas_text_stm_draw_string.
+ *
+ * @return Whether there was room for the command.
+ *
+ * @warning The string is not copied, and must remain valid until the display list has been rendered.
+ */
+CANVAS_STATIC_INLINE bool canvas_record_text_stm_draw_string(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    sFONT *font,
+    const uint8_t *pixel_foreground,
+    const uint8_t *pixel_background,
+    const char *string,
+    size_t x_left,
+    size_t y_top
+)
+{
+    canvas_command_t *command = canvas_display_list_push(list, CANVAS_COMMAND_TEXT_STM_DRAW_STRING, pixel_foreground);
+    if (!command)
+    {
+        return false;
+    }
+    memcpy(command->pixel_background, pixel_background, list->pixel_size);
+    command->font = font;
+    command->string = string;
+    command->x[0] = x_left;
+    command->y[0] = y_top;
+    return true;
+}
+
+/**
+ * Execute a recorded command on a canvas.
+ *
+ * @param cv      Canvas
+ * @param command The command
+ */
+CANVAS_STATIC_INLINE void canvas_execute_command(canvas_t* CANVAS_RESTRICT cv, const canvas_command_t* CANVAS_RESTRICT command)
+{
+    const size_t *x = command->x;
+    const size_t *y = command->y;
+    switch (command->type)
+    {
+        case CANVAS_COMMAND_FILL:
+            canvas_fill(cv, command->pixel);
+            break;
+        case CANVAS_COMMAND_SET_PIXEL:
+            canvas_set_pixel(cv, command->pixel, x[0], y[0]);
+            break;
+        case CANVAS_COMMAND_DRAW_RECT:
+            canvas_draw_rect(cv, command->pixel, x[0], x[1], y[0], y[1]);
+            break;
+        case CANVAS_COMMAND_DRAW_HORIZONTAL_LINE:
+            canvas_draw_horizontal_line(cv, command->pixel, x[0], x[1], y[0]);
+            break;
+        case CANVAS_COMMAND_DRAW_VERTICAL_LINE:
+            canvas_draw_vertical_line(cv, command->pixel, x[0], y[0], y[1]);
+            break;
+        case CANVAS_COMMAND_DRAW_LINE:
+            canvas_draw_line(cv, command->pixel, x[0], x[1], y[0], y[1]);
+            break;
+        case CANVAS_COMMAND_FILL_RECT:
+            canvas_fill_rect(cv, command->pixel, x[0], x[1], y[0], y[1]);
+            break;
+        case CANVAS_COMMAND_DRAW_CIRCLE:
+            canvas_draw_circle(cv, command->pixel, x[0], y[0], command->radius);
+            break;
+        case CANVAS_COMMAND_FILL_TRIANGLE:
+            canvas_fill_triangle(cv, command->pixel, x[0], x[1], x[2], y[0], y[1], y[2]);
+            break;
+        case CANVAS_COMMAND_FILL_CIRCLE:
+            canvas_fill_circle(cv, command->pixel, x[0], y[0], command->radius);
+            break;
+        case CANVAS_COMMAND_PLACE_BITMAP:
+            canvas_place_bitmap(cv, command->bitmap, x[0], x[1], y[0], y[1]);
+            break;
+        case CANVAS_COMMAND_TEXT_STM_DRAW_STRING:
+            canvas_text_stm_draw_string(cv, command->font, command->pixel, command->pixel_background, command->string, x[0], y[0]);
+            break;
+    }
+}
+
+/**
+ * Render every command in a display list onto a canvas, in the order they were recorded.
+ *
+ * @param cv   Canvas with the same geometry as the display list
+ * @param list Display list
+ */
+CANVAS_STATIC_INLINE void canvas_display_list_draw(canvas_t* CANVAS_RESTRICT cv, const canvas_display_list_t* CANVAS_RESTRICT list)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        canvas_execute_command(cv, &list->commands[i]);
+    }
+}
+
+/**
+ * For internal use. A band of rows being rendered by @ref canvas_display_list_render_bands.
+ */
+typedef struct canvas_band_t {
+    uint8_t *buffer;        /**< Memory for the rows in the band */
+    const uint8_t *pixel;   /**< Pixel data for spans */
+    size_t pixel_size;      /**< Number of bytes per pixel */
+    size_t width;           /**< Width of the canvas, in number of pixels */
+    int y_top;              /**< Y-coordinate of the first row in the band */
+    int y_bottom;           /**< Y-coordinate of the last row in the band, plus 1. */
+} canvas_band_t;
+
+/**
+ * For internal use. Span function which clips each span to a band and places it into the band's buffer.
+ *
+ * @param context  Pointer to a @ref canvas_band_t
+ * @param x_left   X-coordinate of the leftmost pixel in the span
+ * @param x_right  X-coordinate of the rightmost pixel in the span, plus 1.
+ * @param y        Y-coordinate of the span
+ */
+CANVAS_STATIC_INLINE void canvas_band_span(void *context, int x_left, int x_right, int y)
+{
+    const canvas_band_t *band = (const canvas_band_t *)context;
+    if (y < band->y_top || y >= band->y_bottom)
+    {
+        return;
+    }
+    if (x_left < 0)
+    {
+        x_left = 0;
+    }
+    if (x_right > (int)band->width)
+    {
+        x_right = (int)band->width;
+    }
+    if (x_left >= x_right)
+    {
+        return;
+    }
+    canvas_buffer_draw_horizontal_line_stride(
+        band->buffer,
+        band->pixel,
+        band->pixel_size,
+        band->width * band->pixel_size,
+        (size_t)x_left,
+        (size_t)x_right,
+        (size_t)(y - band->y_top)
+    );
+}
+
+/**
+ * For internal use. The range of rows that a command may draw into.
+ *
+ * @param command  The command
+ * @param height   Height of the canvas
+ * @param y_top    Receives the first row
+ * @param y_bottom Receives the last row, plus 1.
+ */
+CANVAS_STATIC_INLINE void canvas_command_rows(const canvas_command_t *command, size_t height, int *y_top, int *y_bottom)
+{
+    int y_0 = (int)command->y[0];
+    int y_1 = (int)command->y[1];
+    int y_2 = (int)command->y[2];
+    int radius = (int)command->radius;
+    switch (command->type)
+    {
+        case CANVAS_COMMAND_DRAW_LINE:
+            *y_top = y_0 < y_1 ? y_0 : y_1;
+            *y_bottom = (y_0 > y_1 ? y_0 : y_1) + 1;
+            break;
+        case CANVAS_COMMAND_FILL_TRIANGLE:
+            *y_top = y_0 < y_1 ? (y_0 < y_2 ? y_0 : y_2) : (y_1 < y_2 ? y_1 : y_2);
+            *y_bottom = y_0 > y_1 ? (y_0 > y_2 ? y_0 : y_2) : (y_1 > y_2 ? y_1 : y_2);
+            break;
+        case CANVAS_COMMAND_DRAW_CIRCLE:
+        case CANVAS_COMMAND_FILL_CIRCLE:
+            *y_top = y_0 - radius;
+            *y_bottom = y_0 + radius + 1;
+            break;
+        case CANVAS_COMMAND_TEXT_STM_DRAW_STRING:
+            // Text wraps onto as many rows as it needs
+            *y_top = y_0;
+            *y_bottom = (int)height;
+            break;
+        case CANVAS_COMMAND_FILL:
+            *y_top = 0;
+            *y_bottom = (int)height;
+            break;
+        default:
+            *y_top = y_0;
+            *y_bottom = y_1;
+            break;
+    }
+}
+
+/**
+ * For internal use. Render the part of a string which falls within a band.
+ *
+ * @param band    The band
+ * @param command A @ref CANVAS_COMMAND_TEXT_STM_DRAW_STRING command
+ */
+CANVAS_STATIC_INLINE void canvas_band_text_stm_draw_string(const canvas_band_t *band, const canvas_command_t *command)
+{
+    // Same layout as canvas_text_stm_draw_string, but only the glyph rows inside the band are visited
+    const sFONT *font = command->font;
+    size_t bytes_per_row = (font->Width + 7) / 8;
+    size_t len = strlen(command->string);
+    size_t x_left = command->x[0];
+    size_t x = x_left;
+    size_t y = command->y[0];
+    for (size_t i = 0; i < len; i++)
+    {
+        size_t glyph = (size_t)(command->string[i] - ' ') * font->Height * bytes_per_row;
+        for (size_t dy = 0; dy < font->Height; dy++)
+        {
+            int row = (int)(y + dy);
+            if (row < band->y_top || row >= band->y_bottom)
+            {
+                continue;
+            }
+            const uint8_t *bits = font->table + glyph + dy * bytes_per_row;
+            uint8_t *destination = band->buffer + (size_t)(row - band->y_top) * band->width * band->pixel_size;
+            for (size_t dx = 0; dx < font->Width && x + dx < band->width; dx++)
+            {
+                const uint8_t *pixel = (bits[dx / 8] & (0x80 >> (dx & 7))) ? command->pixel : command->pixel_background;
+                memcpy(destination + (x + dx) * band->pixel_size, pixel, band->pixel_size);
+            }
+        }
+
+        x += font->Width;
+        if ((x + font->Width) > band->width - 5)
+        {
+            y += font->Height;
+            x = x_left;
+        }
+    }
+}
+
+/**
+ * For internal use. Render the part of a command which falls within a band.
+ *
+ * @param band    The band
+ * @param command The command
+ */
+CANVAS_STATIC_INLINE void canvas_band_execute_command(canvas_band_t *band, const canvas_command_t *command)
+{
+    int x_0 = (int)command->x[0];
+    int x_1 = (int)command->x[1];
+    int y_0 = (int)command->y[0];
+    int y_1 = (int)command->y[1];
+    band->pixel = command->pixel;
+    switch (command->type)
+    {
+        case CANVAS_COMMAND_FILL:
+            canvas_buffer_fill_stride(
+                band->buffer,
+                command->pixel,
+                band->pixel_size,
+                band->width * band->pixel_size,
+                band->width,
+                (size_t)(band->y_bottom - band->y_top)
+            );
+            break;
+        case CANVAS_COMMAND_SET_PIXEL:
+        case CANVAS_COMMAND_DRAW_HORIZONTAL_LINE:
+            canvas_band_span(band, x_0, x_1, y_0);
+            break;
+        case CANVAS_COMMAND_DRAW_VERTICAL_LINE:
+        case CANVAS_COMMAND_FILL_RECT:
+            for (int y = y_0 > band->y_top ? y_0 : band->y_top; y < y_1 && y < band->y_bottom; y++)
+            {
+                canvas_band_span(band, x_0, x_1, y);
+            }
+            break;
+        case CANVAS_COMMAND_DRAW_RECT:
+            canvas_raster_rect(x_0, x_1, y_0, y_1, canvas_band_span, band);
+            break;
+        case CANVAS_COMMAND_DRAW_LINE:
+            canvas_raster_line(x_0, x_1, y_0, y_1, canvas_band_span, band);
+            break;
+        case CANVAS_COMMAND_DRAW_CIRCLE:
+            canvas_raster_circle(x_0, y_0, (int)command->radius, canvas_band_span, band);
+            break;
+        case CANVAS_COMMAND_FILL_TRIANGLE:
+            canvas_raster_fill_triangle(
+                x_0,
+                x_1,
+                (int)command->x[2],
+                y_0,
+                y_1,
+                (int)command->y[2],
+                canvas_band_span,
+                band
+            );
+            break;
+        case CANVAS_COMMAND_FILL_CIRCLE:
+            canvas_raster_fill_circle(x_0, y_0, (int)command->radius, canvas_band_span, band);
+            break;
+        case CANVAS_COMMAND_PLACE_BITMAP:
+        {
+            size_t row_size_bitmap = (size_t)(x_1 - x_0) * band->pixel_size;
+            int x_left = x_0 > 0 ? x_0 : 0;
+            int x_right = x_1 < (int)band->width ? x_1 : (int)band->width;
+            if (x_left >= x_right)
+            {
+                break;
+            }
+            for (int y = y_0 > band->y_top ? y_0 : band->y_top; y < y_1 && y < band->y_bottom; y++)
+            {
+                memcpy(
+                    band->buffer + ((size_t)(y - band->y_top) * band->width + (size_t)x_left) * band->pixel_size,
+                    command->bitmap + (size_t)(y - y_0) * row_size_bitmap + (size_t)(x_left - x_0) * band->pixel_size,
+                    (size_t)(x_right - x_left) * band->pixel_size
+                );
+            }
+            break;
+        }
+        case CANVAS_COMMAND_TEXT_STM_DRAW_STRING:
+            canvas_band_text_stm_draw_string(band, command);
+            break;
+    }
+}
+
+/**
+ * Size of the memory needed for one band, in bytes.
+ *
+ * @param list        Display list
+ * @param band_height Number of rows per band
+ *
+ * @return `list->width * band_height * list->pixel_size`
+ */
+CANVAS_STATIC_INLINE size_t canvas_display_list_band_size(const canvas_display_list_t *list, size_t band_height)
+{
+    return list->width * band_height * list->pixel_size;
+}
+
+/**
+ * Render a display list in horizontal bands, handing each finished band to a flush function.
+ *
+ * Only `band_count` bands of `band_height` rows ever exist in memory, so the full frame never has to fit in RAM.
+ * Each band is rendered by replaying every command that touches its rows, clipped to the band.
+ * Bands start out with every byte 0, unless the list begins with @ref CANVAS_COMMAND_FILL, which covers them anyway.
+ *
+ * @param list        Display list
+ * @param band_memory Memory for the bands, of size `band_count * canvas_display_list_band_size(list, band_height)` or larger
+ * @param band_height Number of rows per band. The last band may be shorter.
+ * @param band_count  Number of band buffers to cycle through, usually 1 or 2
+ * @param flush       Called with each finished band
+ * @param context     Passed to `flush`
+ *
+ * With `band_count` 2, `flush` may start an asynchronous transfer (e.g. DMA) and return immediately,
+ * so that the next band is rendered while the previous one is being sent.
+ * It must then wait for the previous transfer to complete before starting the next one,
+ * since the band buffer is reused after `band_count` calls.
+ */
+CANVAS_STATIC_INLINE void canvas_display_list_render_bands(
+    const canvas_display_list_t *list,
+    uint8_t *band_memory,
+    size_t band_height,
+    size_t band_count,
+    canvas_rows_function_t flush,
+    void *context
+)
+{
+    size_t band_size = canvas_display_list_band_size(list, band_height);
+    bool cleared = list->count > 0 && list->commands[0].type == CANVAS_COMMAND_FILL;
+    size_t band_index = 0;
+    for (size_t y_top = 0; y_top < list->height; y_top += band_height)
+    {
+        size_t y_bottom = y_top + band_height;
+        if (y_bottom > list->height)
+        {
+            y_bottom = list->height;
+        }
+        canvas_band_t band;
+        band.buffer = band_memory + band_index * band_size;
+        band.pixel = NULL;
+        band.pixel_size = list->pixel_size;
+        band.width = list->width;
+        band.y_top = (int)y_top;
+        band.y_bottom = (int)y_bottom;
+        if (!cleared)
+        {
+            // Don't let the previous contents of the band memory show through
+            memset(band.buffer, 0, (y_bottom - y_top) * list->width * list->pixel_size);
+        }
+
+        for (size_t i = 0; i < list->count; i++)
+        {
+            const canvas_command_t *command = &list->commands[i];
+            int command_top;
+            int command_bottom;
+            canvas_command_rows(command, list->height, &command_top, &command_bottom);
+            if (command_bottom > band.y_top && command_top < band.y_bottom)
+            {
+                canvas_band_execute_command(&band, command);
+            }
+        }
+
+        flush(context, band.buffer, y_top, y_bottom);
+        band_index = (band_index + 1) % band_count;
+    }
+}
+
+/**
+ * For internal use. The range of columns that a command may draw into.
+ *
+ * @param command The command
+ * @param width   Width of the canvas
+ * @param x_left  Receives the first column
+ * @param x_right Receives the last column, plus 1.
+ */
+CANVAS_STATIC_INLINE void canvas_command_columns(const canvas_command_t *command, size_t width, int *x_left, int *x_right)
+{
+    int x_0 = (int)command->x[0];
+    int x_1 = (int)command->x[1];
+    int x_2 = (int)command->x[2];
+    int radius = (int)command->radius;
+    switch (command->type)
+    {
+        case CANVAS_COMMAND_DRAW_LINE:
+            *x_left = x_0 < x_1 ? x_0 : x_1;
+            *x_right = (x_0 > x_1 ? x_0 : x_1) + 1;
+            break;
+        case CANVAS_COMMAND_FILL_TRIANGLE:
+            *x_left = x_0 < x_1 ? (x_0 < x_2 ? x_0 : x_2) : (x_1 < x_2 ? x_1 : x_2);
+            *x_right = x_0 > x_1 ? (x_0 > x_2 ? x_0 : x_2) : (x_1 > x_2 ? x_1 : x_2);
+            break;
+        case CANVAS_COMMAND_DRAW_CIRCLE:
+        case CANVAS_COMMAND_FILL_CIRCLE:
+            *x_left = x_0 - radius;
+            *x_right = x_0 + radius + 1;
+            break;
+        case CANVAS_COMMAND_TEXT_STM_DRAW_STRING:
+            // Wrapped lines start again at x[0]
+            *x_left = x_0;
+            *x_right = (int)width;
+            break;
+        case CANVAS_COMMAND_FILL:
+            *x_left = 0;
+            *x_right = (int)width;
+            break;
+        default:
+            *x_left = x_0;
+            *x_right = x_1;
+            break;
+    }
+}
+
+/**
+ * Size of the memory needed by @ref canvas_display_list_cull, in bytes.
+ *
+ * @param list        Display list
+ * @param tile_width  Width of a tile in pixels
+ * @param tile_height Height of a tile in pixels
+ *
+ * @return One byte per tile covering the canvas
+ */
+CANVAS_STATIC_INLINE size_t canvas_display_list_cull_size(const canvas_display_list_t *list, size_t tile_width, size_t tile_height)
+{
+    return ((list->width + tile_width - 1) / tile_width) * ((list->height + tile_height - 1) / tile_height);
+}
+
+/**
+ * For internal use. Whether every tile in a range is covered.
+ *
+ * @param coverage     One byte per tile, row by row
+ * @param columns      Number of tiles across the canvas
+ * @param column_left  First column of tiles
+ * @param column_right Last column of tiles, plus 1.
+ * @param row_top      First row of tiles
+ * @param row_bottom   Last row of tiles, plus 1.
+ */
+CANVAS_STATIC_INLINE bool canvas_cull_covered(
+    const uint8_t *coverage,
+    size_t columns,
+    size_t column_left,
+    size_t column_right,
+    size_t row_top,
+    size_t row_bottom
+)
+{
+    for (size_t row = row_top; row < row_bottom; row++)
+    {
+        for (size_t column = column_left; column < column_right; column++)
+        {
+            if (!coverage[row * columns + column])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Remove the commands whose pixels are all drawn over by later commands, and trim those which are partly drawn over.
+ *
+ * Fills, filled rectangles and bitmaps replace every pixel they cover, so they hide what was drawn
+ * underneath them earlier. The list is walked from the last command to the first while keeping track of which tiles
+ * are already hidden: a command whose bounds only touch hidden tiles is removed, and a fill or filled rectangle
+ * loses the rows and columns of hidden tiles along its edges. A bitmap loses hidden rows at its top and bottom only,
+ * since its rows cannot be narrowed. A partly hidden fill becomes a filled rectangle.
+ * The commands that remain keep their order, and render the same pixels as before.
+ *
+ * Culling is conservative: only tiles lying wholly inside a fill, rectangle or bitmap count as hidden,
+ * and other commands are judged by their bounding box. Smaller tiles find more to remove at the cost of more memory
+ * and time; tiles one pixel tall trim rectangles to exact rows.
+ *
+ * @param list        Display list
+ * @param tile_width  Width of a tile in pixels, at least 1
+ * @param tile_height Height of a tile in pixels, at least 1
+ * @param coverage    Scratch memory of size `canvas_display_list_cull_size(list, tile_width, tile_height)` or larger
+ *
+ * @return Number of commands removed
+ */
+CANVAS_STATIC_INLINE size_t canvas_display_list_cull(
+    canvas_display_list_t* CANVAS_RESTRICT list,
+    size_t tile_width,
+    size_t tile_height,
+    uint8_t* CANVAS_RESTRICT coverage
+)
+{
+    int width = (int)list->width;
+    int height = (int)list->height;
+    int tw = (int)tile_width;
+    int th = (int)tile_height;
+    size_t columns = (list->width + tile_width - 1) / tile_width;
+    size_t rows = (list->height + tile_height - 1) / tile_height;
+    memset(coverage, 0, columns * rows);
+
+    // Kept commands are moved towards the end as they are found, then back to the start
+    size_t keep = list->count;
+    for (size_t i = list->count; i-- > 0;)
+    {
+        canvas_command_t *command = &list->commands[i];
+        int x_left;
+        int x_right;
+        int y_top;
+        int y_bottom;
+        canvas_command_columns(command, list->width, &x_left, &x_right);
+        canvas_command_rows(command, list->height, &y_top, &y_bottom);
+        x_left = x_left > 0 ? x_left : 0;
+        x_right = x_right < width ? x_right : width;
+        y_top = y_top > 0 ? y_top : 0;
+        y_bottom = y_bottom < height ? y_bottom : height;
+        if (x_left >= x_right || y_top >= y_bottom)
+        {
+            continue;
+        }
+
+        size_t column_left = (size_t)(x_left / tw);
+        size_t column_right = (size_t)((x_right - 1) / tw + 1);
+        size_t row_top = (size_t)(y_top / th);
+        size_t row_bottom = (size_t)((y_bottom - 1) / th + 1);
+        if (canvas_cull_covered(coverage, columns, column_left, column_right, row_top, row_bottom))
+        {
+            continue;
+        }
+
+        if (command->type == CANVAS_COMMAND_FILL
+            || command->type == CANVAS_COMMAND_FILL_RECT
+            || command->type == CANVAS_COMMAND_PLACE_BITMAP)
+        {
+            // Trim hidden tiles off the edges; at least one tile is not hidden, so this stops before the command is empty
+            int trim_top = y_top;
+            int trim_bottom = y_bottom;
+            int trim_left = x_left;
+            int trim_right = x_right;
+            size_t trim_row_top = row_top;
+            size_t trim_row_bottom = row_bottom;
+            while (canvas_cull_covered(coverage, columns, column_left, column_right, trim_row_top, trim_row_top + 1))
+            {
+                trim_row_top++;
+                trim_top = (int)trim_row_top * th;
+            }
+            while (canvas_cull_covered(coverage, columns, column_left, column_right, trim_row_bottom - 1, trim_row_bottom))
+            {
+                trim_row_bottom--;
+                trim_bottom = (int)trim_row_bottom * th;
+            }
+            if (command->type != CANVAS_COMMAND_PLACE_BITMAP)
+            {
+                size_t trim_column_left = column_left;
+                size_t trim_column_right = column_right;
+                while (canvas_cull_covered(coverage, columns, trim_column_left, trim_column_left + 1, trim_row_top, trim_row_bottom))
+                {
+                    trim_column_left++;
+                    trim_left = (int)trim_column_left * tw;
+                }
+                while (canvas_cull_covered(coverage, columns, trim_column_right - 1, trim_column_right, trim_row_top, trim_row_bottom))
+                {
+                    trim_column_right--;
+                    trim_right = (int)trim_column_right * tw;
+                }
+            }
+
+            bool trimmed = trim_top != y_top || trim_bottom != y_bottom || trim_left != x_left || trim_right != x_right;
+            if (command->type == CANVAS_COMMAND_PLACE_BITMAP)
+            {
+                size_t row_size_bitmap = (command->x[1] - command->x[0]) * list->pixel_size;
+                command->bitmap += (size_t)(trim_top - (int)command->y[0]) * row_size_bitmap;
+                command->y[0] = (size_t)trim_top;
+                command->y[1] = (size_t)trim_bottom;
+            }
+            else if (trimmed || command->type == CANVAS_COMMAND_FILL_RECT)
+            {
+                command->type = CANVAS_COMMAND_FILL_RECT;
+                command->x[0] = (size_t)trim_left;
+                command->x[1] = (size_t)trim_right;
+                command->y[0] = (size_t)trim_top;
+                command->y[1] = (size_t)trim_bottom;
+            }
+
+            // The untrimmed bounds hide whatever lies wholly inside them
+            size_t hide_left = (size_t)((x_left + tw - 1) / tw);
+            size_t hide_right = x_right == width ? columns : (size_t)(x_right / tw);
+            size_t hide_top = (size_t)((y_top + th - 1) / th);
+            size_t hide_bottom = y_bottom == height ? rows : (size_t)(y_bottom / th);
+            for (size_t row = hide_top; row < hide_bottom; row++)
+            {
+                for (size_t column = hide_left; column < hide_right; column++)
+                {
+                    coverage[row * columns + column] = 1;
+                }
+            }
+        }
+
+        list->commands[--keep] = *command;
+    }
+
+    size_t removed = keep;
+    memmove(list->commands, list->commands + keep, (list->count - keep) * sizeof(canvas_command_t));
+    list->count -= removed;
+    return removed;
+}
+
+/**
+ * @}
+ */
+
+#if CANVAS_FEATURE_COMMAND_QUEUE
+/**
+ * @defgroup COMMAND_QUEUE Command queue
+ *
+ * Let several threads draw onto one canvas without locking around every call.
+ *
+ * Each producing thread records commands into its own @ref canvas_command_block_t with the `canvas_record_*` functions,
+ * which touch no shared state, and then submits the whole block with @ref canvas_command_queue_submit.
+ * A single rendering thread replays submitted blocks onto the canvas with @ref canvas_command_queue_replay,
+ * in the order they were submitted, and hands each block back empty.
+ *
+ * The queue is a bounded lock-free ring in which every slot carries a sequence number,
+ * so a submission costs one compare-and-swap, and producers never wait for each other or for the renderer.
+ * A producer that wants to keep recording while its block is in flight can alternate between two blocks.
+ *
+ * Exists only if @ref CANVAS_FEATURE_COMMAND_QUEUE=1. Uses the GCC `__atomic` builtins.
+ *
+ * @{
+ */
+
+#ifndef CANVAS_COMMAND_QUEUE_SIZE
+    /** Largest number of blocks that can be waiting in a command queue. Must be a power of 2. */
+    #define CANVAS_COMMAND_QUEUE_SIZE 64
+#endif
+
+/**
+ * A block of commands recorded by one producing thread.
+ */
+typedef struct canvas_command_block_t {
+    canvas_display_list_t list; /**< The commands. Record into it with the `canvas_record_*` functions. */
+    bool pending;               /**< Internal. Set while the block is submitted and has not been replayed yet */
+} canvas_command_block_t;
+
+/**
+ * For internal use. A slot of the command queue.
+ *
+ * The slot for submission `n` is free when its sequence number is `n`, and holds a block when it is `n + 1`.
+ */
+typedef struct canvas_command_queue_slot_t {
+    size_t sequence;                /**< Sequence number */
+    canvas_command_block_t *block;  /**< The submitted block */
+} canvas_command_queue_slot_t;
+
+/**
+ * A queue of command blocks from any number of producing threads to one rendering thread.
+ *
+ * Must be initialized with @ref canvas_command_queue_init.
+ */
+typedef struct canvas_command_queue_t {
+    canvas_command_queue_slot_t slots[CANVAS_COMMAND_QUEUE_SIZE];   /**< Internal. Slot `n % CANVAS_COMMAND_QUEUE_SIZE` is used for submission `n` */
+    size_t head;                                                    /**< Internal. Number of submissions ever claimed by producers */
+    size_t tail;                                                    /**< Internal. Number of submissions ever replayed. Only used by the rendering thread. */
+} canvas_command_queue_t;
+
+/**
+ * Set up an empty command queue.
+ *
+ * @param queue The queue
+ */
+CANVAS_STATIC_INLINE void canvas_command_queue_init(canvas_command_queue_t *queue)
+{
+    for (size_t i = 0; i < CANVAS_COMMAND_QUEUE_SIZE; i++)
+    {
+        queue->slots[i].sequence = i;
+        queue->slots[i].block = NULL;
+    }
+    queue->head = 0;
+    queue->tail = 0;
+}
+
+/**
+ * Returns a new, empty command block. The parameters are the same as for @ref canvas_display_list_init.
+ *
+ * @return Command block
+ */
+CANVAS_STATIC_INLINE canvas_command_block_t canvas_command_block_init(
+    canvas_command_t *commands,
+    size_t capacity,
+    size_t width,
+    size_t height,
+    size_t pixel_size
+)
+{
+    canvas_command_block_t block;
+    block.list = canvas_display_list_init(commands, capacity, width, height, pixel_size);
+    block.pending = false;
+    return block;
+}
+
+/**
+ * Whether a block is still waiting to be replayed. It must not be recorded into or submitted again until it is not.
+ *
+ * @param block The block
+ *
+ * @return Whether the block is pending
+ */
+CANVAS_STATIC_INLINE bool canvas_command_block_pending(const canvas_command_block_t *block)
+{
+    return __atomic_load_n(&block->pending, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Submit a block of recorded commands. May be called from any number of threads at once.
+ *
+ * @param queue The queue
+ * @param block The block. It belongs to the queue until @ref canvas_command_block_pending returns false,
+ *              at which point it has been replayed and emptied.
+ *
+ * An empty block is not submitted.
+ *
+ * @return Whether the block was submitted; false if the queue was full, in which case the block can be submitted again later.
+ */
+CANVAS_STATIC_INLINE bool canvas_command_queue_submit(canvas_command_queue_t *queue, canvas_command_block_t *block)
+{
+    if (block->list.count == 0)
+    {
+        return true;
+    }
+    size_t position = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        canvas_command_queue_slot_t *slot = &queue->slots[position & (CANVAS_COMMAND_QUEUE_SIZE - 1)];
+        size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == position)
+        {
+            // The slot is free; claim it, or learn the new head if another producer got there first
+            if (__atomic_compare_exchange_n(&queue->head, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                __atomic_store_n(&block->pending, true, __ATOMIC_RELAXED);
+                slot->block = block;
+                __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+        else if ((ptrdiff_t)(sequence - position) < 0)
+        {
+            // The slot still holds the block from one lap ago
+            return false;
+        }
+        else
+        {
+            position = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Replay every block that has been submitted so far onto the canvas, in submission order,
+ * and hand each block back to its producer empty. Must only be called from one thread at a time.
+ *
+ * @param queue The queue
+ * @param cv    The canvas to draw onto
+ *
+ * Replay stops early at a slot whose producer has claimed it but not finished filling it in,
+ * so that later blocks are never drawn before earlier ones; they are picked up by the next call.
+ *
+ * @return Number of blocks replayed
+ */
+CANVAS_STATIC_INLINE size_t canvas_command_queue_replay(canvas_command_queue_t* CANVAS_RESTRICT queue, canvas_t* CANVAS_RESTRICT cv)
+{
+    size_t replayed = 0;
+    for (;;)
+    {
+        canvas_command_queue_slot_t *slot = &queue->slots[queue->tail & (CANVAS_COMMAND_QUEUE_SIZE - 1)];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != queue->tail + 1)
+        {
+            return replayed;
+        }
+        canvas_command_block_t *block = slot->block;
+        __atomic_store_n(&slot->sequence, queue->tail + CANVAS_COMMAND_QUEUE_SIZE, __ATOMIC_RELEASE);
+        queue->tail++;
+
+        canvas_display_list_draw(cv, &block->list);
+        canvas_display_list_clear(&block->list);
+        __atomic_store_n(&block->pending, false, __ATOMIC_RELEASE);
+        replayed++;
+    }
+}
+
+/**
+ * @}
+ */
+#endif
+
+#if CANVAS_FEATURE_MAPPED_MEMORY
+/**
+ * @defgroup MAPPED_MEMORY Mapped memory
+ *
+ * Back a canvas with a POSIX shared memory object or a memory-mapped file,
+ * so that another process can map the same memory and read frames without copying them.
+ * Exists only if @ref CANVAS_FEATURE_MAPPED_MEMORY=1.
+ *
+ * @note With @ref CANVAS_FEATURE_TWO_BUFFERS=1, rotations and flips move the valid data between the two halves
+ *       of the mapping. A reader must then be told `cv.buffer - mapping.memory` to find the current frame.
+ *       Likewise, after @ref canvas_scroll_up or @ref canvas_scroll_down a reader must be told `cv.row_origin`
+ *       to find the top row of the frame.
+ *
+ * @note The functions here are POSIX rather than standard C. When compiling in a strict mode such as `-std=c99`,
+ *       define `_POSIX_C_SOURCE` as `200809L` (or define `_XOPEN_SOURCE` or `_DEFAULT_SOURCE`) before the first
+ *       system header is included; canvas.h stops with an error otherwise.
+ *
+ * @{
+ */
+
+#ifndef CANVAS_HUGE_PAGE_SIZE
+    /** Size that mappings are rounded up to when @ref CANVAS_MAP_HUGE_PAGES is given */
+    #define CANVAS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+#define CANVAS_MAP_CREATE     0x1 /**< Create the object or file if it does not exist, and size it to fit the canvas */
+#define CANVAS_MAP_READ_ONLY  0x2 /**< Map the memory read-only, for a process which only consumes frames */
+#define CANVAS_MAP_HUGE_PAGES 0x4 /**< Round the size up to @ref CANVAS_HUGE_PAGE_SIZE and ask the kernel to back it with huge pages */
+
+/**
+ * Describes a mapping created by @ref canvas_map_shared_memory or @ref canvas_map_file.
+ */
+typedef struct canvas_mapping_t {
+    uint8_t *memory;    /**< Start of the mapping. Always page aligned. */
+    size_t size;        /**< Size of the mapping in bytes; `alloc_size` rounded up to the page size. */
+} canvas_mapping_t;
+
+/**
+ * For internal use. Size an open file descriptor, map it and give the memory to the canvas.
+ *
+ * @param cv      A canvas that was returned from @ref canvas_init
+ * @param mapping Receives the mapping
+ * @param fd      Open file descriptor. It is not closed.
+ * @param flags   Combination of `CANVAS_MAP_*` flags
+ *
+ * @return Whether the memory was mapped. On failure, `errno` is set.
+ */
+CANVAS_STATIC_INLINE bool canvas_map_fd(canvas_t *cv, canvas_mapping_t *mapping, int fd, int flags)
+{
+    size_t page_size = (flags & CANVAS_MAP_HUGE_PAGES) ? CANVAS_HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (cv->alloc_size + page_size - 1) / page_size * page_size;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        return false;
+    }
+    if ((size_t)st.st_size < size)
+    {
+        if ((flags & CANVAS_MAP_READ_ONLY) || !(flags & CANVAS_MAP_CREATE))
+        {
+            // The producer has not sized the object for this canvas yet
+            if ((size_t)st.st_size < cv->alloc_size)
+            {
+                errno = EINVAL;
+                return false;
+            }
+            size = cv->alloc_size;
+        }
+        else if (ftruncate(fd, (off_t)size) != 0)
+        {
+            return false;
+        }
+    }
+
+    int protection = (flags & CANVAS_MAP_READ_ONLY) ? PROT_READ : (PROT_READ | PROT_WRITE);
+    void *memory = mmap(NULL, size, protection, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+    #ifdef MADV_HUGEPAGE
+        if (flags & CANVAS_MAP_HUGE_PAGES)
+        {
+            // Only a hint; the mapping works without huge pages if the kernel can't provide them
+            madvise(memory, size, MADV_HUGEPAGE);
+        }
+    #endif
+
+    mapping->memory = (uint8_t *)memory;
+    mapping->size = size;
+    canvas_set_memory(cv, mapping->memory);
+    return true;
+}
+
+/**
+ * Provide the canvas with memory from a POSIX shared memory object.
+ *
+ * @param cv      A canvas that was returned from @ref canvas_init
+ * @param mapping Receives the mapping, for passing to @ref canvas_unmap later
+ * @param name    Name of the shared memory object, e.g. `"/canvas"`
+ * @param flags   Combination of `CANVAS_MAP_*` flags
+ *
+ * @return Whether the memory was mapped. On failure, `errno` is set.
+ *
+ * The producer should pass @ref CANVAS_MAP_CREATE; a consumer with a canvas of the same geometry
+ * can pass @ref CANVAS_MAP_READ_ONLY and then read `cv.buffer` directly. Remove the object with `shm_unlink`.
+ */
+CANVAS_STATIC_INLINE bool canvas_map_shared_memory(canvas_t *cv, canvas_mapping_t *mapping, const char *name, int flags)
+{
+    int open_flags = (flags & CANVAS_MAP_READ_ONLY) ? O_RDONLY : O_RDWR;
+    if (flags & CANVAS_MAP_CREATE)
+    {
+        open_flags |= O_CREAT;
+    }
+    int fd = shm_open(name, open_flags, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool mapped = canvas_map_fd(cv, mapping, fd, flags);
+    close(fd);
+    return mapped;
+}
+
+/**
+ * Provide the canvas with memory from a memory-mapped file.
+ *
+ * @param cv      A canvas that was returned from @ref canvas_init
+ * @param mapping Receives the mapping, for passing to @ref canvas_unmap later
+ * @param path    Path to the file
+ * @param flags   Combination of `CANVAS_MAP_*` flags
+ *
+ * @return Whether the memory was mapped. On failure, `errno` is set.
+ */
+CANVAS_STATIC_INLINE bool canvas_map_file(canvas_t *cv, canvas_mapping_t *mapping, const char *path, int flags)
+{
+    int open_flags = (flags & CANVAS_MAP_READ_ONLY) ? O_RDONLY : O_RDWR;
+    if (flags & CANVAS_MAP_CREATE)
+    {
+        open_flags |= O_CREAT;
+    }
+    int fd = open(path, open_flags, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool mapped = canvas_map_fd(cv, mapping, fd, flags);
+    close(fd);
+    return mapped;
+}
+
+/**
+ * Release a mapping created by @ref canvas_map_shared_memory or @ref canvas_map_file.
+ *
+ * @param mapping The mapping
+ *
+ * @warning Any canvas using the mapping must not be used afterwards.
+ */
+CANVAS_STATIC_INLINE void canvas_unmap(canvas_mapping_t *mapping)
+{
+    munmap(mapping->memory, mapping->size);
+    mapping->memory = NULL;
+    mapping->size = 0;
+}
+
+/**
+ * @}
+ */
+#endif
+
+#if CANVAS_FEATURE_PRESENT_QUEUE
+/**
+ * @defgroup PRESENT_QUEUE Present queue
+ *
+ * Draw the next frame while the previous one is still being sent to the display.
+ *
+ * A present queue owns 2 or 3 frame buffers. The rendering thread draws into one of them through an ordinary canvas,
+ * and @ref canvas_present hands the finished frame to a display thread and points the canvas at the next free buffer.
+ * The display thread flushes frames in order and hands each buffer back once it is done with it.
+ * Frames and buffers travel between the two threads through lock-free single-producer, single-consumer rings.
+ * A thread that runs out of work sleeps on a condition variable, and the other thread only takes the lock
+ * to wake it while it sleeps, so a busy pipeline never touches the lock.
+ *
+ * Exists only if @ref CANVAS_FEATURE_PRESENT_QUEUE=1. Requires POSIX threads.
+ *
+ * @{
+ */
+
+#ifndef CANVAS_PRESENT_MAX_BUFFERS
+    /** Largest number of frame buffers a present queue can manage */
+    #define CANVAS_PRESENT_MAX_BUFFERS 3
+#endif
+
+/**
+ * Receives a finished frame on the display thread.
+ *
+ * @param context The context pointer that was passed to @ref canvas_present_start
+ * @param frame   The frame. Its buffer stays valid and unchanged until the function returns.
+ *
+ * Rows must be read with @ref canvas_row, since the frame may have been scrolled.
+ */
+typedef void (*canvas_frame_function_t)(void *context, const canvas_t *frame);
+
+/**
+ * For internal use. A lock-free ring of buffer indices with one producing thread and one consuming thread.
+ *
+ * `head` is only written by the producer and `tail` only by the consumer, so each index
+ * is published with a release store and picked up with an acquire load.
+ */
+typedef struct canvas_spsc_ring_t {
+    size_t items[CANVAS_PRESENT_MAX_BUFFERS];   /**< Buffer indices; slot `n % CANVAS_PRESENT_MAX_BUFFERS` holds item `n` */
+    size_t head;                                /**< Number of items ever pushed */
+    size_t tail;                                /**< Number of items ever popped */
+} canvas_spsc_ring_t;
+
+/**
+ * For internal use. Add an item to a ring. Must only be called from the producing thread.
+ *
+ * @return Whether there was room for the item
+ */
+CANVAS_STATIC_INLINE bool canvas_spsc_ring_push(canvas_spsc_ring_t *ring, size_t item)
+{
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == CANVAS_PRESENT_MAX_BUFFERS)
+    {
+        return false;
     }
+    ring->items[head % CANVAS_PRESENT_MAX_BUFFERS] = item;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
 
-    /**
-     * Copy the contents of the primary buffer into the temporary buffer.
-     * For testing; should not be required.
-     *
-     * @param cv Canvas
-     * @return nothing
-     */
-    CANVAS_STATIC_INLINE void canvas_sync_buffers(canvas_t *cv)
+/**
+ * For internal use. Take the oldest item from a ring. Must only be called from the consuming thread.
+ *
+ * @return Whether there was an item
+ */
+CANVAS_STATIC_INLINE bool canvas_spsc_ring_pop(canvas_spsc_ring_t *ring, size_t *item)
+{
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
     {
-        memcpy(cv->_temp_buffer, cv->buffer, cv->buffer_size);
+        return false;
     }
-#endif
+    *item = ring->items[tail % CANVAS_PRESENT_MAX_BUFFERS];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
 
 /**
- * Returns a new canvas where everything has been initialized except the actual memory.
+ * Holds the frame buffers of a present queue and the state shared with its display thread.
  *
- * @param width       Width of the canvas in pixels.
- * @param height      Height of the canvas in pixels.
- * @param pixel_size  The size of one pixel in memory, in bytes. For example, if your pixels are 3-byte RGB values, pixel_size should be 3.
+ * Must be initialized with @ref canvas_present_queue_init, and must not move while the display thread runs.
+ * Once it is no longer used, it must be released with @ref canvas_present_queue_destroy.
+ */
+typedef struct canvas_present_queue_t {
+    canvas_t frames[CANVAS_PRESENT_MAX_BUFFERS];    /**< Internal. The state of the canvas for each buffer as of when it was last presented */
+    size_t count;                                   /**< Number of frame buffers */
+    size_t current;                                 /**< Internal. Index of the buffer the canvas is drawing into */
+    canvas_spsc_ring_t ready;                       /**< Internal. Presented frames, from the rendering thread to the display thread */
+    canvas_spsc_ring_t free;                        /**< Internal. Flushed buffers, from the display thread back to the rendering thread */
+    canvas_frame_function_t function;               /**< Internal. Called by the display thread with each frame */
+    void *context;                                  /**< Internal. Passed to `function` */
+    pthread_t thread;                               /**< Internal. The display thread */
+    bool running;                                   /**< Internal. Cleared to ask the display thread to finish */
+    pthread_mutex_t mutex;                          /**< Internal. Held by a thread going to sleep, and by a thread waking it */
+    pthread_cond_t wake;                            /**< Internal. Signalled when a ring that a thread sleeps on gets an item, or on stop */
+    size_t sleepers;                                /**< Internal. Number of threads asleep or about to sleep. Only changed with `mutex` held. */
+} canvas_present_queue_t;
+
+/**
+ * Set up a present queue, and point the canvas at its first buffer.
  *
- * @warning After calling `canvas_t cv = canvas_init(...)`, the application must provide a buffer of size `cv.alloc_size` or larger
- *          by calling `canvas_set_memory(&cv, buffer)`.
+ * @param queue   The queue
+ * @param cv      A canvas that was returned from @ref canvas_init. Its memory does not need to be set.
+ * @param buffers `count` pointers, each to a buffer of size `cv->alloc_size` or larger
+ * @param count   Number of buffers; 2 for double buffering or 3 for triple buffering
  *
- * @note The only supported interactions with the canvas object are the provided API functions, as well as
- *       passing cv.buffer to other functions for display.
+ * With two buffers the renderer waits whenever it finishes a frame before the previous one has been flushed.
+ * A third buffer lets it run a whole frame ahead of the display, which smooths out uneven frame times.
  *
- * @return Canvas
+ * @return Whether `count` was supported
  */
-CANVAS_STATIC_INLINE canvas_t canvas_init(
-    size_t width,
-    size_t height,
-    size_t pixel_size
+CANVAS_STATIC_INLINE bool canvas_present_queue_init(
+    canvas_present_queue_t* CANVAS_RESTRICT queue,
+    canvas_t* CANVAS_RESTRICT cv,
+    uint8_t *const *buffers,
+    size_t count
 )
 {
-    size_t buffer_size = width * height * pixel_size;
-
-    return (canvas_t){
-        .width = width,
-        .height = height,
-        .pixel_size = pixel_size,
-        .buffer_size = buffer_size,
-        #if CANVAS_FEATURE_TWO_BUFFERS
-            .alloc_size = buffer_size * 2,
-            ._swapped = false
-        #else
-            .alloc_size = buffer_size
-        #endif
-    };
+    if (count < 2 || count > CANVAS_PRESENT_MAX_BUFFERS)
+    {
+        return false;
+    }
+    memset(queue, 0, sizeof(*queue));
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->wake, NULL);
+    queue->count = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        queue->frames[i] = *cv;
+        canvas_set_memory(&queue->frames[i], buffers[i]);
+        if (i > 0)
+        {
+            canvas_spsc_ring_push(&queue->free, i);
+        }
+    }
+    *cv = queue->frames[0];
+    return true;
 }
 
 /**
- * Provide the canvas with a pixel buffer.
+ * Release a present queue.
  *
- * @param canvas A canvas that was returned from @ref canvas_init
- * @param memory Pointer to a buffer of size `cv.alloc_size` or larger
+ * @param queue A queue set up with @ref canvas_present_queue_init whose display thread, if any, has been stopped
+ */
+CANVAS_STATIC_INLINE void canvas_present_queue_destroy(canvas_present_queue_t *queue)
+{
+    pthread_cond_destroy(&queue->wake);
+    pthread_mutex_destroy(&queue->mutex);
+}
+
+/**
+ * For internal use. Add an item to one of the rings of a present queue, and wake the other thread if it sleeps.
  *
- * @warning The memory pointed to by `memory` must remain valid for as long as `cv` is in use.
- *          This can be achieved by allocating it statically, globally, or with an allocator such as `malloc`.
- *          If `memory` was allocated on the stack, it will be invalid when the caller returns.
+ * @param queue The queue
+ * @param ring  `queue->ready` or `queue->free`
+ * @param item  Index of a buffer
  */
-CANVAS_STATIC_INLINE void canvas_set_memory(canvas_t *cv, uint8_t *memory)
+CANVAS_STATIC_INLINE void canvas_present_push(canvas_present_queue_t *queue, canvas_spsc_ring_t *ring, size_t item)
 {
-    cv->buffer = memory;
-    #if CANVAS_FEATURE_TWO_BUFFERS
-        cv->_temp_buffer = memory + cv->buffer_size;
-    #endif
+    // There are fewer buffers than slots, so there is always room
+    canvas_spsc_ring_push(ring, item);
+    // Pairs with the fence in canvas_present_pop: either the sleeper sees the item, or this sees the sleeper
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&queue->sleepers, __ATOMIC_RELAXED) != 0)
+    {
+        pthread_mutex_lock(&queue->mutex);
+        pthread_cond_broadcast(&queue->wake);
+        pthread_mutex_unlock(&queue->mutex);
+    }
 }
 
 /**
- * Set the value of a single pixel.
+ * For internal use. Take the oldest item from one of the rings of a present queue, sleeping until there is one.
  *
- * @param canvas Canvas
- * @param pixel  Pixel data for a single pixel, which will be placed into the canvas at the given coordinates.
- * @param x      X-coordinate in the canvas
- * @param y      Y-coordinate in the canvas
+ * @param queue   The queue
+ * @param ring    `queue->ready` or `queue->free`
+ * @param item    Receives the index of a buffer
+ * @param running If not NULL, waiting also ends once this is cleared and the ring is empty
  *
- * If the pixel data is representable as an integer literal, consider using @ref canvas_set_pixel_literal to avoid using a dummy variable.
+ * @return Whether an item was taken
  */
-CANVAS_STATIC_INLINE void canvas_set_pixel(canvas_t* CANVAS_RESTRICT cv, const uint8_t* CANVAS_RESTRICT pixel, size_t x, size_t y)
+CANVAS_STATIC_INLINE bool canvas_present_pop(
+    canvas_present_queue_t *queue,
+    canvas_spsc_ring_t *ring,
+    size_t *item,
+    const bool *running
+)
 {
-    canvas_buffer_set_pixel(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x,
-        y
-    );
+    if (canvas_spsc_ring_pop(ring, item))
+    {
+        return true;
+    }
+    bool taken;
+    pthread_mutex_lock(&queue->mutex);
+    __atomic_store_n(&queue->sleepers, queue->sleepers + 1, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        // Checked before looking for an item, so that every item pushed before the stop is seen
+        bool keep_waiting = running == NULL || __atomic_load_n(running, __ATOMIC_ACQUIRE);
+        taken = canvas_spsc_ring_pop(ring, item);
+        if (taken || !keep_waiting)
+        {
+            break;
+        }
+        pthread_cond_wait(&queue->wake, &queue->mutex);
+    }
+    __atomic_store_n(&queue->sleepers, queue->sleepers - 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&queue->mutex);
+    return taken;
 }
 
 /**
- * Draw the edges of a rectangle, 1 pixel wide.
+ * Hand the frame that has been drawn into the canvas to the display thread,
+ * and point the canvas at the next free buffer, waiting for one if necessary.
  *
- * @param canvas  Canvas
- * @param pixel   Pixel data for a single pixel, which will be used along the edge of the rectangle
- * @param x_left  X-coordinate of the left side of the rectangle
- * @param x_right X-coordinate of the right side of the rectangle, plus 1.
- * @param y_top   Y-coordinate of the top side of the rectangle
- * @param y_right Y-coordinate of the bottom side of the rectangle, plus 1.
+ * @param queue The queue
+ * @param cv    The canvas that was passed to @ref canvas_present_queue_init
  *
- * If the pixel data is representable as an integer literal, consider using @ref canvas_draw_rect_literal to avoid using a dummy variable.
+ * Must only be called from the rendering thread.
+ *
+ * @warning The canvas is left as it was when its new buffer was last presented, i.e. holding the frame from
+ *          `count` frames ago, including its row origin. Redraw everything that has changed since then.
  */
-CANVAS_STATIC_INLINE void canvas_draw_rect(
-    canvas_t* CANVAS_RESTRICT cv,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
-)
+CANVAS_STATIC_INLINE void canvas_present(canvas_present_queue_t* CANVAS_RESTRICT queue, canvas_t* CANVAS_RESTRICT cv)
 {
-    canvas_buffer_draw_rect(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x_left,
-        x_right,
-        y_top,
-        y_bottom
-    );
+    canvas_fast_clear_resolve_all(cv);
+    queue->frames[queue->current] = *cv;
+    canvas_present_push(queue, &queue->ready, queue->current);
+    canvas_present_pop(queue, &queue->free, &queue->current, NULL);
+    *cv = queue->frames[queue->current];
 }
 
-CANVAS_STATIC_INLINE void canvas_draw_horizontal_line(
-    canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT pixel,
-    size_t x_left,
-    size_t x_right,
-    size_t y
-)
+/**
+ * Take the oldest presented frame, if there is one. For applications that run their own display thread.
+ *
+ * @param queue The queue
+ * @param frame Receives the frame
+ *
+ * Must only be called from the display thread, and each frame must be handed back with @ref canvas_present_release.
+ *
+ * @return Whether there was a frame
+ */
+CANVAS_STATIC_INLINE bool canvas_present_acquire(canvas_present_queue_t *queue, const canvas_t **frame)
 {
-    canvas_buffer_draw_horizontal_line(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x_left,
-        x_right,
-        y
-    );
+    size_t index;
+    if (!canvas_spsc_ring_pop(&queue->ready, &index))
+    {
+        return false;
+    }
+    *frame = &queue->frames[index];
+    return true;
 }
 
-CANVAS_STATIC_INLINE void canvas_draw_vertical_line(
-    canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT pixel,
-    size_t x,
-    size_t y_top,
-    size_t y_bottom
-)
+/**
+ * Hand a flushed frame's buffer back to the rendering thread.
+ *
+ * @param queue The queue
+ * @param frame A frame from @ref canvas_present_acquire
+ *
+ * Must only be called from the display thread.
+ */
+CANVAS_STATIC_INLINE void canvas_present_release(canvas_present_queue_t *queue, const canvas_t *frame)
 {
-    canvas_buffer_draw_vertical_line(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x,
-        y_top,
-        y_bottom
-    );
+    canvas_present_push(queue, &queue->free, (size_t)(frame - queue->frames));
 }
 
-CANVAS_STATIC_INLINE void canvas_draw_line(
-    canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT pixel,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
-)
+/**
+ * For internal use. Body of the display thread started by @ref canvas_present_start.
+ */
+CANVAS_STATIC_INLINE void *canvas_present_thread(void *argument)
 {
-    canvas_buffer_draw_line(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x_left,
-        x_right,
-        y_top,
-        y_bottom
-    );
+    canvas_present_queue_t *queue = (canvas_present_queue_t *)argument;
+    size_t index;
+    while (canvas_present_pop(queue, &queue->ready, &index, &queue->running))
+    {
+        queue->function(queue->context, &queue->frames[index]);
+        canvas_present_push(queue, &queue->free, index);
+    }
+    return NULL;
 }
 
-CANVAS_STATIC_INLINE void canvas_fill_rect(
-    canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT pixel,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
-)
+/**
+ * Start a display thread which calls `function` with each presented frame, in order.
+ *
+ * @param queue    The queue
+ * @param function Called with each frame, e.g. to send it to the display
+ * @param context  Passed to `function`
+ *
+ * @return Whether the thread was started. On failure, `errno` is set.
+ */
+CANVAS_STATIC_INLINE bool canvas_present_start(canvas_present_queue_t *queue, canvas_frame_function_t function, void *context)
 {
-    canvas_buffer_fill_rect(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x_left,
-        x_right,
-        y_top,
-        y_bottom
-    );
+    queue->function = function;
+    queue->context = context;
+    __atomic_store_n(&queue->running, true, __ATOMIC_RELEASE);
+    int error = pthread_create(&queue->thread, NULL, canvas_present_thread, queue);
+    if (error != 0)
+    {
+        __atomic_store_n(&queue->running, false, __ATOMIC_RELEASE);
+        errno = error;
+        return false;
+    }
+    return true;
 }
 
-CANVAS_STATIC_INLINE void canvas_draw_circle(
-    canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT pixel,
-    size_t x_center,
-    size_t y_center,
-    size_t radius
-)
+/**
+ * Stop the display thread once it has flushed every frame presented so far, and wait for it to finish.
+ *
+ * @param queue A queue whose display thread was started with @ref canvas_present_start
+ */
+CANVAS_STATIC_INLINE void canvas_present_stop(canvas_present_queue_t *queue)
 {
-    canvas_buffer_draw_circle(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x_center,
-        y_center,
-        radius
-    );
+    pthread_mutex_lock(&queue->mutex);
+    __atomic_store_n(&queue->running, false, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&queue->wake);
+    pthread_mutex_unlock(&queue->mutex);
+    pthread_join(queue->thread, NULL);
 }
 
-CANVAS_STATIC_INLINE void canvas_fill_triangle(
-    canvas_t* CANVAS_RESTRICT cv,
-    const uint8_t* CANVAS_RESTRICT pixel,
-    size_t x_0,
-    size_t x_1,
-    size_t x_2,
-    size_t y_0,
-    size_t y_1,
-    size_t y_2
-)
+/**
+ * @}
+ */
+#endif
+
+#if CANVAS_FEATURE_IMAGE_EXPORT
+/**
+ * @defgroup IMAGE_EXPORT Image export
+ *
+ * Write a canvas to a file descriptor as a PPM, BMP or QOI image, streaming it row by row.
+ * Rows which are already in the output format are handed to `writev` straight from the canvas;
+ * all other output goes through a small fixed-size chunk, so no full-frame copy is ever made.
+ * Exists only if @ref CANVAS_FEATURE_IMAGE_EXPORT=1. Requires POSIX `writev`.
+ *
+ * @{
+ */
+
+#ifndef CANVAS_IMAGE_CHUNK_SIZE
+    /** Size of the buffer that converted pixels and headers are gathered in before writing, in bytes. At least 1078. */
+    #define CANVAS_IMAGE_CHUNK_SIZE 4096
+#endif
+
+#ifndef CANVAS_IMAGE_IOV_COUNT
+    /** Largest number of pieces handed to one `writev` call */
+    #define CANVAS_IMAGE_IOV_COUNT 64
+#endif
+
+/**
+ * Layout of the pixels in a canvas being exported. The canvas itself is agnostic of colours,
+ * so the caller tells the encoders how to read them.
+ */
+typedef enum canvas_image_format_t {
+    CANVAS_IMAGE_GRAY8,     /**< 1 byte: luminance */
+    CANVAS_IMAGE_RGB565,    /**< 2 bytes: a little-endian 16-bit word with red in the top 5 bits */
+    CANVAS_IMAGE_RGB888,    /**< 3 bytes: red, green, blue */
+    CANVAS_IMAGE_BGR888,    /**< 3 bytes: blue, green, red */
+    CANVAS_IMAGE_RGBA8888,  /**< 4 bytes: red, green, blue, alpha */
+    CANVAS_IMAGE_BGRA8888,  /**< 4 bytes: blue, green, red, alpha; i.e. a little-endian ARGB8888 word */
+} canvas_image_format_t;
+
+/**
+ * The size per pixel of a format.
+ *
+ * @param format The format
+ *
+ * @return The size per pixel in bytes
+ */
+CANVAS_STATIC_INLINE size_t canvas_image_pixel_size(canvas_image_format_t format)
 {
-    canvas_buffer_fill_triangle(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x_0,
-        x_1,
-        x_2,
-        y_0,
-        y_1,
-        y_2
-    );
+    switch (format)
+    {
+        case CANVAS_IMAGE_GRAY8: return 1;
+        case CANVAS_IMAGE_RGB565: return 2;
+        case CANVAS_IMAGE_RGB888:
+        case CANVAS_IMAGE_BGR888: return 3;
+        default: return 4;
+    }
+}
+
+/**
+ * For internal use. Read one pixel as red, green, blue and alpha.
+ *
+ * @param format The format of the pixel
+ * @param pixel  Pixel data
+ * @param rgba   Receives the channels. Alpha is 255 for formats without it.
+ */
+CANVAS_STATIC_INLINE void canvas_image_read_pixel(canvas_image_format_t format, const uint8_t *pixel, uint8_t rgba[4])
+{
+    rgba[3] = 255;
+    switch (format)
+    {
+        case CANVAS_IMAGE_GRAY8:
+            rgba[0] = rgba[1] = rgba[2] = pixel[0];
+            break;
+        case CANVAS_IMAGE_RGB565:
+        {
+            unsigned word = (unsigned)pixel[0] | ((unsigned)pixel[1] << 8);
+            unsigned r = word >> 11, g = (word >> 5) & 0x3F, b = word & 0x1F;
+            rgba[0] = (uint8_t)((r << 3) | (r >> 2));
+            rgba[1] = (uint8_t)((g << 2) | (g >> 4));
+            rgba[2] = (uint8_t)((b << 3) | (b >> 2));
+            break;
+        }
+        case CANVAS_IMAGE_RGB888:
+        case CANVAS_IMAGE_RGBA8888:
+            rgba[0] = pixel[0];
+            rgba[1] = pixel[1];
+            rgba[2] = pixel[2];
+            if (format == CANVAS_IMAGE_RGBA8888)
+            {
+                rgba[3] = pixel[3];
+            }
+            break;
+        case CANVAS_IMAGE_BGR888:
+        case CANVAS_IMAGE_BGRA8888:
+            rgba[0] = pixel[2];
+            rgba[1] = pixel[1];
+            rgba[2] = pixel[0];
+            if (format == CANVAS_IMAGE_BGRA8888)
+            {
+                rgba[3] = pixel[3];
+            }
+            break;
+    }
 }
 
-CANVAS_STATIC_INLINE void canvas_fill_circle(
-    canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT pixel,
-    size_t x_center,
-    size_t y_center,
-    size_t radius
-)
+/**
+ * For internal use. Gathers pieces of output and writes them with `writev`.
+ *
+ * Pieces are either references to memory that outlives the next flush, such as canvas rows,
+ * or bytes placed in `chunk`.
+ */
+typedef struct canvas_image_writer_t {
+    int fd;                                         /**< Where the output goes */
+    int count;                                      /**< Number of pieces in `iov` */
+    size_t used;                                    /**< Number of bytes of `chunk` in use */
+    struct iovec iov[CANVAS_IMAGE_IOV_COUNT];       /**< Pieces waiting to be written */
+    uint8_t chunk[CANVAS_IMAGE_CHUNK_SIZE];         /**< Holds converted pixels and headers */
+} canvas_image_writer_t;
+
+/**
+ * For internal use. Write every pending piece.
+ *
+ * @param writer The writer
+ *
+ * @return Whether everything was written. On failure, `errno` is set.
+ */
+CANVAS_STATIC_INLINE bool canvas_image_writer_flush(canvas_image_writer_t *writer)
 {
-    canvas_buffer_fill_circle(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->width,
-        x_center,
-        y_center,
-        radius
-    );
+    struct iovec *iov = writer->iov;
+    int count = writer->count;
+    while (count > 0)
+    {
+        ssize_t written = writev(writer->fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        // Skip what a short write got through and retry the rest
+        size_t left = (size_t)written;
+        while (count > 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+    writer->count = 0;
+    writer->used = 0;
+    return true;
 }
 
-CANVAS_STATIC_INLINE void canvas_place_bitmap(
-    canvas_t* CANVAS_RESTRICT cv,
-    const uint8_t* CANVAS_RESTRICT bitmap,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
-)
+/**
+ * For internal use. Queue a piece of memory to be written without copying it.
+ *
+ * @param writer The writer
+ * @param data   The memory, which must stay unchanged until the writer is flushed
+ * @param size   Number of bytes
+ *
+ * @return Whether pending pieces could be written to make room. On failure, `errno` is set.
+ */
+CANVAS_STATIC_INLINE bool canvas_image_writer_add(canvas_image_writer_t *writer, const void *data, size_t size)
 {
-    canvas_buffer_place_bitmap(
-        cv->buffer,
-        bitmap,
-        cv->pixel_size,
-        cv->width,
-        x_left,
-        x_right,
-        y_top,
-        y_bottom
-    );
+    if (size == 0)
+    {
+        return true;
+    }
+    if (writer->count == CANVAS_IMAGE_IOV_COUNT && !canvas_image_writer_flush(writer))
+    {
+        return false;
+    }
+    writer->iov[writer->count].iov_base = (void *)data;
+    writer->iov[writer->count].iov_len = size;
+    writer->count++;
+    return true;
 }
 
-CANVAS_STATIC_INLINE void canvas_extract_bitmap(
-    const canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT bitmap,
-    size_t x_left,
-    size_t x_right,
-    size_t y_top,
-    size_t y_bottom
-)
+/**
+ * For internal use. Make room in the chunk.
+ *
+ * @param writer The writer
+ * @param size   Number of bytes needed, at most @ref CANVAS_IMAGE_CHUNK_SIZE
+ *
+ * @return Where to place up to `size` bytes, to be followed by @ref canvas_image_writer_commit,
+ *         or NULL if pending pieces could not be written to make room. On failure, `errno` is set.
+ */
+CANVAS_STATIC_INLINE uint8_t *canvas_image_writer_space(canvas_image_writer_t *writer, size_t size)
 {
-    canvas_buffer_extract_bitmap(
-        cv->buffer,
-        bitmap,
-        cv->pixel_size,
-        cv->width,
-        x_left,
-        x_right,
-        y_top,
-        y_bottom
-    );
+    if ((writer->used + size > CANVAS_IMAGE_CHUNK_SIZE || writer->count == CANVAS_IMAGE_IOV_COUNT)
+        && !canvas_image_writer_flush(writer))
+    {
+        return NULL;
+    }
+    return writer->chunk + writer->used;
 }
 
-CANVAS_STATIC_INLINE void canvas_copy_region(
-    canvas_t* CANVAS_RESTRICT cv,
-    uint8_t* CANVAS_RESTRICT bitmap,
-    size_t source_x_left,
-    size_t source_x_right,
-    size_t source_y_top,
-    size_t source_y_bottom,
-    size_t dest_x_left,
-    size_t dest_y_top
-)
+/**
+ * For internal use. Queue bytes placed at the pointer returned by @ref canvas_image_writer_space.
+ *
+ * @param writer The writer
+ * @param size   Number of bytes that were placed
+ */
+CANVAS_STATIC_INLINE void canvas_image_writer_commit(canvas_image_writer_t *writer, size_t size)
 {
-    canvas_buffer_copy_region(
-        cv->buffer,
-        bitmap,
-        cv->pixel_size,
-        cv->width,
-        source_x_left,
-        source_x_right,
-        source_y_top,
-        source_y_bottom,
-        dest_x_left,
-        dest_y_top
-    );
+    uint8_t *data = writer->chunk + writer->used;
+    struct iovec *last = writer->count > 0 ? &writer->iov[writer->count - 1] : NULL;
+    if (last && (uint8_t *)last->iov_base + last->iov_len == data)
+    {
+        // Extend the previous piece of the chunk instead of starting a new one
+        last->iov_len += size;
+    }
+    else if (size > 0)
+    {
+        writer->iov[writer->count].iov_base = data;
+        writer->iov[writer->count].iov_len = size;
+        writer->count++;
+    }
+    writer->used += size;
 }
 
-
 /**
- * Fill the entire canvas with a pixel value.
+ * For internal use. Copy bytes into the chunk and queue them.
  *
- * @param canvas Canvas
- * @param pixel  Pixel data for a single pixel. The entire canvas will be filled with this pixel
+ * @param writer The writer
+ * @param data   The bytes
+ * @param size   Number of bytes, at most @ref CANVAS_IMAGE_CHUNK_SIZE
  *
- * If the pixel data is representable as an integer literal, consider using @ref canvas_fill_literal to avoid using a dummy variable.
+ * @return Whether pending pieces could be written to make room. On failure, `errno` is set.
  */
-CANVAS_STATIC_INLINE void canvas_fill(canvas_t* CANVAS_RESTRICT cv, uint8_t* CANVAS_RESTRICT pixel)
+CANVAS_STATIC_INLINE bool canvas_image_writer_copy(canvas_image_writer_t *writer, const void *data, size_t size)
 {
-    canvas_buffer_fill(
-        cv->buffer,
-        pixel,
-        cv->pixel_size,
-        cv->buffer_size
-    );
+    uint8_t *space = canvas_image_writer_space(writer, size);
+    if (!space)
+    {
+        return false;
+    }
+    memcpy(space, data, size);
+    canvas_image_writer_commit(writer, size);
+    return true;
 }
 
-#if CANVAS_FEATURE_TWO_BUFFERS
-    CANVAS_STATIC_INLINE void canvas_rotate_90_cw(canvas_t* cv)
+/**
+ * For internal use. Store a 16- or 32-bit value in little-endian byte order.
+ */
+CANVAS_STATIC_INLINE void canvas_image_put_le(uint8_t *data, uint32_t value, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
     {
-        canvas_buffer_rotate_90_cw(
-            cv->_temp_buffer,
-            cv->buffer,
-            cv->pixel_size,
-            cv->buffer_size,
-            cv->width,
-            cv->height
-        );
-        canvas_swap_buffers(cv);
+        data[i] = (uint8_t)(value >> (8 * i));
     }
+}
 
-    CANVAS_STATIC_INLINE void canvas_rotate_90_ccw(canvas_t* cv)
+/**
+ * Write the canvas as a binary PPM image (or PGM for @ref CANVAS_IMAGE_GRAY8).
+ *
+ * @param cv     Canvas
+ * @param format Layout of the pixels in the canvas. Must match `cv->pixel_size`.
+ * @param fd     Open file descriptor. It is not closed.
+ *
+ * @return Whether the image was written. On failure, `errno` is set.
+ *
+ * @ref CANVAS_IMAGE_GRAY8 and @ref CANVAS_IMAGE_RGB888 rows are written straight from the canvas.
+ * Alpha is dropped.
+ */
+CANVAS_STATIC_INLINE bool canvas_write_ppm(const canvas_t *cv, canvas_image_format_t format, int fd)
+{
+    if (canvas_image_pixel_size(format) != cv->pixel_size)
     {
-        canvas_buffer_rotate_90_ccw(
-            cv->_temp_buffer,
-            cv->buffer,
-            cv->pixel_size,
-            cv->buffer_size,
-            cv->width,
-            cv->height
-        );
-        canvas_swap_buffers(cv);
+        errno = EINVAL;
+        return false;
     }
+    canvas_fast_clear_resolve_all(cv);
+    canvas_image_writer_t writer;
+    writer.fd = fd;
+    writer.count = 0;
+    writer.used = 0;
 
-    CANVAS_STATIC_INLINE void canvas_rotate_180(canvas_t* cv)
+    bool gray = format == CANVAS_IMAGE_GRAY8;
+    int header_size = snprintf(
+        (char *)writer.chunk, CANVAS_IMAGE_CHUNK_SIZE, "P%c\n%zu %zu\n255\n", gray ? '5' : '6', cv->width, cv->height
+    );
+    canvas_image_writer_commit(&writer, (size_t)header_size);
+
+    for (size_t y = 0; y < cv->height; y++)
     {
-        canvas_buffer_rotate_180(
-            cv->_temp_buffer,
-            cv->buffer,
-            cv->pixel_size,
-            cv->buffer_size,
-            cv->width,
-            cv->height
-        );
-        canvas_swap_buffers(cv);
+        const uint8_t *row = canvas_row(cv, y);
+        if (gray || format == CANVAS_IMAGE_RGB888)
+        {
+            if (!canvas_image_writer_add(&writer, row, cv->width * cv->pixel_size))
+            {
+                return false;
+            }
+            continue;
+        }
+        for (size_t x = 0; x < cv->width; )
+        {
+            size_t count = cv->width - x;
+            if (count > CANVAS_IMAGE_CHUNK_SIZE / 3)
+            {
+                count = CANVAS_IMAGE_CHUNK_SIZE / 3;
+            }
+            uint8_t *out = canvas_image_writer_space(&writer, count * 3);
+            if (!out)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                uint8_t rgba[4];
+                canvas_image_read_pixel(format, row + (x + i) * cv->pixel_size, rgba);
+                memcpy(out + i * 3, rgba, 3);
+            }
+            canvas_image_writer_commit(&writer, count * 3);
+            x += count;
+        }
     }
+    return canvas_image_writer_flush(&writer);
+}
 
-    CANVAS_STATIC_INLINE void canvas_flip_up_down(canvas_t* cv)
+/**
+ * Write the canvas as an uncompressed BMP image.
+ *
+ * @param cv     Canvas
+ * @param format Layout of the pixels in the canvas. Must match `cv->pixel_size`.
+ * @param fd     Open file descriptor. It is not closed.
+ *
+ * @return Whether the image was written. On failure, `errno` is set.
+ *
+ * The image is stored top-down, so rows are written in canvas order.
+ * @ref CANVAS_IMAGE_GRAY8 becomes an 8-bit image with a grey palette, @ref CANVAS_IMAGE_BGRA8888 a 32-bit image
+ * and every other format a 24-bit image. The first two and @ref CANVAS_IMAGE_BGR888 are written straight from the canvas.
+ */
+CANVAS_STATIC_INLINE bool canvas_write_bmp(const canvas_t *cv, canvas_image_format_t format, int fd)
+{
+    if (canvas_image_pixel_size(format) != cv->pixel_size)
     {
-        canvas_buffer_flip_up_down(
-            cv->_temp_buffer,
-            cv->buffer,
-            cv->pixel_size,
-            cv->buffer_size,
-            cv->width,
-            cv->height
-        );
-        canvas_swap_buffers(cv);
+        errno = EINVAL;
+        return false;
     }
+    canvas_fast_clear_resolve_all(cv);
+    canvas_image_writer_t writer;
+    writer.fd = fd;
+    writer.count = 0;
+    writer.used = 0;
 
-    CANVAS_STATIC_INLINE void canvas_flip_left_right(canvas_t* cv)
+    static const uint8_t padding[3] = { 0, 0, 0 };
+    bool direct = format == CANVAS_IMAGE_GRAY8 || format == CANVAS_IMAGE_BGR888 || format == CANVAS_IMAGE_BGRA8888;
+    size_t bits = format == CANVAS_IMAGE_GRAY8 ? 8 : format == CANVAS_IMAGE_BGRA8888 ? 32 : 24;
+    size_t pixels_size = cv->width * bits / 8;
+    size_t row_size = (pixels_size + 3) & ~(size_t)3;
+    size_t palette_size = bits == 8 ? 256 * 4 : 0;
+    size_t offset = 14 + 40 + palette_size;
+
+    uint8_t *header = canvas_image_writer_space(&writer, offset);
+    memset(header, 0, 54);
+    header[0] = 'B';
+    header[1] = 'M';
+    canvas_image_put_le(header + 2, (uint32_t)(offset + row_size * cv->height), 4);
+    canvas_image_put_le(header + 10, (uint32_t)offset, 4);
+    canvas_image_put_le(header + 14, 40, 4);
+    canvas_image_put_le(header + 18, (uint32_t)cv->width, 4);
+    canvas_image_put_le(header + 22, (uint32_t)-(int32_t)cv->height, 4);
+    canvas_image_put_le(header + 26, 1, 2);
+    canvas_image_put_le(header + 28, (uint32_t)bits, 2);
+    canvas_image_put_le(header + 34, (uint32_t)(row_size * cv->height), 4);
+    for (size_t i = 0; i < palette_size / 4; i++)
     {
-        canvas_buffer_flip_left_right(
-            cv->_temp_buffer,
-            cv->buffer,
-            cv->pixel_size,
-            cv->buffer_size,
-            cv->width,
-            cv->height
-        );
-        canvas_swap_buffers(cv);
+        uint8_t *entry = header + 54 + i * 4;
+        entry[0] = entry[1] = entry[2] = (uint8_t)i;
+        entry[3] = 0;
     }
-#endif
+    canvas_image_writer_commit(&writer, offset);
 
-static inline void canvas_text_stm_draw_char(
-    canvas_t *cv,
-    sFONT *font,
-    uint8_t *pixel_foreground,
-    uint8_t *pixel_background,
-    char character,
-    size_t x_left,
-    size_t y_top
-)
-{
-    // Gleaned from the format and STM's drivers
-    size_t font_table_index = (character - ' ') * font->Height * ((font->Width + 7) / 8);
-    for (size_t dy = 0; dy < font->Height; dy++)
+    for (size_t y = 0; y < cv->height; y++)
     {
-        size_t y = y_top + dy;
-        for (size_t dx = 0; dx < font->Width; dx++)
+        const uint8_t *row = canvas_row(cv, y);
+        if (direct)
         {
-            size_t x = x_left + dx;
-            uint8_t *pixel = (font->table[font_table_index] & (0x80 >> (dx & 7))) ? pixel_foreground : pixel_background;
-            canvas_set_pixel(cv, pixel, x, y);
-            if ((dx & 7) == 7)
+            if (!canvas_image_writer_add(&writer, row, pixels_size))
             {
-                font_table_index++;
+                return false;
             }
         }
-        if (font->Width & 7)
+        else
         {
-            font_table_index++;
+            for (size_t x = 0; x < cv->width; )
+            {
+                size_t count = cv->width - x;
+                if (count > CANVAS_IMAGE_CHUNK_SIZE / 3)
+                {
+                    count = CANVAS_IMAGE_CHUNK_SIZE / 3;
+                }
+                uint8_t *out = canvas_image_writer_space(&writer, count * 3);
+                if (!out)
+                {
+                    return false;
+                }
+                for (size_t i = 0; i < count; i++)
+                {
+                    uint8_t rgba[4];
+                    canvas_image_read_pixel(format, row + (x + i) * cv->pixel_size, rgba);
+                    out[i * 3 + 0] = rgba[2];
+                    out[i * 3 + 1] = rgba[1];
+                    out[i * 3 + 2] = rgba[0];
+                }
+                canvas_image_writer_commit(&writer, count * 3);
+                x += count;
+            }
+        }
+        if (!canvas_image_writer_add(&writer, padding, row_size - pixels_size))
+        {
+            return false;
         }
     }
+    return canvas_image_writer_flush(&writer);
 }
 
-static inline void canvas_text_stm_draw_string(
-    canvas_t *cv,
-    sFONT *font,
-    uint8_t *pixel_foreground,
-    uint8_t *pixel_background,
-    char *string,
-    size_t x_left,
-    size_t y_top
-)
+/**
+ * Write the canvas as a QOI image ("Quite OK Image Format"), a fast lossless format.
+ *
+ * @param cv     Canvas
+ * @param format Layout of the pixels in the canvas. Must match `cv->pixel_size`.
+ * @param fd     Open file descriptor. It is not closed.
+ *
+ * @return Whether the image was written. On failure, `errno` is set.
+ *
+ * @ref CANVAS_IMAGE_RGBA8888 and @ref CANVAS_IMAGE_BGRA8888 are written with 4 channels, every other format with 3.
+ * The encoder state is a few dozen bytes, and its output goes through the same fixed-size chunk as the other formats.
+ */
+CANVAS_STATIC_INLINE bool canvas_write_qoi(const canvas_t *cv, canvas_image_format_t format, int fd)
 {
-    size_t len = strlen(string);
-    size_t x = x_left;
-    size_t y = y_top;
-    for (size_t i = 0; i < len; i++)
+    if (canvas_image_pixel_size(format) != cv->pixel_size)
     {
-        canvas_text_stm_draw_char(
-            cv,
-            font,
-            pixel_foreground,
-            pixel_background,
-            string[i],
-            x,
-            y
-        );
+        errno = EINVAL;
+        return false;
+    }
+    canvas_fast_clear_resolve_all(cv);
+    canvas_image_writer_t writer;
+    writer.fd = fd;
+    writer.count = 0;
+    writer.used = 0;
 
-        x += font->Width;
-        if ((x + font->Width) > cv->width - 5)
+    uint8_t *header = canvas_image_writer_space(&writer, 14);
+    memcpy(header, "qoif", 4);
+    for (size_t i = 0; i < 4; i++)
+    {
+        header[4 + i] = (uint8_t)(cv->width >> (24 - 8 * i));
+        header[8 + i] = (uint8_t)(cv->height >> (24 - 8 * i));
+    }
+    header[12] = (format == CANVAS_IMAGE_RGBA8888 || format == CANVAS_IMAGE_BGRA8888) ? 4 : 3;
+    header[13] = 0;
+    canvas_image_writer_commit(&writer, 14);
+
+    uint8_t index[64][4];
+    memset(index, 0, sizeof(index));
+    uint8_t previous[4] = { 0, 0, 0, 255 };
+    size_t run = 0;
+
+    for (size_t y = 0; y < cv->height; y++)
+    {
+        const uint8_t *row = canvas_row(cv, y);
+        for (size_t x = 0; x < cv->width; )
         {
-            y += font->Height;
-            x = x_left;
+            // Each pixel takes at most 5 bytes, plus 1 for a run ended by it
+            size_t count = cv->width - x;
+            if (count > CANVAS_IMAGE_CHUNK_SIZE / 5 - 1)
+            {
+                count = CANVAS_IMAGE_CHUNK_SIZE / 5 - 1;
+            }
+            uint8_t *out = canvas_image_writer_space(&writer, count * 5 + 1);
+            if (!out)
+            {
+                return false;
+            }
+            size_t size = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                uint8_t pixel[4];
+                canvas_image_read_pixel(format, row + (x + i) * cv->pixel_size, pixel);
+                if (memcmp(pixel, previous, 4) == 0)
+                {
+                    if (++run == 62)
+                    {
+                        out[size++] = (uint8_t)(0xC0 | (run - 1));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0)
+                {
+                    out[size++] = (uint8_t)(0xC0 | (run - 1));
+                    run = 0;
+                }
+
+                size_t hash = (pixel[0] * 3u + pixel[1] * 5u + pixel[2] * 7u + pixel[3] * 11u) % 64;
+                if (memcmp(index[hash], pixel, 4) == 0)
+                {
+                    out[size++] = (uint8_t)hash;
+                }
+                else if (pixel[3] != previous[3])
+                {
+                    out[size++] = 0xFF;
+                    memcpy(out + size, pixel, 4);
+                    size += 4;
+                }
+                else
+                {
+                    int dr = (int8_t)(uint8_t)(pixel[0] - previous[0]);
+                    int dg = (int8_t)(uint8_t)(pixel[1] - previous[1]);
+                    int db = (int8_t)(uint8_t)(pixel[2] - previous[2]);
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        out[size++] = (uint8_t)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                    }
+                    else if (dg >= -32 && dg <= 31 && dr - dg >= -8 && dr - dg <= 7 && db - dg >= -8 && db - dg <= 7)
+                    {
+                        out[size++] = (uint8_t)(0x80 | (dg + 32));
+                        out[size++] = (uint8_t)(((dr - dg + 8) << 4) | (db - dg + 8));
+                    }
+                    else
+                    {
+                        out[size++] = 0xFE;
+                        memcpy(out + size, pixel, 3);
+                        size += 3;
+                    }
+                }
+                memcpy(index[hash], pixel, 4);
+                memcpy(previous, pixel, 4);
+            }
+            canvas_image_writer_commit(&writer, size);
+            x += count;
         }
     }
+
+    static const uint8_t end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    uint8_t run_op = (uint8_t)(0xC0 | (run - 1));
+    if ((run > 0 && !canvas_image_writer_copy(&writer, &run_op, 1)) || !canvas_image_writer_add(&writer, end, sizeof(end)))
+    {
+        return false;
+    }
+    return canvas_image_writer_flush(&writer);
 }
 
 /**
  * @}
  */
+#endif
 
 /**
  * @defgroup LITERAL_MACROS Using literal values as pixels
@@ -1516,11 +9967,11 @@ static inline void canvas_text_stm_draw_string(
  *
  * If the pixel data is already stored in a variable, use @ref canvas_set_pixel.
  */
-#define canvas_set_pixel_literal(cv, type, pixel, x, y)              \
-do {                                                                 \
-    type storage = pixel;                                            \
-    size_t offset = (y * (cv)->width + x) * sizeof(type);            \
-    memcpy((cv)->buffer + offset, (uint8_t*)&storage, sizeof(type)); \
+#define canvas_set_pixel_literal(cv, type, pixel, x, y)                               \
+do {                                                                                  \
+    type storage = pixel;                                                             \
+    canvas_fast_clear_resolve(cv, x, (x) + 1, y, (y) + 1, true);                      \
+    memcpy(canvas_row(cv, y) + (x) * sizeof(type), (uint8_t*)&storage, sizeof(type)); \
 } while (0)
 
 /**
@@ -0,0 +1,437 @@
+/** @file      canvas.hpp
+ *  @brief     Canvas, C++ interface
+ *
+ *  Typed C++17 wrappers around canvas.h. Pixels are values of a pixel type rather than byte pointers,
+ *  so no dummy variables are needed to pass literal colours, and the pixel size is a compile-time constant.
+ */
+
+#ifndef CANVAS_HPP
+#define CANVAS_HPP
+
+#include "canvas.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace canvas {
+
+/**
+ * @defgroup CPP_API C++ API
+ *
+ * @ref Canvas has its geometry in its type, so its stride and buffer size are constants
+ * and the fill and pixel kernels below are specialized for them: pixels are stored with fixed-size copies,
+ * and filling an unpadded canvas is a single loop over a constant number of pixels which the compiler can unroll
+ * and vectorize. @ref DynamicCanvas keeps the pixel type but takes its size at run time.
+ *
+ * Both wrap a @ref canvas_t, available through `c()`, so every function of the C API can be used on them too.
+ *
+ * @{
+ */
+
+namespace detail {
+
+/**
+ * For internal use. Store one pixel, with a copy of constant size.
+ */
+template <typename PixelT>
+inline void store(std::uint8_t *destination, const PixelT &pixel)
+{
+    std::memcpy(destination, &pixel, sizeof(PixelT));
+}
+
+/**
+ * For internal use. Store `count` copies of a pixel next to each other.
+ */
+template <typename PixelT>
+inline void fill_pixels(std::uint8_t *destination, const PixelT &pixel, std::size_t count)
+{
+    if constexpr (sizeof(PixelT) == 1)
+    {
+        std::uint8_t byte;
+        std::memcpy(&byte, &pixel, 1);
+        std::memset(destination, byte, count);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            store(destination + i * sizeof(PixelT), pixel);
+        }
+    }
+}
+
+/**
+ * For internal use. The bytes of a pixel, for passing to the C API.
+ */
+template <typename PixelT>
+inline const std::uint8_t *bytes(const PixelT &pixel)
+{
+    return reinterpret_cast<const std::uint8_t *>(&pixel);
+}
+
+} // namespace detail
+
+/**
+ * Operations shared by @ref Canvas and @ref DynamicCanvas.
+ *
+ * @tparam Derived The canvas class, which provides `c()`, `width()` and `height()`
+ * @tparam PixelT  The pixel type, e.g. `uint16_t` for RGB565 or `uint32_t` for ARGB8888. Must be trivially copyable.
+ */
+template <typename Derived, typename PixelT>
+class CanvasBase
+{
+    static_assert(std::is_trivially_copyable_v<PixelT>, "Pixels are copied byte for byte");
+
+public:
+    using pixel_type = PixelT;                                  /**< The pixel type */
+    static constexpr std::size_t pixel_size = sizeof(PixelT);   /**< The size per pixel in bytes */
+
+    /**
+     * Pointer to the start of a row, taking the row origin into account. See @ref canvas_row.
+     *
+     * With a fast clear pending, call @ref canvas_fast_clear_resolve for the pixels before accessing them through the row.
+     */
+    std::uint8_t *row(std::size_t y) const
+    {
+        return canvas_row(&self().c(), y);
+    }
+
+    /**
+     * The value of a single pixel.
+     */
+    PixelT get_pixel(std::size_t x, std::size_t y) const
+    {
+        canvas_fast_clear_resolve(&self().c(), x, x + 1, y, y + 1, false);
+        PixelT pixel;
+        std::memcpy(&pixel, row(y) + x * pixel_size, pixel_size);
+        return pixel;
+    }
+
+    /**
+     * Set a single pixel.
+     */
+    void set_pixel(std::size_t x, std::size_t y, PixelT pixel)
+    {
+        canvas_fast_clear_resolve(&self().c(), x, x + 1, y, y + 1, true);
+        detail::store(row(y) + x * pixel_size, pixel);
+    }
+
+    /**
+     * Fill the whole canvas. See @ref canvas_fill.
+     */
+    void fill(PixelT pixel)
+    {
+        const canvas_t &cv = self().c();
+        #if CANVAS_FEATURE_THREAD_POOL
+            if (cv.parallel)
+            {
+                canvas_fill(&self().c(), detail::bytes(pixel));
+                return;
+            }
+        #endif
+        #if CANVAS_FEATURE_FAST_CLEAR
+            if (cv.fast_clear)
+            {
+                canvas_fill(&self().c(), detail::bytes(pixel));
+                return;
+            }
+        #endif
+        if (self().width() * self().height() * pixel_size >= CANVAS_STREAM_THRESHOLD)
+        {
+            // Large enough to write past the cache
+            canvas_buffer_fill_stride(cv.buffer, detail::bytes(pixel), pixel_size, cv.stride, self().width(), self().height());
+            return;
+        }
+        if (cv.stride == self().width() * pixel_size)
+        {
+            // The rows are contiguous, wherever the row origin is
+            detail::fill_pixels(cv.buffer, pixel, self().width() * self().height());
+            return;
+        }
+        for (std::size_t y = 0; y < self().height(); y++)
+        {
+            detail::fill_pixels(cv.buffer + y * cv.stride, pixel, self().width());
+        }
+    }
+
+    /**
+     * Fill a rectangle. See @ref canvas_fill_rect.
+     */
+    void fill_rect(std::size_t x_left, std::size_t x_right, std::size_t y_top, std::size_t y_bottom, PixelT pixel)
+    {
+        canvas_fast_clear_resolve(&self().c(), x_left, x_right, y_top, y_bottom, true);
+        for (std::size_t y = y_top; y < y_bottom; y++)
+        {
+            detail::fill_pixels(row(y) + x_left * pixel_size, pixel, x_right - x_left);
+        }
+    }
+
+    /**
+     * Draw a horizontal line. See @ref canvas_draw_horizontal_line.
+     */
+    void draw_horizontal_line(std::size_t x_left, std::size_t x_right, std::size_t y, PixelT pixel)
+    {
+        canvas_fast_clear_resolve(&self().c(), x_left, x_right, y, y + 1, true);
+        detail::fill_pixels(row(y) + x_left * pixel_size, pixel, x_right - x_left);
+    }
+
+    /**
+     * Draw a vertical line. See @ref canvas_draw_vertical_line.
+     */
+    void draw_vertical_line(std::size_t x, std::size_t y_top, std::size_t y_bottom, PixelT pixel)
+    {
+        canvas_fast_clear_resolve(&self().c(), x, x + 1, y_top, y_bottom, true);
+        for (std::size_t y = y_top; y < y_bottom; y++)
+        {
+            detail::store(row(y) + x * pixel_size, pixel);
+        }
+    }
+
+    /**
+     * Draw the edges of a rectangle, 1 pixel wide. See @ref canvas_draw_rect.
+     */
+    void draw_rect(std::size_t x_left, std::size_t x_right, std::size_t y_top, std::size_t y_bottom, PixelT pixel)
+    {
+        canvas_draw_rect(&self().c(), detail::bytes(pixel), x_left, x_right, y_top, y_bottom);
+    }
+
+    /**
+     * Draw a line. See @ref canvas_draw_line.
+     */
+    void draw_line(std::size_t x_0, std::size_t x_1, std::size_t y_0, std::size_t y_1, PixelT pixel)
+    {
+        canvas_draw_line(&self().c(), detail::bytes(pixel), x_0, x_1, y_0, y_1);
+    }
+
+    /**
+     * Draw a circle. See @ref canvas_draw_circle.
+     */
+    void draw_circle(std::size_t x_center, std::size_t y_center, std::size_t radius, PixelT pixel)
+    {
+        canvas_draw_circle(&self().c(), detail::bytes(pixel), x_center, y_center, radius);
+    }
+
+    /**
+     * Fill a circle. See @ref canvas_fill_circle.
+     */
+    void fill_circle(std::size_t x_center, std::size_t y_center, std::size_t radius, PixelT pixel)
+    {
+        canvas_fill_circle(&self().c(), detail::bytes(pixel), x_center, y_center, radius);
+    }
+
+    /**
+     * Fill a triangle. See @ref canvas_fill_triangle.
+     */
+    void fill_triangle(
+        std::size_t x_0,
+        std::size_t x_1,
+        std::size_t x_2,
+        std::size_t y_0,
+        std::size_t y_1,
+        std::size_t y_2,
+        PixelT pixel
+    )
+    {
+        canvas_fill_triangle(&self().c(), detail::bytes(pixel), x_0, x_1, x_2, y_0, y_1, y_2);
+    }
+
+    /**
+     * Copy a bitmap of the same pixel type into a region of the canvas. See @ref canvas_place_bitmap.
+     */
+    void place_bitmap(
+        const PixelT *bitmap,
+        std::size_t x_left,
+        std::size_t x_right,
+        std::size_t y_top,
+        std::size_t y_bottom
+    )
+    {
+        canvas_place_bitmap(
+            &self().c(),
+            reinterpret_cast<const std::uint8_t *>(bitmap),
+            x_left,
+            x_right,
+            y_top,
+            y_bottom
+        );
+    }
+
+    /**
+     * Draw a string in one of the STM fonts. See @ref canvas_text_stm_draw_string.
+     */
+    void draw_string(
+        sFONT &font,
+        const char *string,
+        std::size_t x_left,
+        std::size_t y_top,
+        PixelT foreground,
+        PixelT background
+    )
+    {
+        canvas_text_stm_draw_string(
+            &self().c(),
+            &font,
+            detail::bytes(foreground),
+            detail::bytes(background),
+            string,
+            x_left,
+            y_top
+        );
+    }
+
+    /**
+     * Scroll the contents up, filling the rows that come in at the bottom. See @ref canvas_scroll_up.
+     */
+    void scroll_up(std::size_t rows, PixelT pixel)
+    {
+        canvas_scroll_up(&self().c(), detail::bytes(pixel), rows);
+    }
+
+    /**
+     * Scroll the contents down, filling the rows that come in at the top. See @ref canvas_scroll_down.
+     */
+    void scroll_down(std::size_t rows, PixelT pixel)
+    {
+        canvas_scroll_down(&self().c(), detail::bytes(pixel), rows);
+    }
+
+private:
+    Derived &self()
+    {
+        return static_cast<Derived &>(*this);
+    }
+
+    const Derived &self() const
+    {
+        return static_cast<const Derived &>(*this);
+    }
+};
+
+/**
+ * A canvas whose size is fixed at compile time, with its pixel memory inside the object.
+ *
+ * @tparam Width  Width of the canvas in pixels
+ * @tparam Height Height of the canvas in pixels
+ * @tparam PixelT The pixel type
+ *
+ * The object holds `alloc_size` bytes, so large canvases should be allocated statically or on the heap.
+ * It can't be copied, as the wrapped @ref canvas_t points into it.
+ */
+template <std::size_t Width, std::size_t Height, typename PixelT>
+class Canvas : public CanvasBase<Canvas<Width, Height, PixelT>, PixelT>
+{
+    static_assert(Width > 0 && Height > 0, "A canvas needs at least one pixel");
+
+public:
+    static constexpr std::size_t stride = Width * sizeof(PixelT);   /**< Number of bytes from the start of one row to the start of the next */
+    static constexpr std::size_t buffer_size = stride * Height;     /**< Size of the pixel buffer in bytes */
+    static constexpr std::size_t alloc_size = CANVAS_FEATURE_TWO_BUFFERS ? 2 * buffer_size : buffer_size;  /**< Size of the memory inside the object */
+
+    Canvas()
+        : cv_(canvas_init(Width, Height, sizeof(PixelT)))
+    {
+        canvas_set_memory(&cv_, memory_);
+    }
+
+    Canvas(const Canvas &) = delete;
+    Canvas &operator=(const Canvas &) = delete;
+
+    /** Width of the canvas in pixels */
+    static constexpr std::size_t width()
+    {
+        return Width;
+    }
+
+    /** Height of the canvas in pixels */
+    static constexpr std::size_t height()
+    {
+        return Height;
+    }
+
+    /** The wrapped canvas, for use with the C API */
+    canvas_t &c()
+    {
+        return cv_;
+    }
+
+    /** The wrapped canvas, for use with the C API */
+    const canvas_t &c() const
+    {
+        return cv_;
+    }
+
+private:
+    canvas_t cv_;
+    alignas(PixelT) std::uint8_t memory_[alloc_size];
+};
+
+/**
+ * A canvas whose size is chosen at run time, with pixel memory provided by the application.
+ *
+ * @tparam PixelT The pixel type
+ *
+ * It can't be copied, as the copies would disagree about which half of the memory holds the frame
+ * after a rotation.
+ */
+template <typename PixelT>
+class DynamicCanvas : public CanvasBase<DynamicCanvas<PixelT>, PixelT>
+{
+public:
+    /**
+     * @param width  Width of the canvas in pixels
+     * @param height Height of the canvas in pixels
+     * @param memory Pointer to a buffer of size @ref alloc_size(width, height) or larger, aligned for `PixelT`,
+     *               which must remain valid for as long as the canvas is in use
+     */
+    DynamicCanvas(std::size_t width, std::size_t height, std::uint8_t *memory)
+        : cv_(canvas_init(width, height, sizeof(PixelT)))
+    {
+        canvas_set_memory(&cv_, memory);
+    }
+
+    DynamicCanvas(const DynamicCanvas &) = delete;
+    DynamicCanvas &operator=(const DynamicCanvas &) = delete;
+
+    /** Size of the memory needed for a canvas of the given size, in bytes */
+    static std::size_t alloc_size(std::size_t width, std::size_t height)
+    {
+        return canvas_init(width, height, sizeof(PixelT)).alloc_size;
+    }
+
+    /** Width of the canvas in pixels */
+    std::size_t width() const
+    {
+        return cv_.width;
+    }
+
+    /** Height of the canvas in pixels */
+    std::size_t height() const
+    {
+        return cv_.height;
+    }
+
+    /** The wrapped canvas, for use with the C API */
+    canvas_t &c()
+    {
+        return cv_;
+    }
+
+    /** The wrapped canvas, for use with the C API */
+    const canvas_t &c() const
+    {
+        return cv_;
+    }
+
+private:
+    canvas_t cv_;
+};
+
+/**
+ * @}
+ */
+
+} // namespace canvas
+
+#endif
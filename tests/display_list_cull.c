@@ -0,0 +1,153 @@
+/** @file      display_list_cull.c
+ *  @brief     Check that culling a display list does not change what it draws
+ *
+ *  Records random display lists, culls a copy of each with random tile sizes,
+ *  and compares the pixels of the two, drawn directly and rendered in bands.
+ */
+
+#include "canvas.h"
+
+#include <stdio.h>
+
+#define WIDTH       53
+#define HEIGHT      41
+#define PIXEL_SIZE  2
+#define CAPACITY    64
+#define BAND_HEIGHT 8
+#define ITERATIONS  20000
+
+static uint8_t bitmaps[4][WIDTH * HEIGHT * PIXEL_SIZE];
+static uint8_t banded[2][WIDTH * HEIGHT * PIXEL_SIZE];
+
+/**
+ * A small deterministic generator, so that a failure can be reproduced on any platform.
+ */
+static uint32_t random_state = 1;
+
+static size_t random_below(size_t limit)
+{
+    random_state = random_state * 1103515245u + 12345u;
+    return (size_t)(random_state >> 8) % limit;
+}
+
+static void random_rect(size_t *x_left, size_t *x_right, size_t *y_top, size_t *y_bottom)
+{
+    size_t x_0 = random_below(WIDTH + 1);
+    size_t x_1 = random_below(WIDTH + 1);
+    size_t y_0 = random_below(HEIGHT + 1);
+    size_t y_1 = random_below(HEIGHT + 1);
+    *x_left = x_0 < x_1 ? x_0 : x_1;
+    *x_right = x_0 < x_1 ? x_1 : x_0;
+    *y_top = y_0 < y_1 ? y_0 : y_1;
+    *y_bottom = y_0 < y_1 ? y_1 : y_0;
+}
+
+static void record_random(canvas_display_list_t *list)
+{
+    size_t count = 1 + random_below(30);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t pixel[PIXEL_SIZE] = { (uint8_t)random_below(256), (uint8_t)random_below(256) };
+        size_t x_left, x_right, y_top, y_bottom;
+        random_rect(&x_left, &x_right, &y_top, &y_bottom);
+        switch (random_below(9))
+        {
+            case 0:
+                if (random_below(4) == 0)
+                {
+                    canvas_record_fill(list, pixel);
+                }
+                break;
+            case 1:
+            case 2:
+                canvas_record_fill_rect(list, pixel, x_left, x_right, y_top, y_bottom);
+                break;
+            case 3:
+            case 4:
+                canvas_record_place_bitmap(list, bitmaps[random_below(4)], x_left, x_right, y_top, y_bottom);
+                break;
+            case 5:
+                if (x_left < x_right && y_top < y_bottom)
+                {
+                    canvas_record_draw_rect(list, pixel, x_left, x_right - 1, y_top, y_bottom - 1);
+                }
+                break;
+            case 6:
+                canvas_record_draw_line(list, pixel, x_left, x_right ? x_right - 1 : 0, y_top, y_bottom ? y_bottom - 1 : 0);
+                break;
+            case 7:
+            {
+                size_t radius = random_below(6);
+                size_t x = random_below(WIDTH - 2 * radius) + radius;
+                size_t y = random_below(HEIGHT - 2 * radius) + radius;
+                canvas_record_fill_circle(list, pixel, x, y, radius);
+                break;
+            }
+            default:
+                canvas_record_set_pixel(list, pixel, random_below(WIDTH), random_below(HEIGHT));
+                break;
+        }
+    }
+}
+
+static void collect_rows(void *context, const uint8_t *data, size_t y_top, size_t y_bottom)
+{
+    uint8_t *frame = (uint8_t *)context;
+    memcpy(frame + y_top * WIDTH * PIXEL_SIZE, data, (y_bottom - y_top) * WIDTH * PIXEL_SIZE);
+}
+
+int main(void)
+{
+    static canvas_command_t commands[2][CAPACITY];
+    static uint8_t memory[2][WIDTH * HEIGHT * PIXEL_SIZE];
+    static uint8_t coverage[WIDTH * HEIGHT];
+    static uint8_t band_memory[WIDTH * BAND_HEIGHT * PIXEL_SIZE];
+
+    for (size_t i = 0; i < sizeof(bitmaps); i++)
+    {
+        bitmaps[i / sizeof(bitmaps[0])][i % sizeof(bitmaps[0])] = (uint8_t)random_below(256);
+    }
+
+    size_t total = 0;
+    size_t removed = 0;
+    for (int iteration = 0; iteration < ITERATIONS; iteration++)
+    {
+        canvas_display_list_t original = canvas_display_list_init(commands[0], CAPACITY, WIDTH, HEIGHT, PIXEL_SIZE);
+        record_random(&original);
+        canvas_display_list_t culled = original;
+        culled.commands = commands[1];
+        memcpy(commands[1], commands[0], original.count * sizeof(canvas_command_t));
+
+        size_t tile_width = 1 + random_below(9);
+        size_t tile_height = 1 + random_below(9);
+        if (canvas_display_list_cull_size(&culled, tile_width, tile_height) > sizeof(coverage))
+        {
+            printf("coverage for %zux%zu tiles does not fit\n", tile_width, tile_height);
+            return 1;
+        }
+        total += original.count;
+        removed += canvas_display_list_cull(&culled, tile_width, tile_height, coverage);
+
+        const canvas_display_list_t *lists[2] = { &original, &culled };
+        for (size_t i = 0; i < 2; i++)
+        {
+            memset(memory[i], 0xAB, sizeof(memory[i]));
+            canvas_t cv = canvas_init(WIDTH, HEIGHT, PIXEL_SIZE);
+            canvas_set_memory(&cv, memory[i]);
+            canvas_display_list_draw(&cv, lists[i]);
+            canvas_display_list_render_bands(lists[i], band_memory, BAND_HEIGHT, 1, collect_rows, banded[i]);
+        }
+        if (memcmp(memory[0], memory[1], sizeof(memory[0])) != 0)
+        {
+            printf("iteration %d: culled list draws different pixels\n", iteration);
+            return 1;
+        }
+        if (memcmp(banded[0], banded[1], sizeof(banded[0])) != 0)
+        {
+            printf("iteration %d: culled list renders different bands\n", iteration);
+            return 1;
+        }
+    }
+    printf("removed %zu of %zu commands\n", removed, total);
+    return 0;
+}